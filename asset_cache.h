@@ -0,0 +1,303 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+// --- Asset Cache ---
+// Generated assets (texture mip chains, baked vertex and index arrays) kept
+// in one binary file between runs. The file is a header, a table of entries
+// and the blobs themselves, each aligned to ASSET_CACHE_ALIGNMENT:
+//
+//     AssetCacheHeader   magic, format version, content key, entry count
+//     AssetCacheEntry[]  (kind, index) -> offset and size of a blob
+//     blobs
+//
+// The content key is a hash of everything the assets were generated from
+// (generator parameters, sizes and a version the scene bumps when its
+// generator code changes). Inputs only some assets depend on, like a random
+// seed, can instead be stored as a blob of their own and checked by the
+// scene. A reader maps the file and uses it only
+// if the magic, the format version and the key all match and every entry
+// lies inside the file; anything else is a miss, and the caller regenerates
+// and writes a fresh file. Blobs are used in place: textures go from the
+// mapping straight to glTexImage2D, nothing is parsed.
+//
+// Writes go to a temporary file that is renamed over the old one, so a
+// crash mid-write never leaves a truncated cache behind.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mesh_cache.h"
+
+const uint32_t ASSET_CACHE_MAGIC = 0x4341494Du; // "MIAC"
+const uint32_t ASSET_CACHE_FORMAT = 1;          // Bump when the layout below changes
+const size_t ASSET_CACHE_ALIGNMENT = 64;
+
+struct AssetCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct AssetCacheEntry {
+    uint32_t kind;  // Chosen by the scene
+    uint32_t index;
+    uint64_t offset; // From the start of the file
+    uint64_t bytes;
+};
+
+// FNV-1a over the raw bytes of every value added
+struct AssetCacheKey {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    void addBytes(const void* data, size_t bytes) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < bytes; ++i) hash = (hash ^ p[i]) * 0x100000001B3ull;
+    }
+
+    // Plain values and structs without padding
+    template <typename T>
+    void add(const T& value) { addBytes(&value, sizeof(value)); }
+};
+
+// --- Reading ---
+
+class AssetCache {
+public:
+    AssetCache() {}
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+    ~AssetCache() { close(); }
+
+    // Maps 'path' and checks it against 'key'; false (and nothing mapped) on
+    // a missing, foreign, stale or damaged file
+    bool open(const char* path, uint64_t key) {
+        close();
+        if (!map(path)) return false;
+        if (size < sizeof(AssetCacheHeader)) { close(); return false; }
+        const AssetCacheHeader* header = (const AssetCacheHeader*)data;
+        if (header->magic != ASSET_CACHE_MAGIC || header->format != ASSET_CACHE_FORMAT || header->key != key ||
+            header->entryCount > (size - sizeof(AssetCacheHeader)) / sizeof(AssetCacheEntry)) {
+            close();
+            return false;
+        }
+        entries = (const AssetCacheEntry*)(data + sizeof(AssetCacheHeader));
+        entryCount = header->entryCount;
+        for (uint32_t i = 0; i < entryCount; ++i) {
+            const AssetCacheEntry& entry = entries[i];
+            if (entry.offset % ASSET_CACHE_ALIGNMENT != 0 || entry.offset > size || entry.bytes > size - entry.offset) {
+                close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+        buffer.shrink_to_fit();
+#else
+        if (data) munmap((void*)data, size);
+#endif
+        data = nullptr;
+        size = 0;
+        entries = nullptr;
+        entryCount = 0;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+    size_t bytes() const { return size; }
+
+    // Blob of (kind, index), or nullptr; 'bytes' receives its size
+    const void* find(uint32_t kind, uint32_t index, size_t& bytes) const {
+        for (uint32_t i = 0; i < entryCount; ++i) {
+            if (entries[i].kind == kind && entries[i].index == index) {
+                bytes = (size_t)entries[i].bytes;
+                return data + entries[i].offset;
+            }
+        }
+        bytes = 0;
+        return nullptr;
+    }
+
+private:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    const AssetCacheEntry* entries = nullptr;
+    uint32_t entryCount = 0;
+#ifdef _WIN32
+    std::vector<unsigned char> buffer; // No mmap here; the file is read whole instead
+#endif
+
+    bool map(const char* path) {
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        buffer.resize((size_t)in.tellg());
+        in.seekg(0);
+        if (buffer.empty() || !in.read((char*)buffer.data(), buffer.size())) return false;
+        data = buffer.data();
+        size = buffer.size();
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping keeps the file open
+        if (mapped == MAP_FAILED) return false;
+        data = (const unsigned char*)mapped;
+        size = (size_t)info.st_size;
+#endif
+        return true;
+    }
+};
+
+// --- Writing ---
+
+// Leads a mesh blob; the arrays follow in Mesh order, absent ones omitted
+struct AssetMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t hasTexCoords;
+    uint32_t hasColors;
+};
+
+// Collects blobs and writes them out as one cache file. add() only keeps a
+// pointer, so the data must outlive write(); addMesh() keeps its own copy.
+class AssetCacheWriter {
+public:
+    void add(uint32_t kind, uint32_t index, const void* data, size_t bytes) {
+        Blob blob = { kind, index, data, bytes };
+        blobs.push_back(blob);
+    }
+
+    // Vertex and index arrays of 'mesh' in the layout readMeshBlob() expects
+    void addMesh(uint32_t kind, uint32_t index, const Mesh& mesh) {
+        owned.push_back(std::vector<unsigned char>());
+        std::vector<unsigned char>& out = owned.back();
+        AssetMeshHeader header = { (uint32_t)mesh.vertexCount(), (uint32_t)mesh.indices.size(),
+                                  !mesh.texCoords.empty(), !mesh.colors.empty() };
+        append(out, &header, sizeof(header));
+        append(out, mesh.positions.data(), mesh.positions.size() * sizeof(float));
+        append(out, mesh.normals.data(), mesh.normals.size() * sizeof(float));
+        append(out, mesh.texCoords.data(), mesh.texCoords.size() * sizeof(float));
+        append(out, mesh.colors.data(), mesh.colors.size() * sizeof(float));
+        append(out, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        add(kind, index, out.data(), out.size());
+    }
+
+    // Writes every blob added so far under 'key'; returns the file size, or 0 on failure
+    size_t write(const char* path, uint64_t key) const {
+        std::string temporary = std::string(path) + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file) return 0;
+
+        AssetCacheHeader header = { ASSET_CACHE_MAGIC, ASSET_CACHE_FORMAT, key, (uint32_t)blobs.size(), 0 };
+        std::vector<AssetCacheEntry> entries(blobs.size());
+        uint64_t offset = alignOffset(sizeof(header) + entries.size() * sizeof(AssetCacheEntry));
+        for (size_t i = 0; i < blobs.size(); ++i) {
+            AssetCacheEntry entry = { blobs[i].kind, blobs[i].index, offset, blobs[i].bytes };
+            entries[i] = entry;
+            offset = alignOffset(offset + blobs[i].bytes);
+        }
+
+        static const unsigned char padding[ASSET_CACHE_ALIGNMENT] = {};
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        if (!entries.empty()) ok = ok && fwrite(entries.data(), sizeof(AssetCacheEntry), entries.size(), file) == entries.size();
+        uint64_t written = sizeof(header) + entries.size() * sizeof(AssetCacheEntry);
+        for (size_t i = 0; i < blobs.size() && ok; ++i) {
+            ok = fwrite(padding, 1, (size_t)(entries[i].offset - written), file) == entries[i].offset - written;
+            ok = ok && fwrite(blobs[i].data, 1, blobs[i].bytes, file) == blobs[i].bytes;
+            written = entries[i].offset + blobs[i].bytes;
+        }
+        ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+        if (ok) remove(path); // rename() does not replace on Windows
+#endif
+        if (!ok || rename(temporary.c_str(), path) != 0) {
+            remove(temporary.c_str());
+            return 0;
+        }
+        return (size_t)written;
+    }
+
+private:
+    struct Blob {
+        uint32_t kind, index;
+        const void* data;
+        size_t bytes;
+    };
+    std::vector<Blob> blobs;
+    std::vector<std::vector<unsigned char>> owned;
+
+    static uint64_t alignOffset(uint64_t offset) {
+        return (offset + ASSET_CACHE_ALIGNMENT - 1) / ASSET_CACHE_ALIGNMENT * ASSET_CACHE_ALIGNMENT;
+    }
+
+    static void append(std::vector<unsigned char>& out, const void* data, size_t bytes) {
+        out.insert(out.end(), (const unsigned char*)data, (const unsigned char*)data + bytes);
+    }
+};
+
+// --- Meshes ---
+
+// Fills 'mesh' from a blob written by AssetCacheWriter::addMesh(); false if
+// the blob is malformed. Meshes stay CPU-side (instance batches and bounds
+// read them), so the arrays are copied out of the mapping, one block each.
+inline bool readMeshBlob(const void* blob, size_t bytes, Mesh& mesh) {
+    if (!blob || bytes < sizeof(AssetMeshHeader)) return false;
+    AssetMeshHeader header;
+    memcpy(&header, blob, sizeof(header));
+    size_t v = header.vertexCount;
+    size_t floats = v * (6 + (header.hasTexCoords ? 2 : 0) + (header.hasColors ? 3 : 0));
+    if (bytes != sizeof(AssetMeshHeader) + floats * sizeof(float) + header.indexCount * sizeof(unsigned int)) return false;
+
+    const float* p = (const float*)((const unsigned char*)blob + sizeof(AssetMeshHeader));
+    releaseMesh(mesh);
+    mesh = Mesh();
+    mesh.positions.assign(p, p + v * 3); p += v * 3;
+    mesh.normals.assign(p, p + v * 3); p += v * 3;
+    if (header.hasTexCoords) { mesh.texCoords.assign(p, p + v * 2); p += v * 2; }
+    if (header.hasColors) { mesh.colors.assign(p, p + v * 3); p += v * 3; }
+    const unsigned int* indices = (const unsigned int*)p;
+    mesh.indices.assign(indices, indices + header.indexCount);
+    return true;
+}
+
+// --- Command Line ---
+
+// Consumes --asset-cache <path> from argv so GLUT never sees it; "none"
+// turns the cache off (path becomes empty)
+inline void assetCacheParseArgs(int& argc, char** argv, std::string& path) {
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--asset-cache") == 0 && i + 1 < argc) {
+            path = argv[++i];
+            if (path == "none") path.clear();
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+}
+
+#endif // ASSET_CACHE_H
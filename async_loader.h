@@ -0,0 +1,123 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+// --- Async Loader ---
+// Startup work that does not need the GL context runs on a loader thread
+// while the GLUT thread already draws frames. Whatever the loader produces
+// for GL (texture uploads, "this part of the scene is ready" switches) it
+// posts as GL tasks through a lock-free single-producer/single-consumer
+// ring; the GLUT thread pumps the ring once per frame and runs tasks until
+// the frame's upload budget is spent. A task that uploads more than the
+// budget allows is resumed next frame, so no frame stalls on one big
+// texture.
+//
+// Posting a task publishes everything the loader wrote before it: the GL
+// thread may read that data once the task has run. Until then the scene
+// must not touch it.
+//
+// The loader itself may use parallelFor; its chunks share the job system's
+// workers with the simulation but queue apart from the GLUT thread's, so
+// neither thread's wait runs the other's jobs. It must never call GL.
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "job_system.h"
+#include "trace_events.h"
+
+// Fixed-capacity ring for one producer thread and one consumer thread
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1) {}
+
+    // Producer only; false when full
+    bool push(T&& value) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % slots.size();
+        if (next == headIndex.load(std::memory_order_acquire)) return false;
+        slots[tail] = std::move(value);
+        tailIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; false when empty
+    bool pop(T& value) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) return false;
+        value = std::move(slots[head]);
+        slots[head] = T();
+        headIndex.store((head + 1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return headIndex.load(std::memory_order_acquire) == tailIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots; // One slot stays free to tell full from empty
+    std::atomic<size_t> headIndex{0};
+    std::atomic<size_t> tailIndex{0};
+};
+
+// Runs on the GL thread. Spends what it uploads from 'budget' (bytes) and
+// returns true when finished, false to be called again next frame.
+typedef std::function<bool(size_t& budget)> GlTask;
+
+class AsyncLoader {
+public:
+    explicit AsyncLoader(size_t queueCapacity = 64) : tasks(queueCapacity) {}
+    AsyncLoader(const AsyncLoader&) = delete;
+    AsyncLoader& operator=(const AsyncLoader&) = delete;
+    ~AsyncLoader() { join(); }
+
+    // Starts 'work' on the loader thread; it posts GL tasks with post()
+    void start(std::function<void(AsyncLoader&)> work) {
+        join();
+        working.store(true, std::memory_order_release);
+        thread = std::thread([this, work] {
+            traceSetThreadName("loader");
+            JobSystem::useBackgroundSlot();
+            work(*this);
+            working.store(false, std::memory_order_release);
+        });
+    }
+
+    // Loader thread only; waits while the ring is full
+    void post(GlTask task) {
+        while (!tasks.push(std::move(task))) std::this_thread::yield();
+    }
+
+    // GL thread: runs posted tasks in order until 'budget' bytes are spent
+    // or nothing is left; returns the number of tasks finished
+    int pump(size_t budget) {
+        int finished = 0;
+        for (;;) {
+            if (!current && !tasks.pop(current)) break;
+            if (!current(budget)) break;
+            current = GlTask();
+            ++finished;
+            if (budget == 0) break;
+        }
+        return finished;
+    }
+
+    // True once the loader thread has returned and every task it posted has run
+    bool done() const { return !working.load(std::memory_order_acquire) && !current && tasks.empty(); }
+
+    void join() {
+        if (thread.joinable()) thread.join();
+    }
+
+private:
+    SpscQueue<GlTask> tasks;
+    GlTask current; // Resumed next pump
+    std::thread thread;
+    std::atomic<bool> working{false};
+};
+
+#endif // ASYNC_LOADER_H
@@ -14,6 +14,13 @@
 #include <GL/glut.h>
 #endif
 
+#include "gl_state.h"
+#include "mesh_cache.h"
+#include "leaf_sim.h"
+#include "scene_rng.h"
+#include "scene_bench.h"
+#include "sim_clock.h"
+
 using namespace std;
 
 #ifndef M_PI
@@ -22,6 +29,7 @@ using namespace std;
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
+const char* const WINDOW_TITLE = "Realistic Man - Crouch & Sprint";
 const int NUM_LEAVES = 150; 
 
 float manPositionX = 0.0f;
@@ -46,13 +54,34 @@ bool isCrouching = false;
 
 GLfloat lightPos[] = { 300.0f, 500.0f, 200.0f, 1.0f };
 
-struct Leaf {
-    float x, y, z;
-    float color[3];
-    float size;
-    float fallSpeed;
+LeafStore fallingLeaves;
+const LeafSpawnRange LEAF_SPAWN = { -300.0f, 300.0f, -300.0f, 300.0f, 500.0f, 0.0f, 0.0f, 0.0f, false };
+
+// Fixed-rate simulation from idleScene(); drawScene() blends ticks by renderAlpha
+SimClock simClock(60.0);
+float renderAlpha = 1.0f;
+
+struct SceneSnapshot {
+    float manX, manZ, manRotationY;
+    float walkPhase;
 };
-vector<Leaf> fallingLeaves;
+SceneSnapshot previousSnapshot;
+SceneSnapshot renderSnapshot;
+
+SceneSnapshot captureSnapshot() {
+    SceneSnapshot snapshot = { manPositionX, manPositionZ, manRotationY, walkPhase };
+    return snapshot;
+}
+
+SceneSnapshot blendSnapshots(const SceneSnapshot& a, const SceneSnapshot& b, float t) {
+    SceneSnapshot out;
+    out.manX = simLerp(a.manX, b.manX, t);
+    out.manZ = simLerp(a.manZ, b.manZ, t);
+    out.manRotationY = simLerpWrapped(a.manRotationY, b.manRotationY, t, 360.0f);
+    // The gait resets to 0 when the man stops; snap instead of winding back
+    out.walkPhase = b.walkPhase < a.walkPhase ? b.walkPhase : simLerp(a.walkPhase, b.walkPhase, t);
+    return out;
+}
 
 void setMaterialColor(float r, float g, float b) {
     GLfloat ambient[] = { r * 0.4f, g * 0.4f, b * 0.4f, 1.0f };
@@ -60,38 +89,38 @@ void setMaterialColor(float r, float g, float b) {
     GLfloat specular[] = { 0.2f, 0.2f, 0.2f, 1.0f };
     GLfloat shininess[] = { 10.0f };
 
-    glMaterialfv(GL_FRONT, GL_AMBIENT, ambient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, specular);
-    glMaterialfv(GL_FRONT, GL_SHININESS, shininess);
-    glColor3f(r, g, b);
+    GlStateCache& state = glState();
+    state.material(GL_FRONT, GL_AMBIENT, ambient);
+    state.material(GL_FRONT, GL_DIFFUSE, diffuse);
+    state.material(GL_FRONT, GL_SPECULAR, specular);
+    state.material(GL_FRONT, GL_SHININESS, shininess);
+    state.color3f(r, g, b);
 }
 
 void drawCylinder(float baseRadius, float topRadius, float height) {
-    GLUquadricObj *quadric = gluNewQuadric();
-    gluQuadricNormals(quadric, GLU_SMOOTH);
-    gluCylinder(quadric, baseRadius, topRadius, height, 16, 1);
-    gluDeleteQuadric(quadric);
+    drawSolidCylinder(baseRadius, topRadius, height, 16, 1);
 }
 
 void initializeLeaves() {
-    srand(time(0));
+    const uint64_t seed = sceneSeed();
     fallingLeaves.clear();
+    fallingLeaves.seed = (uint32_t)sceneRngKey(seed, RNG_LEAF_RESPAWN, 0);
     for (int i = 0; i < NUM_LEAVES; ++i) {
-        Leaf l;
-        l.x = (rand() % 600) - 300.0f;
-        l.y = (rand() % 400) + 100.0f;
-        l.z = (rand() % 600) - 300.0f;
+        SceneRng rng = sceneRng(seed, RNG_LEAF, i);
+        float x = rng.range(-300.0f, 300.0f);
+        float y = rng.range(100.0f, 500.0f);
+        float z = rng.range(-300.0f, 300.0f);
         
-        float r = static_cast <float> (rand()) / RAND_MAX;
-        if (r < 0.25f) { l.color[0] = 0.8f; l.color[1] = 0.2f; l.color[2] = 0.0f; } 
-        else if (r < 0.50f) { l.color[0] = 1.0f; l.color[1] = 0.5f; l.color[2] = 0.0f; } 
-        else if (r < 0.75f) { l.color[0] = 1.0f; l.color[1] = 1.0f; l.color[2] = 0.0f; } 
-        else { l.color[0] = 0.5f; l.color[1] = 0.3f; l.color[2] = 0.1f; } 
-
-        l.size = 2.0f + (static_cast <float> (rand() % 100) / 100.0f);
-        l.fallSpeed = 0.5f + (static_cast <float> (rand() % 100) / 100.0f);
-        fallingLeaves.push_back(l);
+        float color[3];
+        float r = rng.uniform();
+        if (r < 0.25f) { color[0] = 0.8f; color[1] = 0.2f; color[2] = 0.0f; } 
+        else if (r < 0.50f) { color[0] = 1.0f; color[1] = 0.5f; color[2] = 0.0f; } 
+        else if (r < 0.75f) { color[0] = 1.0f; color[1] = 1.0f; color[2] = 0.0f; } 
+        else { color[0] = 0.5f; color[1] = 0.3f; color[2] = 0.1f; } 
+
+        float size = rng.range(2.0f, 3.0f);
+        float fallSpeed = rng.range(0.5f, 1.5f);
+        fallingLeaves.add(x, y, z, color, size, fallSpeed);
     }
 }
 
@@ -113,7 +142,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     float moveSpeed = isSprinting ? 2.5f : 2.0f;
 
     if(isManMoving) {
-        bobbing = 2.0f * fabs(sin(walkPhase * moveSpeed)); 
+        bobbing = 2.0f * fabs(sin(renderSnapshot.walkPhase * moveSpeed)); 
     }
 
     float crouchLower = 0.0f;
@@ -122,10 +151,10 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     }
 
     glTranslatef(x, y + bobbing - crouchLower, z);
-    glRotatef(manRotationY, 0.0f, 1.0f, 0.0f); 
+    glRotatef(renderSnapshot.manRotationY, 0.0f, 1.0f, 0.0f); 
 
     auto setColor = [&](float r, float g, float b) {
-        if (isShadow) glColor3f(0.0f, 0.0f, 0.0f);
+        if (isShadow) glState().color3f(0.0f, 0.0f, 0.0f);
         else setMaterialColor(r, g, b);
     };
 
@@ -143,8 +172,8 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
         float swingAmp = isSprinting ? 50.0f : 30.0f;
         if (isCrouching) swingAmp = 15.0f; 
 
-        leftHipAngle = swingAmp * sin(walkPhase);
-        rightHipAngle = swingAmp * sin(walkPhase + M_PI);
+        leftHipAngle = swingAmp * sin(renderSnapshot.walkPhase);
+        rightHipAngle = swingAmp * sin(renderSnapshot.walkPhase + M_PI);
         if (leftHipAngle > 0) leftKneeAngle = leftHipAngle * 2.0f;
         if (rightHipAngle > 0) rightKneeAngle = rightHipAngle * 2.0f;
     }
@@ -179,7 +208,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     setColor(0.1f, 0.1f, 0.1f);
     glTranslatef(0.0f, -CALF_LEN, 3.0f);
     glScalef(5.5f, 3.0f, 10.0f);
-    glutSolidCube(1.0f);
+    drawSolidCube(1.0f);
     glPopMatrix(); 
 
     // Right Leg
@@ -203,7 +232,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     setColor(0.1f, 0.1f, 0.1f);
     glTranslatef(0.0f, -CALF_LEN, 3.0f);
     glScalef(5.5f, 3.0f, 10.0f);
-    glutSolidCube(1.0f);
+    drawSolidCube(1.0f);
     glPopMatrix(); 
 
     // Waist
@@ -226,7 +255,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
         glPushMatrix();
         glTranslatef(0.0f, 4.0f, 13.5f); 
         glScalef(5.0f, 4.0f, 1.5f);
-        glutSolidCube(1.0f);
+        drawSolidCube(1.0f);
         glPopMatrix();
     }
 
@@ -240,9 +269,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     drawCylinder(13.0f, 15.0f, TORSO_LEN);
     
     glTranslatef(0.0f, 0.0f, TORSO_LEN);
-    GLUquadricObj *disk = gluNewQuadric();
-    gluDisk(disk, 0.0f, 15.0f, 16, 1);
-    gluDeleteQuadric(disk);
+    drawSolidDisk(15.0f, 16);
     glPopMatrix();
     glPopMatrix(); 
 
@@ -251,14 +278,14 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
         glPushMatrix();
         glTranslatef(0.0f, TORSO_LEN * 0.6f, 12.5f);
         glScalef(22.0f, 4.0f, 1.0f);
-        glutSolidCube(1.0f);
+        drawSolidCube(1.0f);
         glPopMatrix();
         setMaterialColor(1.0f, 0.8f, 0.0f); 
         glPushMatrix();
         glTranslatef(0.0f, TORSO_LEN * 0.6f, 13.5f); 
         glScalef(4.0f, 4.0f, 1.0f);
         glRotatef(45.0f, 0.0f, 0.0f, 1.0f); 
-        glutSolidCube(1.0f);
+        drawSolidCube(1.0f);
         glPopMatrix();
     }
 
@@ -268,7 +295,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     float armSwing = 0.0f;
     if (isManMoving) {
         float armAmp = isSprinting ? 40.0f : 25.0f;
-        armSwing = -armAmp * sin(walkPhase);
+        armSwing = -armAmp * sin(renderSnapshot.walkPhase);
     }
     
     if (isCrouching) {
@@ -286,7 +313,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     glPopMatrix();
     setColor(1.0f, 0.85f, 0.75f);
     glTranslatef(0.0f, -40.0f, 0.0f);
-    glutSolidSphere(4.0f, 10, 10);
+    drawSolidSphere(4.0f, 10, 10);
     glPopMatrix();
 
     glPushMatrix();
@@ -299,7 +326,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
     glPopMatrix();
     setColor(1.0f, 0.85f, 0.75f);
     glTranslatef(0.0f, -40.0f, 0.0f);
-    glutSolidSphere(4.0f, 10, 10);
+    drawSolidSphere(4.0f, 10, 10);
     glPopMatrix();
 
     // Neck
@@ -324,7 +351,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
 
     // Head
     setColor(1.0f, 0.85f, 0.75f);
-    glutSolidSphere(HEAD_SIZE, 16, 16);
+    drawSolidSphere(HEAD_SIZE, 16, 16);
 
     if (!isShadow) {
         // Hair
@@ -332,7 +359,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
         glPushMatrix();
         glTranslatef(0.0f, 4.0f, -1.0f);
         glScalef(1.05f, 0.8f, 1.05f);
-        glutSolidSphere(HEAD_SIZE, 16, 16);
+        drawSolidSphere(HEAD_SIZE, 16, 16);
         glPopMatrix();
 
         // Headphones
@@ -340,45 +367,45 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
         glPushMatrix();
         glTranslatef(0.0f, 1.0f, 0.0f); 
         glScalef(1.0f, 0.9f, 1.0f); 
-        glutSolidTorus(1.0f, 12.0f, 8, 32); 
+        drawSolidTorus(1.0f, 12.0f, 8, 32); 
         glPopMatrix();
         
         setMaterialColor(0.1f, 0.1f, 0.1f);
         glPushMatrix();
         glTranslatef(11.0f, 0.0f, 0.0f);
         glScalef(1.0f, 3.0f, 2.5f);
-        glutSolidSphere(2.5f, 10, 10);
+        drawSolidSphere(2.5f, 10, 10);
         glPopMatrix();
         
         glPushMatrix();
         glTranslatef(-11.0f, 0.0f, 0.0f);
         glScalef(1.0f, 3.0f, 2.5f);
-        glutSolidSphere(2.5f, 10, 10);
+        drawSolidSphere(2.5f, 10, 10);
         glPopMatrix();
 
         // Face
         setMaterialColor(1.0f, 1.0f, 1.0f);
         glPushMatrix();
         glTranslatef(3.5f, 0.0f, 9.0f);
-        glutSolidSphere(2.5f, 8, 8);
+        drawSolidSphere(2.5f, 8, 8);
         setMaterialColor(0.0f, 0.0f, 0.0f);
         glTranslatef(0.0f, 0.0f, 2.1f);
-        glutSolidSphere(1.0f, 8, 8);
+        drawSolidSphere(1.0f, 8, 8);
         glPopMatrix();
 
         setMaterialColor(1.0f, 1.0f, 1.0f);
         glPushMatrix();
         glTranslatef(-3.5f, 0.0f, 9.0f);
-        glutSolidSphere(2.5f, 8, 8);
+        drawSolidSphere(2.5f, 8, 8);
         setMaterialColor(0.0f, 0.0f, 0.0f);
         glTranslatef(0.0f, 0.0f, 2.1f);
-        glutSolidSphere(1.0f, 8, 8);
+        drawSolidSphere(1.0f, 8, 8);
         glPopMatrix();
 
         setMaterialColor(1.0f, 0.8f, 0.7f);
         glPushMatrix();
         glTranslatef(0.0f, -2.0f, 10.0f);
-        glutSolidCone(2.0f, 4.0f, 16, 16);
+        drawSolidCone(2.0f, 4.0f, 16, 16);
         glPopMatrix();
 
         setMaterialColor(0.7f, 0.3f, 0.3f);
@@ -386,7 +413,7 @@ void draw3DMan(float x, float y, float z, bool isShadow) {
         glTranslatef(0.0f, -6.0f, 9.5f);
         glRotatef(10.0f, 0.0f, 0.0f, 1.0f); 
         glScalef(3.0f, 0.8f, 1.0f);
-        glutSolidSphere(1.0f, 10, 10);
+        drawSolidSphere(1.0f, 10, 10);
         glPopMatrix();
     }
 
@@ -404,35 +431,40 @@ void draw3DTree(float x, float z) {
     glPushMatrix();
     glTranslatef(0.0f, 100.0f, 0.0f);
     setMaterialColor(0.8f, 0.4f, 0.0f);
-    glutSolidCone(50.0f, 60.0f, 16, 16);
+    drawSolidCone(50.0f, 60.0f, 16, 16);
     glTranslatef(0.0f, 30.0f, 0.0f);
     setMaterialColor(0.9f, 0.6f, 0.1f);
-    glutSolidCone(50.0f, 60.0f, 16, 16);
+    drawSolidCone(50.0f, 60.0f, 16, 16);
     glPopMatrix();
     glPopMatrix();
 }
 
 void drawFallingLeaves() {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GlStateCache& state = glState();
+    state.enable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glBegin(GL_QUADS);
-    for (const auto& leaf : fallingLeaves) {
-        setMaterialColor(leaf.color[0], leaf.color[1], leaf.color[2]);
-        float currentX = leaf.x + 20.0f * sin(leafDriftSpeed + leaf.z * 0.1f);
-        glVertex3f(currentX, leaf.y, leaf.z);
-        glVertex3f(currentX + leaf.size, leaf.y, leaf.z);
-        glVertex3f(currentX + leaf.size, leaf.y + leaf.size, leaf.z);
-        glVertex3f(currentX, leaf.y + leaf.size, leaf.z);
+    const LeafStore& leaves = fallingLeaves;
+    for (size_t i = 0; i < leaves.count(); ++i) {
+        setMaterialColor(leaves.r[i], leaves.g[i], leaves.b[i]);
+        float x, y, z, rotation;
+        leafSimInterpolate(leaves, i, renderAlpha, x, y, z, rotation);
+        float size = leaves.size[i];
+        glVertex3f(x, y, z);
+        glVertex3f(x + size, y, z);
+        glVertex3f(x + size, y + size, z);
+        glVertex3f(x, y + size, z);
     }
     glEnd();
-    glDisable(GL_BLEND);
+    state.disable(GL_BLEND);
 }
 
 void drawShadow() {
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST); 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GlStateCache& state = glState();
+    state.disable(GL_LIGHTING);
+    state.disable(GL_DEPTH_TEST);
+    state.enable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glPushMatrix();
     GLfloat groundPlane[4] = {0.0f, 1.0f, 0.0f, 0.0f};
     GLfloat shadowMat[16];
@@ -454,16 +486,17 @@ void drawShadow() {
     shadowMat[11] = 0.0f - lightPos[3] * groundPlane[2];
     shadowMat[15] = dot - lightPos[3] * groundPlane[3];
     glMultMatrixf(shadowMat);
-    draw3DMan(manPositionX, 0.1f, manPositionZ, true);
+    draw3DMan(renderSnapshot.manX, 0.1f, renderSnapshot.manZ, true);
     glPopMatrix();
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    glDisable(GL_BLEND);
+    state.enable(GL_DEPTH_TEST);
+    state.enable(GL_LIGHTING);
+    state.disable(GL_BLEND);
 }
 
 void initialize() {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
+    glEnable(GL_NORMALIZE); // Cached meshes are scaled by the modelview matrix
     glClearColor(0.7f, 0.85f, 1.0f, 1.0f);
     glEnable(GL_LIGHTING);
     glEnable(GL_LIGHT0);
@@ -474,9 +507,13 @@ void initialize() {
     glLightfv(GL_LIGHT0, GL_DIFFUSE, lightDiff);
     glEnable(GL_COLOR_MATERIAL);
     initializeLeaves();
+    previousSnapshot = captureSnapshot();
 }
 
-void renderScene() {
+void drawScene() {
+    renderSnapshot = blendSnapshots(previousSnapshot, captureSnapshot(), renderAlpha);
+    glState().beginFrame();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
@@ -492,19 +529,27 @@ void renderScene() {
     draw3DTree(150.0f, -100.0f);
     draw3DTree(-150.0f, 50.0f);
     drawShadow();
-    draw3DMan(manPositionX, 0.0f, manPositionZ, false);
+    draw3DMan(renderSnapshot.manX, 0.0f, renderSnapshot.manZ, false);
     drawFallingLeaves();
-    glutSwapBuffers();
 }
 
-void updateScene(int value) {
-    for (auto& leaf : fallingLeaves) {
-        leaf.y -= leaf.fallSpeed;
-        if (leaf.y < 0) {
-            leaf.y = 500.0f; leaf.x = (rand() % 600) - 300.0f; leaf.z = (rand() % 600) - 300.0f;
-        }
+void renderScene() {
+    drawScene();
+    glutSwapBuffers();
+
+    if (simClock.frameRendered()) {
+        char title[160];
+        simClock.formatTitle(title, sizeof(title), WINDOW_TITLE);
+        glutSetWindowTitle(title);
     }
+}
+
+// One fixed simulation tick
+void stepScene() {
+    previousSnapshot = captureSnapshot();
     leafDriftSpeed += 0.02f;
+    LeafSimParams leafParams = { leafDriftSpeed, 20.0f, 0.0f, 0.0f, 0.0f };
+    leafSimStep(fallingLeaves, leafParams, LEAF_SPAWN);
 
     float dx = 0.0f;
     float dz = 0.0f;
@@ -532,9 +577,16 @@ void updateScene(int value) {
         isManMoving = false;
         if (walkPhase > 0.0f) walkPhase = 0.0f; 
     }
+}
 
+// Runs whatever simulation ticks are due, then asks for a new frame right away
+void idleScene() {
+    int steps = simClock.advance();
+    for (int i = 0; i < steps; ++i) {
+        stepScene();
+    }
+    renderAlpha = simClock.alpha();
     glutPostRedisplay();
-    glutTimerFunc(16, updateScene, 0);
 }
 
 // Helper to normalize keys (Convert Ctrl+Codes and Uppercase to lowercase)
@@ -556,6 +608,10 @@ void keyboardDown(unsigned char key, int x, int y) {
     key = normalizeKey(key);
     keyStates[key] = true; 
     if (key == 27) exit(0); 
+    if (key == 'c') {
+        cout << "--- GL state calls (last frame) ---" << endl;
+        glStatePrintFrame(cout);
+    }
     updateModifiers();
 }
 
@@ -593,15 +649,26 @@ void reshape(int w, int h) {
 }
 
 int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-    glutCreateWindow("Realistic Man - Crouch & Sprint");
-    
-    // Prevent OS key repeat from spamming events
-    glutIgnoreKeyRepeat(1); 
+    benchParseArgs(argc, argv);
+    sceneRngParseArgs(argc, argv, benchEnabled() ? SCENE_BENCH_SEED : (uint64_t)time(0));
+    if (!benchCreateHeadlessContext(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+        glutCreateWindow(WINDOW_TITLE);
+        
+        // Prevent OS key repeat from spamming events
+        glutIgnoreKeyRepeat(1); 
+    }
     
     initialize();
+
+    if (benchEnabled()) {
+        reshape(WINDOW_WIDTH, WINDOW_HEIGHT);
+        benchReportWriter() = glStateWriteReport;
+        return benchRun("autumn_scene", stepScene, drawScene, glutSwapBuffers);
+    }
+
     glutDisplayFunc(renderScene);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboardDown);
@@ -609,7 +676,9 @@ int main(int argc, char** argv) {
     glutSpecialFunc(specialKeyInput);
     glutMouseFunc(mouseInput);
     glutMotionFunc(mouseMove);
-    glutTimerFunc(16, updateScene, 0);
+    glutIdleFunc(idleScene);
+
+    cout << "Scene seed: " << sceneSeed() << " (replay with --seed)" << endl;
     glutMainLoop();
     return 0;
 }
@@ -0,0 +1,254 @@
+#ifndef CLOUD_BATCH_H
+#define CLOUD_BATCH_H
+
+// --- Cloud Batch ---
+// Every cloud is the same cluster of CLOUD_PUFFS spheres: puff centres sit
+// at fixed offsets from the cloud centre in units of the cloud's size, and
+// puff radii are further scaled by its density. The cluster is tessellated
+// once per LOD level with each vertex split into its puff centre, its unit
+// direction from that centre and the puff radius, so placing a cloud is one
+// multiply-add per vertex. All clouds of a frame are expanded into a single
+// indexed vertex array and drawn with one call, whatever their count.
+//
+// Optionally, clouds at spriteLevel or coarser are drawn as sprites instead:
+// one camera-facing quad per puff with a soft round alpha texture, again all
+// in one call.
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "lod.h"
+#include "mesh_cache.h"
+
+struct CloudPuff {
+    float offset[3]; // From the cloud centre, in units of the cloud's size
+    float radius;    // In units of size * density
+    int segments;    // Slices and stacks at level 0
+};
+
+const int CLOUD_PUFFS = 6;
+const CloudPuff CLOUD_LAYOUT[CLOUD_PUFFS] = {
+    { {  0.0f,  0.0f,  0.0f  }, 1.0f,  20 },
+    { {  0.6f,  0.15f, 0.1f  }, 0.85f, 18 },
+    { { -0.7f,  0.25f, -0.1f }, 0.75f, 16 },
+    { {  0.0f, -0.1f,  0.25f }, 0.65f, 14 },
+    { {  0.0f,  0.15f, -0.45f }, 0.55f, 12 },
+    { { -0.3f, -0.05f, -0.05f }, 0.4f, 10 },
+};
+
+// Cloud colour for a density; thinner clouds are greyer
+inline void cloudColor(float density, float color[3]) {
+    color[0] = 0.95f - (1.0f - density) * 0.15f;
+    color[1] = 0.93f - (1.0f - density) * 0.15f;
+    color[2] = 0.90f - (1.0f - density) * 0.10f;
+}
+
+struct CloudBatch {
+    // One LOD level of the puff cluster
+    struct Prototype {
+        std::vector<float> vertices;        // Puff centre xyz, unit direction xyz, radius
+        std::vector<unsigned int> indices;  // GL_TRIANGLES
+        static const int FLOATS_PER_VERTEX = 7;
+
+        size_t vertexCount() const { return vertices.size() / FLOATS_PER_VERTEX; }
+    };
+
+    Prototype prototypes[LOD_LEVELS];
+    int spriteLevel = LOD_LEVELS; // Clouds at this level or coarser become sprites; LOD_LEVELS: never
+    GLuint spriteTexture = 0;
+
+    std::vector<float> vertices;       // Interleaved position, normal, color
+    std::vector<unsigned int> indices;
+    std::vector<float> sprites;        // Interleaved position, texcoord, color; four per quad
+    static const int FLOATS_PER_VERTEX = 9;
+    static const int FLOATS_PER_SPRITE_VERTEX = 9;
+
+    int meshClouds = 0;   // Drawn in the last frame
+    int spriteClouds = 0;
+    long long trianglesDrawn = 0; // Last frame
+
+    // Tessellates every level and creates the sprite texture
+    void build() {
+        for (int level = 0; level < LOD_LEVELS; ++level) {
+            Prototype& prototype = prototypes[level];
+            prototype.vertices.clear();
+            prototype.indices.clear();
+            for (const CloudPuff& puff : CLOUD_LAYOUT) {
+                int segments = lodSegments(puff.segments, level, 6);
+                const Mesh& sphere = getPrimitiveMesh(MESH_SPHERE, segments, lodSegments(puff.segments, level, 4), 0.0f);
+                unsigned int base = (unsigned int)prototype.vertexCount();
+                for (size_t v = 0; v < sphere.vertexCount(); ++v) {
+                    const float* n = &sphere.normals[v * 3];
+                    const float data[Prototype::FLOATS_PER_VERTEX] = {
+                        puff.offset[0], puff.offset[1], puff.offset[2], n[0], n[1], n[2], puff.radius
+                    };
+                    prototype.vertices.insert(prototype.vertices.end(), data, data + Prototype::FLOATS_PER_VERTEX);
+                }
+                for (unsigned int index : sphere.indices) prototype.indices.push_back(base + index);
+            }
+        }
+        buildSpriteTexture();
+    }
+
+    // Starts a frame; the sprites face the camera in the current modelview matrix
+    void begin() {
+        vertices.clear();
+        indices.clear();
+        sprites.clear();
+        meshClouds = spriteClouds = 0;
+        GLfloat modelview[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+        for (int i = 0; i < 3; ++i) {
+            right[i] = modelview[i * 4];
+            up[i] = modelview[i * 4 + 1];
+        }
+    }
+
+    void add(float x, float y, float z, float size, float density, int level) {
+        float color[3];
+        cloudColor(density, color);
+        if (level >= spriteLevel) {
+            addSprite(x, y, z, size, density, color);
+            return;
+        }
+
+        const Prototype& prototype = prototypes[level];
+        unsigned int base = (unsigned int)(vertices.size() / FLOATS_PER_VERTEX);
+        size_t first = vertices.size();
+        vertices.resize(first + prototype.vertexCount() * FLOATS_PER_VERTEX);
+        float* out = &vertices[first];
+        const float* in = prototype.vertices.data();
+        for (size_t v = 0; v < prototype.vertexCount(); ++v, in += Prototype::FLOATS_PER_VERTEX, out += FLOATS_PER_VERTEX) {
+            float radius = size * density * in[6];
+            out[0] = x + size * in[0] + radius * in[3];
+            out[1] = y + size * in[1] + radius * in[4];
+            out[2] = z + size * in[2] + radius * in[5];
+            out[3] = in[3]; out[4] = in[4]; out[5] = in[5];
+            out[6] = color[0]; out[7] = color[1]; out[8] = color[2];
+        }
+        for (unsigned int index : prototype.indices) indices.push_back(base + index);
+        ++meshClouds;
+    }
+
+    // Meshes are lit with the current material's specular and the vertex
+    // colors as ambient and diffuse (GL_COLOR_MATERIAL); sprites are unlit
+    void draw() {
+        trianglesDrawn = (long long)(indices.size() / 3);
+        meshTrianglesDrawn() += trianglesDrawn;
+        if (!indices.empty()) {
+            const GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glEnableClientState(GL_NORMAL_ARRAY);
+            glEnableClientState(GL_COLOR_ARRAY);
+            glVertexPointer(3, GL_FLOAT, stride, vertices.data());
+            glNormalPointer(GL_FLOAT, stride, vertices.data() + 3);
+            glColorPointer(3, GL_FLOAT, stride, vertices.data() + 6);
+            glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, indices.data());
+            countDraw(DRAW_CALLS);
+            countDraw(DRAW_VERTICES, (long long)indices.size());
+            glDisableClientState(GL_COLOR_ARRAY);
+            glDisableClientState(GL_NORMAL_ARRAY);
+            glDisableClientState(GL_VERTEX_ARRAY);
+        }
+        if (!sprites.empty()) drawSprites();
+    }
+
+private:
+    float right[3] = { 1.0f, 0.0f, 0.0f };
+    float up[3] = { 0.0f, 1.0f, 0.0f };
+
+    // One quad per puff, sized so the texture's soft edge matches the sphere
+    void addSprite(float x, float y, float z, float size, float density, const float color[3]) {
+        static const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        for (const CloudPuff& puff : CLOUD_LAYOUT) {
+            float cx = x + size * puff.offset[0];
+            float cy = y + size * puff.offset[1];
+            float cz = z + size * puff.offset[2];
+            float half = size * density * puff.radius * 1.25f;
+            for (int c = 0; c < 4; ++c) {
+                float u = corners[c][0] * half, v = corners[c][1] * half;
+                const float data[FLOATS_PER_SPRITE_VERTEX] = {
+                    cx + u * right[0] + v * up[0], cy + u * right[1] + v * up[1], cz + u * right[2] + v * up[2],
+                    corners[c][0] * 0.5f + 0.5f, corners[c][1] * 0.5f + 0.5f,
+                    color[0], color[1], color[2], 1.0f
+                };
+                sprites.insert(sprites.end(), data, data + FLOATS_PER_SPRITE_VERTEX);
+            }
+        }
+        ++spriteClouds;
+    }
+
+    void drawSprites() {
+        glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+        glDisable(GL_LIGHTING);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, spriteTexture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        glEnable(GL_BLEND);
+        countDraw(DRAW_TEXTURE_BINDS);
+        countDraw(DRAW_BLEND_TOGGLES);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+
+        const GLsizei stride = FLOATS_PER_SPRITE_VERTEX * sizeof(float);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(3, GL_FLOAT, stride, sprites.data());
+        glTexCoordPointer(2, GL_FLOAT, stride, sprites.data() + 3);
+        glColorPointer(4, GL_FLOAT, stride, sprites.data() + 5);
+        glDrawArrays(GL_QUADS, 0, (GLsizei)(sprites.size() / FLOATS_PER_SPRITE_VERTEX));
+        countDraw(DRAW_CALLS);
+        countDraw(DRAW_VERTICES, (long long)(sprites.size() / FLOATS_PER_SPRITE_VERTEX));
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+
+        glPopAttrib();
+    }
+
+    // Alpha-only disc that is opaque in the middle and fades out towards the rim
+    void buildSpriteTexture() {
+        const int SIZE = 64;
+        std::vector<unsigned char> alpha(SIZE * SIZE);
+        for (int j = 0; j < SIZE; ++j) {
+            for (int i = 0; i < SIZE; ++i) {
+                float dx = (i + 0.5f) / SIZE * 2.0f - 1.0f;
+                float dy = (j + 0.5f) / SIZE * 2.0f - 1.0f;
+                float r = sqrtf(dx * dx + dy * dy);
+                float a = r < 0.6f ? 1.0f : (r < 1.0f ? 1.0f - (r - 0.6f) / 0.4f : 0.0f);
+                alpha[j * SIZE + i] = (unsigned char)(a * a * (3.0f - 2.0f * a) * 255.0f + 0.5f);
+            }
+        }
+        if (spriteTexture == 0) glGenTextures(1, &spriteTexture);
+        glBindTexture(GL_TEXTURE_2D, spriteTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, SIZE, SIZE, 0, GL_ALPHA, GL_UNSIGNED_BYTE, alpha.data());
+    }
+};
+
+// Consumes --clouds <n> and --cloud-sprites from argv so GLUT never sees them
+inline void cloudParseArgs(int& argc, char** argv, int& count, bool& sprites) {
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--clouds") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+            if (count < 0) count = 0;
+        } else if (strcmp(argv[i], "--cloud-sprites") == 0) {
+            sprites = true;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+}
+
+#endif // CLOUD_BATCH_H
@@ -0,0 +1,164 @@
+#ifndef DRAW_COUNTERS_H
+#define DRAW_COUNTERS_H
+
+// --- Draw Counters ---
+// How much work reaches the driver per frame: draw calls (glBegin blocks
+// among them), vertices, cached GLU/GLUT-style primitives, matrix pushes,
+// and the material, texture and blend state changes the state cache lets
+// through. The code that issues the GL call counts it; counts go to the
+// section the calling thread is in (the frame profiler sets it for every
+// ProfileScope, the render queue per item) or to "other" outside any.
+//
+// The frame profiler turns counting on while it runs, and the scene may
+// turn it on by itself (benchmarks count without timing). Otherwise a count
+// is one branch. Only the GL thread counts.
+
+#include <cstdio>
+#include <vector>
+
+enum DrawCounterKind {
+    DRAW_CALLS,            // glCallList, glDrawArrays, glDrawElements and glBegin blocks
+    DRAW_BEGIN_BLOCKS,     // glBegin/glEnd pairs alone
+    DRAW_VERTICES,         // Vertices (indices for indexed draws) submitted
+    DRAW_PRIMITIVES,       // Cached meshes standing in for glutSolid*/gluCylinder/gluDisk
+    DRAW_MATRIX_PUSHES,    // glPushMatrix/glPopMatrix pairs
+    DRAW_MATERIAL_CHANGES, // glMaterial calls issued
+    DRAW_TEXTURE_BINDS,    // glBindTexture calls issued
+    DRAW_BLEND_TOGGLES,    // GL_BLEND enabled or disabled
+    DRAW_COUNTER_KIND_COUNT
+};
+
+const char* const DRAW_COUNTER_NAMES[DRAW_COUNTER_KIND_COUNT] = {
+    "draw_calls", "begin_blocks", "vertices", "primitives", "matrix_pushes", "material_changes",
+    "texture_binds", "blend_toggles"
+};
+
+struct DrawCounts {
+    long long value[DRAW_COUNTER_KIND_COUNT] = {};
+
+    DrawCounts& operator+=(const DrawCounts& other) {
+        for (int i = 0; i < DRAW_COUNTER_KIND_COUNT; ++i) value[i] += other.value[i];
+        return *this;
+    }
+};
+
+class DrawCounters {
+public:
+    // One bucket per section plus "other"
+    void init(const std::vector<const char*>& sectionNames) {
+        names = sectionNames;
+        frame.assign(names.size() + 1, DrawCounts());
+        last = totals = frame;
+        frames = 0;
+    }
+
+    // Switching on starts a fresh frame
+    void setEnabled(bool on) {
+        if (on && !enabled) frame.assign(frame.size(), DrawCounts());
+        enabled = on && !frame.empty();
+    }
+
+    bool active() const { return enabled; }
+
+    void add(DrawCounterKind kind, long long count = 1) {
+        if (!enabled) return;
+        frame[currentSection() + 1].value[kind] += count;
+    }
+
+    // Section the calling thread's counts go to; -1: other
+    static int& currentSection() {
+        static thread_local int section = -1;
+        return section;
+    }
+
+    // Counts of the frame so far, all sections together
+    DrawCounts frameTotal() const {
+        DrawCounts sum;
+        for (const DrawCounts& counts : frame) sum += counts;
+        return sum;
+    }
+
+    void endFrame() {
+        if (!enabled) return;
+        for (size_t i = 0; i < frame.size(); ++i) totals[i] += frame[i];
+        last.swap(frame);
+        frame.assign(last.size(), DrawCounts());
+        ++frames;
+    }
+
+    // Drops the frames counted so far, e.g. benchmark warmup
+    void resetTotals() {
+        totals.assign(totals.size(), DrawCounts());
+        frames = 0;
+    }
+
+    // Last completed frame; section -1 is other
+    const DrawCounts& lastFrame(int section) const { return last[section + 1]; }
+
+    DrawCounts lastFrameTotal() const {
+        DrawCounts sum;
+        for (const DrawCounts& counts : last) sum += counts;
+        return sum;
+    }
+
+    // Per-frame means over the frames since the last reset, for the benchmark JSON;
+    // sections that never counted anything are left out
+    void writeReport(FILE* out) const {
+        double n = frames > 0 ? (double)frames : 1.0;
+        DrawCounts sum;
+        for (const DrawCounts& counts : totals) sum += counts;
+        fprintf(out, "  \"draw_counters\": {\"frames\": %lld, \"per_frame\": ", frames);
+        writeCounts(out, sum, n);
+        fprintf(out, ", \"sections\": {");
+        bool first = true;
+        for (size_t i = 0; i < totals.size(); ++i) {
+            bool any = false;
+            for (long long value : totals[i].value) any = any || value != 0;
+            if (!any) continue;
+            fprintf(out, "%s\n    \"%s\": ", first ? "" : ",", i == 0 ? "other" : names[i - 1]);
+            writeCounts(out, totals[i], n);
+            first = false;
+        }
+        fprintf(out, "\n  }}");
+    }
+
+private:
+    bool enabled = false;
+    std::vector<const char*> names;
+    std::vector<DrawCounts> frame, last, totals; // [0] is other
+    long long frames = 0;
+
+    static void writeCounts(FILE* out, const DrawCounts& counts, double frames) {
+        fprintf(out, "{");
+        for (int k = 0; k < DRAW_COUNTER_KIND_COUNT; ++k) {
+            fprintf(out, "%s\"%s\": %.2f", k ? ", " : "", DRAW_COUNTER_NAMES[k], counts.value[k] / frames);
+        }
+        fprintf(out, "}");
+    }
+};
+
+inline DrawCounters& drawCounters() {
+    static DrawCounters counters;
+    return counters;
+}
+
+inline void countDraw(DrawCounterKind kind, long long count = 1) {
+    drawCounters().add(kind, count);
+}
+
+// Charges the calling thread's counts to 'section' until destroyed
+class DrawCounterSection {
+public:
+    explicit DrawCounterSection(int section) : previous(DrawCounters::currentSection()) {
+        DrawCounters::currentSection() = section;
+    }
+    ~DrawCounterSection() { DrawCounters::currentSection() = previous; }
+
+    DrawCounterSection(const DrawCounterSection&) = delete;
+    DrawCounterSection& operator=(const DrawCounterSection&) = delete;
+
+private:
+    int previous;
+};
+
+#endif // DRAW_COUNTERS_H
@@ -0,0 +1,394 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+// --- Frame Profiler ---
+// Per-section CPU and GPU times for every frame. The scene lists its
+// sections (render passes, simulation systems) up front and wraps each one
+// in a ProfileScope; the CPU side is a steady_clock interval, the GPU side a
+// GL_TIME_ELAPSED query around the GL calls the section issues.
+//
+// GPU queries cannot nest, so only sections marked 'gpu' get one, and only
+// when no other query is open. Results are read back FRAME_PROFILER_LATENCY
+// frames later, when the GPU has long finished with them, so the readback
+// never stalls the pipeline; a frame's row is complete once its queries are
+// in. Sections can also charge GPU time directly (beginGpu/endGpu), which is
+// how the render queue bills its sorted submission to the passes that
+// recorded the items.
+//
+// Timer queries need GL 3.3, GL_ARB_timer_query or GL_EXT_timer_query and
+// are loaded at runtime; without them only CPU times are reported.
+//
+// CPU scopes may run on job system threads as long as no section is timed
+// on two threads at once. Everything else, GPU scopes included, belongs to
+// the GL thread. While tracing is on (trace_events.h) every scope is also a
+// trace event named after its section. With both off a scope costs two
+// branches.
+//
+// While the profiler runs it also turns on the draw counters
+// (draw_counters.h). Whenever they are on, scopes charge them to the
+// innermost open section, and every profiled frame row carries its totals.
+//
+// GPU queries are not free: on software rasterizers such as llvmpipe they
+// pull rasterization into the section that ends the query, which inflates
+// the frame's CPU time. Benchmarks therefore only profile when asked to.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "draw_counters.h"
+#include "gl_extensions.h"
+#include "trace_events.h"
+
+const GLenum PROFILER_TIME_ELAPSED = 0x88BF; // GL_TIME_ELAPSED
+const GLenum PROFILER_QUERY_RESULT = 0x8866; // GL_QUERY_RESULT
+const int FRAME_PROFILER_LATENCY = 4;        // Frames between a query and its readback
+const int FRAME_PROFILER_HISTORY = 60;       // Frames the rolling averages cover
+
+struct ProfileSectionDesc {
+    const char* name;
+    bool gpu;  // Timed with a GPU query as well
+    int depth; // 0: part of the frame, 1: part of the depth-0 section before it
+};
+
+// One finished frame
+struct ProfileFrame {
+    long long index;
+    double frameMs;          // Between the ends of this frame and the previous one
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs; // Negative: the section had no GPU time this frame
+    DrawCounts draw;           // All sections together
+};
+
+class FrameProfiler {
+public:
+    // Sections in the order the HUD and the CSV list them
+    void init(const ProfileSectionDesc* descs, int count) {
+        sections.assign(descs, descs + count);
+        for (Pending& slot : pending) slot.reset(count);
+        totalCpuMs.assign(count, 0.0);
+        totalGpuMs.assign(count, 0.0);
+        gpuFrames.assign(count, 0);
+        history.clear();
+        lastFrameEnd = Clock::now();
+        std::vector<const char*> names;
+        for (const ProfileSectionDesc& desc : sections) names.push_back(desc.name);
+        drawCounters().init(names);
+    }
+
+    int sectionCount() const { return (int)sections.size(); }
+    const ProfileSectionDesc& section(int i) const { return sections[i]; }
+
+    bool active() const { return enabled; }
+
+    // Starts or stops recording; stopping resolves the frames still waiting for the GPU
+    void setActive(bool on) {
+        if (on == enabled) return;
+        if (!on) flush();
+        enabled = on;
+        drawCounters().setEnabled(on);
+        if (on) {
+            initGpu();
+            pending[current].reset(sectionCount());
+            lastFrameEnd = Clock::now();
+        }
+    }
+
+    bool gpuTiming() const { return gpu.available; }
+
+    // Rows go to 'path' as they complete; false if it cannot be opened
+    bool openCsv(const char* path) {
+        closeCsv();
+        csv = fopen(path, "w");
+        if (!csv) return false;
+        fprintf(csv, "frame,frame_ms");
+        for (const ProfileSectionDesc& desc : sections) {
+            fprintf(csv, ",%s_cpu_ms", desc.name);
+            if (desc.gpu) fprintf(csv, ",%s_gpu_ms", desc.name);
+        }
+        for (const char* name : DRAW_COUNTER_NAMES) fprintf(csv, ",%s", name);
+        fprintf(csv, "\n");
+        return true;
+    }
+
+    void closeCsv() {
+        if (csv) fclose(csv);
+        csv = nullptr;
+    }
+
+    ~FrameProfiler() { closeCsv(); }
+
+    // --- Recording ---
+
+    void addCpu(int section, double ms) { pending[current].cpuMs[section] += ms; }
+
+    // Opens a GPU query charged to 'section'; false (and nothing to end) when
+    // GPU timing is off or another query is open
+    bool beginGpu(int section) {
+        if (!enabled || !gpu.available || gpuOpen) return false;
+        Pending& slot = pending[current];
+        if (slot.used == slot.queries.size()) {
+            GLuint query = 0;
+            gpu.genQueries(1, &query);
+            slot.queries.push_back(query);
+            slot.querySections.push_back(section);
+        }
+        slot.querySections[slot.used] = section;
+        gpu.beginQuery(PROFILER_TIME_ELAPSED, slot.queries[slot.used++]);
+        gpuOpen = true;
+        return true;
+    }
+
+    void endGpu() {
+        gpu.endQuery(PROFILER_TIME_ELAPSED);
+        gpuOpen = false;
+    }
+
+    // Closes the current frame and completes the one FRAME_PROFILER_LATENCY
+    // frames back; closes the draw counters' frame either way
+    void endFrame() {
+        DrawCounts draw = drawCounters().frameTotal();
+        drawCounters().endFrame();
+        if (!enabled) return;
+        if (gpuOpen) endGpu();
+        Clock::time_point now = Clock::now();
+        Pending& slot = pending[current];
+        slot.index = frameIndex++;
+        slot.frameMs = std::chrono::duration<double, std::milli>(now - lastFrameEnd).count();
+        slot.waiting = true;
+        slot.draw = draw;
+        lastFrameEnd = now;
+
+        current = (current + 1) % FRAME_PROFILER_LATENCY;
+        if (pending[current].waiting) resolve(pending[current]);
+        pending[current].reset(sectionCount());
+    }
+
+    // Completes every frame still waiting for its GPU results
+    void flush() {
+        if (!enabled) return;
+        for (int i = 1; i <= FRAME_PROFILER_LATENCY; ++i) {
+            Pending& slot = pending[(current + i) % FRAME_PROFILER_LATENCY];
+            if (slot.waiting) resolve(slot);
+        }
+        if (csv) fflush(csv);
+    }
+
+    // --- Results ---
+
+    // Completed frames, oldest first, at most FRAME_PROFILER_HISTORY
+    const std::vector<ProfileFrame>& recentFrames() const { return history; }
+    long long framesCompleted() const { return completed; }
+
+    // Means per frame over recentFrames(); gpuMs is negative for sections
+    // never timed on the GPU
+    void average(double& frameMs, std::vector<double>& cpuMs, std::vector<double>& gpuMs) const {
+        frameMs = 0.0;
+        cpuMs.assign(sectionCount(), 0.0);
+        gpuMs.assign(sectionCount(), 0.0);
+        std::vector<int> timed(sectionCount(), 0);
+        for (const ProfileFrame& frame : history) {
+            frameMs += frame.frameMs;
+            for (int i = 0; i < sectionCount(); ++i) {
+                cpuMs[i] += frame.cpuMs[i];
+                if (frame.gpuMs[i] >= 0.0) { gpuMs[i] += frame.gpuMs[i]; ++timed[i]; }
+            }
+        }
+        double frames = history.empty() ? 1.0 : (double)history.size();
+        frameMs /= frames;
+        for (int i = 0; i < sectionCount(); ++i) {
+            cpuMs[i] /= frames;
+            gpuMs[i] = timed[i] ? gpuMs[i] / frames : -1.0;
+        }
+    }
+
+    // Mean CPU and GPU ms per section over every completed frame, for the benchmark JSON
+    void writeReport(FILE* out) const {
+        double frames = completed > 0 ? (double)completed : 1.0;
+        fprintf(out, "  \"profile\": {\"gpu_timing\": %s, \"frames\": %lld, \"sections\": {",
+                gpu.available ? "true" : "false", completed);
+        for (int i = 0; i < sectionCount(); ++i) {
+            fprintf(out, "%s\n    \"%s\": {\"cpu_ms\": %.4f, \"gpu_ms\": ", i ? "," : "", sections[i].name,
+                    totalCpuMs[i] / frames);
+            if (gpuFrames[i] > 0) fprintf(out, "%.4f}", totalGpuMs[i] / frames);
+            else fprintf(out, "null}");
+        }
+        fprintf(out, "\n  }}");
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    typedef void (APIENTRY* GenQueriesFn)(GLsizei n, GLuint* ids);
+    typedef void (APIENTRY* BeginQueryFn)(GLenum target, GLuint id);
+    typedef void (APIENTRY* EndQueryFn)(GLenum target);
+    typedef void (APIENTRY* GetQueryObjectui64vFn)(GLuint id, GLenum name, uint64_t* value);
+
+    struct GpuTimer {
+        bool probed = false;
+        bool available = false;
+        GenQueriesFn genQueries = nullptr;
+        BeginQueryFn beginQuery = nullptr;
+        EndQueryFn endQuery = nullptr;
+        GetQueryObjectui64vFn getResult = nullptr;
+    };
+
+    // A frame waiting for its GPU results; queries are reused frame after frame
+    struct Pending {
+        bool waiting = false;
+        long long index = 0;
+        double frameMs = 0.0;
+        std::vector<double> cpuMs;
+        DrawCounts draw;
+        std::vector<GLuint> queries;
+        std::vector<int> querySections;
+        size_t used = 0;
+
+        void reset(int sections) {
+            waiting = false;
+            cpuMs.assign(sections, 0.0);
+            used = 0;
+        }
+    };
+
+    std::vector<ProfileSectionDesc> sections;
+    bool enabled = false;
+    GpuTimer gpu;
+    bool gpuOpen = false;
+    Pending pending[FRAME_PROFILER_LATENCY];
+    int current = 0;
+    long long frameIndex = 0;
+    Clock::time_point lastFrameEnd;
+
+    std::vector<ProfileFrame> history;
+    long long completed = 0;
+    std::vector<double> totalCpuMs, totalGpuMs;
+    std::vector<long long> gpuFrames;
+    FILE* csv = nullptr;
+
+    // Needs the context; looked up once, the first time the profiler is switched on
+    void initGpu() {
+        if (gpu.probed) return;
+        gpu.probed = true;
+        bool core = glVersionAtLeast(3, 3) || glHasExtension("GL_ARB_timer_query");
+        if (!core && !glHasExtension("GL_EXT_timer_query")) return;
+
+        gpu.genQueries = (GenQueriesFn)glProcAddress("glGenQueries");
+        gpu.beginQuery = (BeginQueryFn)glProcAddress("glBeginQuery");
+        gpu.endQuery = (EndQueryFn)glProcAddress("glEndQuery");
+        gpu.getResult = (GetQueryObjectui64vFn)glProcAddress(core ? "glGetQueryObjectui64v" : "glGetQueryObjectui64vEXT");
+        gpu.available = gpu.genQueries && gpu.beginQuery && gpu.endQuery && gpu.getResult;
+        if (getenv("PROFILER_NO_GPU")) gpu.available = false;
+    }
+
+    void resolve(Pending& slot) {
+        ProfileFrame frame;
+        frame.index = slot.index;
+        frame.frameMs = slot.frameMs;
+        frame.cpuMs = slot.cpuMs;
+        frame.draw = slot.draw;
+        frame.gpuMs.assign(sectionCount(), -1.0);
+        for (size_t q = 0; q < slot.used; ++q) {
+            uint64_t nanoseconds = 0;
+            gpu.getResult(slot.queries[q], PROFILER_QUERY_RESULT, &nanoseconds);
+            double& ms = frame.gpuMs[slot.querySections[q]];
+            ms = std::max(ms, 0.0) + nanoseconds * 1e-6;
+        }
+        slot.waiting = false;
+
+        ++completed;
+        for (int i = 0; i < sectionCount(); ++i) {
+            totalCpuMs[i] += frame.cpuMs[i];
+            if (frame.gpuMs[i] >= 0.0) { totalGpuMs[i] += frame.gpuMs[i]; ++gpuFrames[i]; }
+        }
+        if (csv) writeCsvRow(frame);
+        if (history.size() == (size_t)FRAME_PROFILER_HISTORY) history.erase(history.begin());
+        history.push_back(frame);
+    }
+
+    void writeCsvRow(const ProfileFrame& frame) {
+        fprintf(csv, "%lld,%.4f", frame.index, frame.frameMs);
+        for (int i = 0; i < sectionCount(); ++i) {
+            fprintf(csv, ",%.4f", frame.cpuMs[i]);
+            if (!sections[i].gpu) continue;
+            if (frame.gpuMs[i] >= 0.0) fprintf(csv, ",%.4f", frame.gpuMs[i]);
+            else fprintf(csv, ",");
+        }
+        for (long long count : frame.draw.value) fprintf(csv, ",%lld", count);
+        fprintf(csv, "\n");
+    }
+};
+
+inline FrameProfiler& frameProfiler() {
+    static FrameProfiler profiler;
+    return profiler;
+}
+
+// Times the enclosing block as 'section', on the GPU too if the section asks
+// for it. Sections whose GL work is submitted elsewhere (queued passes) pass
+// timeGpu = false and are charged by whoever submits it.
+class ProfileScope {
+public:
+    explicit ProfileScope(int section, bool timeGpu = true) : section(section) {
+        FrameProfiler& profiler = frameProfiler();
+        profiling = profiler.active();
+        tracing = traceEnabled();
+        counting = drawCounters().active();
+        if (counting) {
+            drawSection = DrawCounters::currentSection();
+            DrawCounters::currentSection() = section;
+        }
+        if (!profiling && !tracing) return;
+        gpuOpen = profiling && timeGpu && profiler.section(section).gpu && profiler.beginGpu(section);
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~ProfileScope() {
+        if (counting) DrawCounters::currentSection() = drawSection;
+        if (!profiling && !tracing) return;
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        FrameProfiler& profiler = frameProfiler();
+        if (profiling) profiler.addCpu(section, std::chrono::duration<double, std::milli>(end - start).count());
+        if (gpuOpen) profiler.endGpu();
+        if (tracing) traceLog().complete(profiler.section(section).name, "section", start, end);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    int section;
+    bool profiling = false;
+    bool tracing = false;
+    bool counting = false;
+    bool gpuOpen = false;
+    int drawSection = -1; // Section the draw counters return to
+    std::chrono::steady_clock::time_point start;
+};
+
+// --- Command Line ---
+
+// Consumes --profile (profile from the first frame) and --profile-csv
+// <path> from argv so GLUT never sees them
+inline void profilerParseArgs(int& argc, char** argv, std::string& csvPath, bool& profile) {
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+}
+
+#endif // FRAME_PROFILER_H
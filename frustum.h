@@ -0,0 +1,163 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+// --- View Frustum Culling ---
+// Six planes taken from projection * modelview (Gribb/Hartmann) and sphere
+// tests against them. Scene records carry a BoundingSphere in world space;
+// anything entirely outside one plane is skipped before any GL work.
+// CullCounter tracks how many objects of one category were tested and culled.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "mesh_cache.h"
+
+struct BoundingSphere {
+    float x, y, z;
+    float radius;
+};
+
+inline BoundingSphere makeBoundingSphere(float x, float y, float z, float radius) {
+    BoundingSphere sphere = { x, y, z, radius };
+    return sphere;
+}
+
+struct Frustum {
+    float planes[6][4]; // a, b, c, d with a unit normal pointing inside
+};
+
+// Planes of the clip volume of 'clip' = projection * modelview
+inline Frustum frustumFromMatrix(const Mat4& clip) {
+    const float* m = clip.m;
+    Frustum f;
+    for (int i = 0; i < 3; ++i) {
+        // Left/right, bottom/top, near/far: row 3 +/- row i
+        for (int side = 0; side < 2; ++side) {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            float* p = f.planes[i * 2 + side];
+            p[0] = m[3] + sign * m[i];
+            p[1] = m[7] + sign * m[4 + i];
+            p[2] = m[11] + sign * m[8 + i];
+            p[3] = m[15] + sign * m[12 + i];
+            float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            if (len > 0.0f) {
+                p[0] /= len; p[1] /= len; p[2] /= len; p[3] /= len;
+            }
+        }
+    }
+    return f;
+}
+
+// Frustum of whatever gluPerspective/gluLookAt left in the current matrices
+inline Frustum frustumFromGL() {
+    Mat4 projection, modelview;
+    glGetFloatv(GL_PROJECTION_MATRIX, projection.m);
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview.m);
+    return frustumFromMatrix(projection * modelview);
+}
+
+inline bool sphereInFrustum(const Frustum& f, float x, float y, float z, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        const float* p = f.planes[i];
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < -radius) return false;
+    }
+    return true;
+}
+
+inline bool sphereInFrustum(const Frustum& f, const BoundingSphere& s) {
+    return sphereInFrustum(f, s.x, s.y, s.z, s.radius);
+}
+
+enum FrustumTest { FRUSTUM_OUTSIDE, FRUSTUM_INTERSECTS, FRUSTUM_INSIDE };
+
+// Classifies an axis-aligned box: entirely outside, straddling a plane, or
+// entirely inside (so everything in it is visible without further tests)
+inline FrustumTest boxInFrustum(const Frustum& f, const float lo[3], const float hi[3]) {
+    FrustumTest result = FRUSTUM_INSIDE;
+    for (int i = 0; i < 6; ++i) {
+        const float* p = f.planes[i];
+        // Box corners furthest along and against the plane normal
+        float far = p[3], near = p[3];
+        for (int k = 0; k < 3; ++k) {
+            far += p[k] * (p[k] >= 0.0f ? hi[k] : lo[k]);
+            near += p[k] * (p[k] >= 0.0f ? lo[k] : hi[k]);
+        }
+        if (far < 0.0f) return FRUSTUM_OUTSIDE;
+        if (near < 0.0f) result = FRUSTUM_INTERSECTS;
+    }
+    return result;
+}
+
+// Smallest sphere around 'a' and 'b'
+inline BoundingSphere mergeBoundingSpheres(const BoundingSphere& a, const BoundingSphere& b) {
+    float dx = b.x - a.x, dy = b.y - a.y, dz = b.z - a.z;
+    float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+    if (dist + b.radius <= a.radius) return a;
+    if (dist + a.radius <= b.radius) return b;
+    float radius = (dist + a.radius + b.radius) * 0.5f;
+    float t = (radius - a.radius) / dist;
+    return makeBoundingSphere(a.x + dx * t, a.y + dy * t, a.z + dz * t, radius);
+}
+
+// Sphere around every vertex of a mesh, in the mesh's own space
+inline BoundingSphere meshBoundingSphere(const Mesh& mesh) {
+    const std::vector<float>& p = mesh.positions;
+    if (p.empty()) return makeBoundingSphere(0.0f, 0.0f, 0.0f, 0.0f);
+    float lo[3] = { p[0], p[1], p[2] }, hi[3] = { p[0], p[1], p[2] };
+    for (size_t i = 0; i < p.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], p[i + k]);
+            hi[k] = std::max(hi[k], p[i + k]);
+        }
+    }
+    BoundingSphere s = makeBoundingSphere((lo[0] + hi[0]) * 0.5f, (lo[1] + hi[1]) * 0.5f, (lo[2] + hi[2]) * 0.5f, 0.0f);
+    float r2 = 0.0f;
+    for (size_t i = 0; i < p.size(); i += 3) {
+        float dx = p[i] - s.x, dy = p[i + 1] - s.y, dz = p[i + 2] - s.z;
+        r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+    }
+    s.radius = sqrtf(r2);
+    return s;
+}
+
+// Per-category culling statistics: the last frame plus running totals.
+// Objects inside the frustum that an impostor shows instead are 'baked',
+// not visible.
+struct CullCounter {
+    int visible = 0;
+    int culled = 0;
+    int baked = 0;
+    long long totalVisible = 0;
+    long long totalCulled = 0;
+    long long totalBaked = 0;
+
+    void beginFrame() {
+        visible = culled = baked = 0;
+    }
+
+    void resetTotals() {
+        totalVisible = totalCulled = totalBaked = 0;
+    }
+
+    void recordBaked(int count = 1) {
+        baked += count;
+        totalBaked += count;
+    }
+
+    // Records 'count' objects as visible or culled and returns 'isVisible'
+    bool record(bool isVisible, int count = 1) {
+        if (isVisible) { visible += count; totalVisible += count; }
+        else { culled += count; totalCulled += count; }
+        return isVisible;
+    }
+
+    // Tests one object and records the result
+    bool test(const Frustum& frustum, const BoundingSphere& bounds) {
+        return record(sphereInFrustum(frustum, bounds));
+    }
+};
+
+#endif // FRUSTUM_H
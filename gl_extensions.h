@@ -0,0 +1,55 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+// --- GL Extensions ---
+// Entry points beyond GL 1.1 are looked up at runtime through the window
+// system (EGL, WGL or GLX), so the scenes link against plain libGL and
+// fall back when the driver lacks a feature. All of these need a current
+// context.
+
+#include <cstdio>
+#include <cstring>
+
+#include <GL/gl.h>
+
+#ifdef SCENE_BENCH_EGL
+#include <EGL/egl.h>
+#elif !defined(_WIN32) && !defined(__APPLE__)
+extern "C" void (*glXGetProcAddressARB(const GLubyte* name))();
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// Null when the function is not available
+inline void* glProcAddress(const char* name) {
+#if defined(SCENE_BENCH_EGL)
+    return (void*)eglGetProcAddress(name);
+#elif defined(_WIN32)
+    return (void*)wglGetProcAddress(name);
+#elif defined(__APPLE__)
+    (void)name;
+    return nullptr;
+#else
+    return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+inline bool glHasExtension(const char* name) {
+    const char* list = (const char*)glGetString(GL_EXTENSIONS);
+    size_t length = strlen(name);
+    for (const char* p = list; p && (p = strstr(p, name)) != nullptr; p += length) {
+        if ((p == list || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return true;
+    }
+    return false;
+}
+
+inline bool glVersionAtLeast(int wantMajor, int wantMinor) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int major = 0, minor = 0;
+    if (version) sscanf(version, "%d.%d", &major, &minor);
+    return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+}
+
+#endif // GL_EXTENSIONS_H
@@ -0,0 +1,221 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// --- GL State Cache ---
+// A thin shadow of the fixed-function state the scenes set most often:
+// material parameters, the current color, enable/disable caps, the blend
+// function and texture bindings. A call that would set a value the shadow
+// already holds is dropped. Every call is counted as issued or skipped, per
+// kind and per frame, so redundant state traffic shows up in the stats.
+//
+// The shadow only knows about calls made through it. Code that changes the
+// same state directly must either restore it (glPushAttrib/glPopAttrib) or
+// call one of the invalidate functions afterwards; drawing with a color
+// array in particular leaves the current color undefined.
+//
+// With GL_COLOR_MATERIAL enabled the tracked material parameters follow the
+// current color and GL ignores glMaterial for them, so skipping such a call
+// never changes what is drawn.
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+#include <GL/gl.h>
+
+#include "draw_counters.h"
+
+enum GlStateKind {
+    GL_STATE_MATERIAL,
+    GL_STATE_COLOR,
+    GL_STATE_ENABLE,
+    GL_STATE_BLEND,
+    GL_STATE_TEXTURE,
+    GL_STATE_KIND_COUNT
+};
+
+const char* const GL_STATE_KIND_NAMES[GL_STATE_KIND_COUNT] = {
+    "material", "color", "enable", "blend_func", "texture_bind"
+};
+
+struct GlStateCounter {
+    int issued = 0;  // Last frame
+    int skipped = 0;
+    long long totalIssued = 0;
+    long long totalSkipped = 0;
+
+    void beginFrame() { issued = skipped = 0; }
+    void resetTotals() { totalIssued = totalSkipped = 0; }
+
+    // Counts a call and returns whether it has to reach GL
+    bool record(bool redundant) {
+        if (redundant) { ++skipped; ++totalSkipped; }
+        else { ++issued; ++totalIssued; }
+        return !redundant;
+    }
+};
+
+class GlStateCache {
+public:
+    GlStateCounter counters[GL_STATE_KIND_COUNT];
+    long long frames = 0;
+
+    // Starts a new frame of counters; the shadowed state carries over
+    void beginFrame() {
+        for (GlStateCounter& counter : counters) counter.beginFrame();
+        ++frames;
+    }
+
+    // Starts the running totals over, e.g. once a benchmark's warmup is done
+    void resetTotals() {
+        for (GlStateCounter& counter : counters) counter.resetTotals();
+        frames = 0;
+    }
+
+    // GL_AMBIENT, GL_DIFFUSE, GL_SPECULAR, GL_EMISSION (four values) or
+    // GL_SHININESS (one); 'face' is assumed to be the same for every call
+    void material(GLenum face, GLenum pname, const GLfloat* params) {
+        Material* slot = materialSlot(pname);
+        int count = pname == GL_SHININESS ? 1 : 4;
+        bool redundant = slot && slot->known && memcmp(slot->value, params, count * sizeof(GLfloat)) == 0;
+        if (!counters[GL_STATE_MATERIAL].record(redundant)) return;
+        glMaterialfv(face, pname, params);
+        countDraw(DRAW_MATERIAL_CHANGES);
+        if (slot) {
+            memcpy(slot->value, params, count * sizeof(GLfloat));
+            slot->known = true;
+        }
+    }
+
+    void color3f(float r, float g, float b) {
+        bool redundant = colorKnown && color[0] == r && color[1] == g && color[2] == b;
+        if (!counters[GL_STATE_COLOR].record(redundant)) return;
+        glColor3f(r, g, b);
+        color[0] = r; color[1] = g; color[2] = b;
+        colorKnown = true;
+    }
+
+    void enable(GLenum cap) { setCap(cap, true); }
+    void disable(GLenum cap) { setCap(cap, false); }
+
+    void blendFunc(GLenum source, GLenum destination) {
+        bool redundant = blendKnown && blendSource == source && blendDestination == destination;
+        if (!counters[GL_STATE_BLEND].record(redundant)) return;
+        glBlendFunc(source, destination);
+        blendSource = source;
+        blendDestination = destination;
+        blendKnown = true;
+    }
+
+    // GL_TEXTURE_1D or GL_TEXTURE_2D; other targets pass straight through
+    void bindTexture(GLenum target, GLuint texture) {
+        Binding* slot = target == GL_TEXTURE_1D ? &textures[0] : target == GL_TEXTURE_2D ? &textures[1] : nullptr;
+        bool redundant = slot && slot->known && slot->texture == texture;
+        if (!counters[GL_STATE_TEXTURE].record(redundant)) return;
+        glBindTexture(target, texture);
+        countDraw(DRAW_TEXTURE_BINDS);
+        if (slot) {
+            slot->texture = texture;
+            slot->known = true;
+        }
+    }
+
+    void invalidateColor() { colorKnown = false; }
+    void invalidateTextures() { textures[0].known = textures[1].known = false; }
+
+    void invalidate() {
+        for (Material& slot : materials) slot.known = false;
+        for (Cap& slot : caps) slot.known = false;
+        invalidateColor();
+        invalidateTextures();
+        blendKnown = false;
+    }
+
+private:
+    struct Material {
+        GLenum pname;
+        GLfloat value[4];
+        bool known;
+    };
+    struct Cap {
+        GLenum cap = 0;
+        bool enabled = false;
+        bool known = false;
+    };
+    struct Binding {
+        GLuint texture = 0;
+        bool known = false;
+    };
+    static const int MAX_CAPS = 16;
+
+    Material materials[5] = {
+        { GL_AMBIENT, {}, false }, { GL_DIFFUSE, {}, false }, { GL_SPECULAR, {}, false },
+        { GL_EMISSION, {}, false }, { GL_SHININESS, {}, false }
+    };
+    float color[3] = { 0.0f, 0.0f, 0.0f };
+    bool colorKnown = false;
+    Cap caps[MAX_CAPS];
+    int capCount = 0;
+    GLenum blendSource = GL_ONE, blendDestination = GL_ZERO;
+    bool blendKnown = false;
+    Binding textures[2]; // GL_TEXTURE_1D, GL_TEXTURE_2D
+
+    Material* materialSlot(GLenum pname) {
+        for (Material& slot : materials) {
+            if (slot.pname == pname) return &slot;
+        }
+        return nullptr;
+    }
+
+    // Caps are registered on first use; past MAX_CAPS they go untracked
+    void setCap(GLenum cap, bool enabled) {
+        Cap* slot = nullptr;
+        for (int i = 0; i < capCount && !slot; ++i) {
+            if (caps[i].cap == cap) slot = &caps[i];
+        }
+        if (!slot && capCount < MAX_CAPS) {
+            slot = &caps[capCount++];
+            slot->cap = cap;
+        }
+        bool redundant = slot && slot->known && slot->enabled == enabled;
+        if (!counters[GL_STATE_ENABLE].record(redundant)) return;
+        if (enabled) glEnable(cap);
+        else glDisable(cap);
+        if (cap == GL_BLEND) countDraw(DRAW_BLEND_TOGGLES);
+        if (slot) {
+            slot->enabled = enabled;
+            slot->known = true;
+        }
+    }
+};
+
+// The one cache for the current context
+inline GlStateCache& glState() {
+    static GlStateCache cache;
+    return cache;
+}
+
+// Issued and skipped state calls of the last frame, one line per kind
+inline void glStatePrintFrame(std::ostream& out) {
+    for (int i = 0; i < GL_STATE_KIND_COUNT; ++i) {
+        const GlStateCounter& counter = glState().counters[i];
+        out << GL_STATE_KIND_NAMES[i] << ": " << counter.issued << " issued, " << counter.skipped << " skipped"
+            << std::endl;
+    }
+}
+
+// Issued and skipped state calls per frame by kind, as a benchmark JSON
+// section named "gl_state"
+inline void glStateWriteReport(FILE* out) {
+    const GlStateCache& cache = glState();
+    double frames = cache.frames > 0 ? (double)cache.frames : 1.0;
+    fprintf(out, "  \"gl_state\": {");
+    for (int i = 0; i < GL_STATE_KIND_COUNT; ++i) {
+        const GlStateCounter& counter = cache.counters[i];
+        fprintf(out, "%s\n    \"%s\": {\"issued\": %.2f, \"skipped\": %.2f}", i ? "," : "", GL_STATE_KIND_NAMES[i],
+                counter.totalIssued / frames, counter.totalSkipped / frames);
+    }
+    fprintf(out, "\n  }");
+}
+
+#endif // GL_STATE_H
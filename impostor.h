@@ -0,0 +1,398 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+// --- Panorama Impostor ---
+// Distant, slowly changing scenery rendered once into a ring of textured
+// panels around an eye point, then drawn as a backdrop instead of the
+// geometry. The panorama is COLUMNS x ROWS perspective views covering the
+// full circle between two elevation angles. Each view is rendered straight
+// into its panel texture through a framebuffer object (GL 3.0,
+// GL_ARB_framebuffer_object or GL_EXT_framebuffer_object). The window's
+// back buffer is no use for this: pixels hidden by other windows or off
+// screen fail the pixel ownership test and would be baked as garbage.
+// Without framebuffer objects the impostor stays disabled and the scene
+// draws the far field live.
+//
+// A rebake renders into a second set of textures a few panels per frame and
+// swaps sets once the last panel is done, so the backdrop never shows a
+// half-finished panorama. The scene decides when a rebake is due.
+//
+// The backdrop is a shell of the given radius around the bake eye, depth
+// tested against the live geometry already drawn, so it must only hold
+// content beyond that radius: live geometry inside the shell stays in front
+// of it, live geometry behind it is covered wherever something was baked.
+// Texels nothing was baked into keep the clear alpha of 0 and are
+// alpha-tested away, which also lets the scene mask out live objects by
+// drawing them depth-only during the bake.
+//
+// Most of the shell is empty sky. While a bake is set up the scene reports
+// the box of everything it will bake, and only shell cells one of those
+// boxes reaches are drawn.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <GL/gl.h>
+#include <GL/glu.h>
+
+#include "draw_counters.h"
+#include "frustum.h"
+#include "gl_extensions.h"
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+const GLenum IMPOSTOR_FRAMEBUFFER = 0x8D40;          // GL_FRAMEBUFFER
+const GLenum IMPOSTOR_RENDERBUFFER = 0x8D41;         // GL_RENDERBUFFER
+const GLenum IMPOSTOR_FRAMEBUFFER_BINDING = 0x8CA6;  // GL_FRAMEBUFFER_BINDING
+const GLenum IMPOSTOR_FRAMEBUFFER_COMPLETE = 0x8CD5; // GL_FRAMEBUFFER_COMPLETE
+const GLenum IMPOSTOR_COLOR_ATTACHMENT0 = 0x8CE0;    // GL_COLOR_ATTACHMENT0
+const GLenum IMPOSTOR_DEPTH_ATTACHMENT = 0x8D00;     // GL_DEPTH_ATTACHMENT
+const GLenum IMPOSTOR_DEPTH_COMPONENT24 = 0x81A6;    // GL_DEPTH_COMPONENT24
+
+class PanoramaImpostor {
+public:
+    static const int COLUMNS = 8;
+    static const int ROWS = 2;
+    static const int PANELS = COLUMNS * ROWS;
+    // Grid steps per panel side when drawing the shell; one bit per cell
+    // of a panel must fit a uint64_t
+    static const int SHELL_STEPS = 8;
+    static const int SHELL_CELLS = SHELL_STEPS * SHELL_STEPS;
+
+    long long panelsBaked = 0;
+    long long bakesCompleted = 0;
+
+    // panelSize: texels per panel side (a power of two). bottom/top: the
+    // elevation range covered, in degrees. radius: distance from the bake
+    // eye of the backdrop shell. Returns false (and stays disabled) when
+    // framebuffer objects are not supported.
+    bool init(int panelSize, float bottomDegrees, float topDegrees, float radius, float farClip) {
+        size = panelSize;
+        bottom = bottomDegrees * MESH_PI / 180.0f;
+        top = topDegrees * MESH_PI / 180.0f;
+        shellRadius = radius;
+        farPlane = farClip;
+        if (!loadFramebufferFunctions()) return false;
+
+        glGenTextures(2 * PANELS, &textures[0][0]);
+        for (int set = 0; set < 2; ++set) {
+            for (int panel = 0; panel < PANELS; ++panel) {
+                glBindTexture(GL_TEXTURE_2D, textures[set][panel]);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+        if (!createFramebuffer()) {
+            glDeleteTextures(2 * PANELS, &textures[0][0]);
+            return false;
+        }
+        available = true;
+        return true;
+    }
+
+    bool enabled() const { return available; }
+    bool ready() const { return available && hasFront; }
+    bool baking() const { return nextPanel < PANELS; }
+
+    // Texture set the backdrop draws from, and the one a bake renders into
+    int frontSet() const { return front; }
+    int backSet() const { return 1 - front; }
+
+    const float* frontEye() const { return eyes[front]; }
+    const float* backEye() const { return eyes[backSet()]; }
+
+    int panelSize() const { return size; }
+
+    // Vertical field of view of one panel in degrees, for LOD selection
+    float panelFieldOfView() const { return (top - bottom) / ROWS * 180.0f / MESH_PI; }
+
+    // Starts rendering a new panorama around 'eye' into the back set
+    void beginBake(const float eye[3]) {
+        int set = backSet();
+        for (int i = 0; i < 3; ++i) eyes[set][i] = eye[i];
+        for (int panel = 0; panel < PANELS; ++panel) cellMasks[set][panel] = 0;
+        buildCellFrusta(eye);
+        nextPanel = 0;
+    }
+
+    // Marks the shell cells an axis-aligned box is seen through from the eye
+    // of the bake just begun
+    void addContent(const float lo[3], const float hi[3]) {
+        uint64_t* masks = cellMasks[backSet()];
+        for (int panel = 0; panel < PANELS; ++panel) {
+            for (int cell = 0; cell < SHELL_CELLS; ++cell) {
+                if (boxInFrustum(cellFrusta[panel * SHELL_CELLS + cell], lo, hi) != FRUSTUM_OUTSIDE) {
+                    masks[panel] |= (uint64_t)1 << cell;
+                }
+            }
+        }
+    }
+
+    // Shell cells drawn from the front set, out of PANELS * SHELL_CELLS
+    int frontCellCount() const {
+        int cells = 0;
+        for (int panel = 0; panel < PANELS; ++panel) {
+            for (int cell = 0; cell < SHELL_CELLS; ++cell) cells += (int)((cellMasks[front][panel] >> cell) & 1);
+        }
+        return cells;
+    }
+
+    // Renders up to 'count' pending panels. For each, the framebuffer,
+    // viewport, matrices and cleared buffers are set up for the panel view
+    // and draw(frustum) renders whatever belongs in the panorama. Returns
+    // true when the bake completed and the new panorama became the front set.
+    template <class Draw>
+    bool bakePanels(int count, Draw draw) {
+        if (!available || !baking()) return false;
+        GLint viewport[4], boundFramebuffer = 0;
+        GLfloat clearColor[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        glGetIntegerv(IMPOSTOR_FRAMEBUFFER_BINDING, &boundFramebuffer);
+
+        fbo.bindFramebuffer(IMPOSTOR_FRAMEBUFFER, fbo.framebuffer);
+        glViewport(0, 0, size, size);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        countDraw(DRAW_MATRIX_PUSHES, 2);
+
+        const float* eye = eyes[backSet()];
+        const float nearPlane = 5.0f;
+        for (; count > 0 && baking(); --count, ++nextPanel) {
+            float yaw, rowBottom, rowTop;
+            panelAngles(nextPanel, yaw, rowBottom, rowTop);
+            float halfWidth = tanf(MESH_PI / COLUMNS);
+
+            glMatrixMode(GL_PROJECTION);
+            glLoadIdentity();
+            glFrustum(-nearPlane * halfWidth, nearPlane * halfWidth,
+                      nearPlane * tanf(rowBottom), nearPlane * tanf(rowTop), nearPlane, farPlane);
+            glMatrixMode(GL_MODELVIEW);
+            glLoadIdentity();
+            gluLookAt(eye[0], eye[1], eye[2], eye[0] + cosf(yaw), eye[1], eye[2] + sinf(yaw), 0.0f, 1.0f, 0.0f);
+
+            fbo.framebufferTexture2D(IMPOSTOR_FRAMEBUFFER, IMPOSTOR_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                     textures[backSet()][nextPanel], 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            draw(frustumFromGL());
+            ++panelsBaked;
+        }
+
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+        fbo.bindFramebuffer(IMPOSTOR_FRAMEBUFFER, (GLuint)boundFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+        if (baking()) return false;
+        front = backSet();
+        hasFront = true;
+        ++bakesCompleted;
+        return true;
+    }
+
+    // Draws the front panorama on a shell around the eye it was baked from.
+    // Call after the live objects it may have to cover, which also lets depth
+    // testing reject the pixels nearer geometry already filled. Depth is not
+    // written, so anything drawn later still lands in front of it.
+    void draw() const {
+        if (!ready()) return;
+        glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_LIGHTING);
+        glDisable(GL_FOG);
+        glEnable(GL_TEXTURE_2D);
+        glEnable(GL_ALPHA_TEST);
+        glAlphaFunc(GL_GREATER, 0.5f);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+        for (int panel = 0; panel < PANELS; ++panel) {
+            uint64_t mask = cellMasks[front][panel];
+            if (mask == 0) continue;
+            glBindTexture(GL_TEXTURE_2D, textures[front][panel]);
+            glBegin(GL_QUADS);
+            int cells = 0;
+            for (int cell = 0; cell < SHELL_CELLS; ++cell) {
+                if (!((mask >> cell) & 1)) continue;
+                int i = cell % SHELL_STEPS, j = cell / SHELL_STEPS;
+                shellVertex(panel, i, j);
+                shellVertex(panel, i + 1, j);
+                shellVertex(panel, i + 1, j + 1);
+                shellVertex(panel, i, j + 1);
+                ++cells;
+            }
+            glEnd();
+            countDraw(DRAW_TEXTURE_BINDS);
+            countDraw(DRAW_CALLS);
+            countDraw(DRAW_BEGIN_BLOCKS);
+            countDraw(DRAW_VERTICES, cells * 4);
+        }
+
+        glPopAttrib();
+    }
+
+private:
+    typedef void (APIENTRY* GenObjectsFn)(GLsizei n, GLuint* ids);
+    typedef void (APIENTRY* BindObjectFn)(GLenum target, GLuint id);
+    typedef void (APIENTRY* RenderbufferStorageFn)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+    typedef void (APIENTRY* FramebufferRenderbufferFn)(GLenum target, GLenum attachment, GLenum renderbufferTarget,
+                                                       GLuint renderbuffer);
+    typedef void (APIENTRY* FramebufferTexture2DFn)(GLenum target, GLenum attachment, GLenum textureTarget,
+                                                    GLuint texture, GLint level);
+    typedef GLenum (APIENTRY* CheckFramebufferStatusFn)(GLenum target);
+
+    // The bake target: panel textures are attached in turn, depth is shared
+    struct Framebuffer {
+        GenObjectsFn genFramebuffers = nullptr;
+        BindObjectFn bindFramebuffer = nullptr;
+        GenObjectsFn genRenderbuffers = nullptr;
+        BindObjectFn bindRenderbuffer = nullptr;
+        RenderbufferStorageFn renderbufferStorage = nullptr;
+        FramebufferRenderbufferFn framebufferRenderbuffer = nullptr;
+        FramebufferTexture2DFn framebufferTexture2D = nullptr;
+        CheckFramebufferStatusFn checkFramebufferStatus = nullptr;
+        GLuint framebuffer = 0;
+        GLuint depth = 0;
+    };
+
+    Framebuffer fbo;
+    bool available = false;
+    bool hasFront = false;
+    int front = 0;
+    int nextPanel = PANELS; // PANELS when no bake is running
+    int size = 512;
+    float bottom = 0.0f, top = 0.0f;
+    float shellRadius = 1000.0f;
+    float farPlane = 6000.0f;
+    float eyes[2][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    GLuint textures[2][PANELS];
+    uint64_t cellMasks[2][PANELS] = {};  // Bit i + j * SHELL_STEPS: cell (i, j) holds content
+    std::vector<Frustum> cellFrusta;     // Per cell of every panel, for the bake in progress
+
+    // Core and ARB entry points share names; EXT ones carry the suffix
+    bool loadFramebufferFunctions() {
+        const char* suffix = "";
+        if (!glVersionAtLeast(3, 0) && !glHasExtension("GL_ARB_framebuffer_object")) {
+            if (!glHasExtension("GL_EXT_framebuffer_object")) return false;
+            suffix = "EXT";
+        }
+        char name[64];
+        auto load = [&](const char* base) {
+            snprintf(name, sizeof(name), "%s%s", base, suffix);
+            return glProcAddress(name);
+        };
+        fbo.genFramebuffers = (GenObjectsFn)load("glGenFramebuffers");
+        fbo.bindFramebuffer = (BindObjectFn)load("glBindFramebuffer");
+        fbo.genRenderbuffers = (GenObjectsFn)load("glGenRenderbuffers");
+        fbo.bindRenderbuffer = (BindObjectFn)load("glBindRenderbuffer");
+        fbo.renderbufferStorage = (RenderbufferStorageFn)load("glRenderbufferStorage");
+        fbo.framebufferRenderbuffer = (FramebufferRenderbufferFn)load("glFramebufferRenderbuffer");
+        fbo.framebufferTexture2D = (FramebufferTexture2DFn)load("glFramebufferTexture2D");
+        fbo.checkFramebufferStatus = (CheckFramebufferStatusFn)load("glCheckFramebufferStatus");
+        return fbo.genFramebuffers && fbo.bindFramebuffer && fbo.genRenderbuffers && fbo.bindRenderbuffer &&
+               fbo.renderbufferStorage && fbo.framebufferRenderbuffer && fbo.framebufferTexture2D &&
+               fbo.checkFramebufferStatus;
+    }
+
+    // A size x size depth buffer with the first panel attached; false if the
+    // driver cannot render into that combination
+    bool createFramebuffer() {
+        GLint boundFramebuffer = 0;
+        glGetIntegerv(IMPOSTOR_FRAMEBUFFER_BINDING, &boundFramebuffer);
+        fbo.genFramebuffers(1, &fbo.framebuffer);
+        fbo.bindFramebuffer(IMPOSTOR_FRAMEBUFFER, fbo.framebuffer);
+        fbo.genRenderbuffers(1, &fbo.depth);
+        fbo.bindRenderbuffer(IMPOSTOR_RENDERBUFFER, fbo.depth);
+        fbo.renderbufferStorage(IMPOSTOR_RENDERBUFFER, IMPOSTOR_DEPTH_COMPONENT24, size, size);
+        fbo.bindRenderbuffer(IMPOSTOR_RENDERBUFFER, 0);
+        fbo.framebufferRenderbuffer(IMPOSTOR_FRAMEBUFFER, IMPOSTOR_DEPTH_ATTACHMENT, IMPOSTOR_RENDERBUFFER, fbo.depth);
+        fbo.framebufferTexture2D(IMPOSTOR_FRAMEBUFFER, IMPOSTOR_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0][0], 0);
+        bool complete = fbo.checkFramebufferStatus(IMPOSTOR_FRAMEBUFFER) == IMPOSTOR_FRAMEBUFFER_COMPLETE;
+        fbo.bindFramebuffer(IMPOSTOR_FRAMEBUFFER, (GLuint)boundFramebuffer);
+        return complete;
+    }
+
+    // View direction (radians about Y from +X) and elevation range of a panel
+    void panelAngles(int panel, float& yaw, float& rowBottom, float& rowTop) const {
+        int column = panel % COLUMNS, row = panel / COLUMNS;
+        float rowHeight = (top - bottom) / ROWS;
+        yaw = column * 2.0f * MESH_PI / COLUMNS;
+        rowBottom = bottom + row * rowHeight;
+        rowTop = rowBottom + rowHeight;
+    }
+
+    // Direction through grid corner (i, j) of a panel, on its unit-distance view plane
+    void cornerDirection(int panel, int i, int j, float direction[3]) const {
+        float yaw, rowBottom, rowTop;
+        panelAngles(panel, yaw, rowBottom, rowTop);
+        float halfWidth = tanf(MESH_PI / COLUMNS);
+        float x = halfWidth * (2.0f * i / SHELL_STEPS - 1.0f);
+        float y = tanf(rowBottom) + (tanf(rowTop) - tanf(rowBottom)) * j / SHELL_STEPS;
+        direction[0] = cosf(yaw) - x * sinf(yaw);
+        direction[1] = y;
+        direction[2] = sinf(yaw) + x * cosf(yaw);
+    }
+
+    // Emits grid corner (i, j) of a front panel pushed out onto the shell.
+    // Texture coordinates are projective (q = depth along the panel's view
+    // axis), so every texel lands on the direction it was rendered from.
+    void shellVertex(int panel, int i, int j) const {
+        const float* eye = eyes[front];
+        float d[3];
+        cornerDirection(panel, i, j, d);
+        float q = shellRadius / sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        glTexCoord4f(q * i / SHELL_STEPS, q * j / SHELL_STEPS, 0.0f, q);
+        glVertex3f(eye[0] + q * d[0], eye[1] + q * d[1], eye[2] + q * d[2]);
+    }
+
+    // Four side planes through the eye for every shell cell; the near and
+    // far planes are left accepting everything
+    void buildCellFrusta(const float eye[3]) {
+        cellFrusta.resize(PANELS * SHELL_CELLS);
+        for (int panel = 0; panel < PANELS; ++panel) {
+            for (int cell = 0; cell < SHELL_CELLS; ++cell) {
+                int i = cell % SHELL_STEPS, j = cell / SHELL_STEPS;
+                float corners[4][3], centre[3] = { 0.0f, 0.0f, 0.0f };
+                cornerDirection(panel, i, j, corners[0]);
+                cornerDirection(panel, i + 1, j, corners[1]);
+                cornerDirection(panel, i + 1, j + 1, corners[2]);
+                cornerDirection(panel, i, j + 1, corners[3]);
+                for (int c = 0; c < 4; ++c) {
+                    for (int k = 0; k < 3; ++k) centre[k] += corners[c][k];
+                }
+
+                Frustum& f = cellFrusta[panel * SHELL_CELLS + cell];
+                for (int c = 0; c < 4; ++c) {
+                    const float* a = corners[c];
+                    const float* b = corners[(c + 1) % 4];
+                    float* p = f.planes[c];
+                    p[0] = a[1] * b[2] - a[2] * b[1];
+                    p[1] = a[2] * b[0] - a[0] * b[2];
+                    p[2] = a[0] * b[1] - a[1] * b[0];
+                    float len = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+                    if (p[0] * centre[0] + p[1] * centre[1] + p[2] * centre[2] < 0.0f) len = -len;
+                    for (int k = 0; k < 3; ++k) p[k] /= len;
+                    p[3] = -(p[0] * eye[0] + p[1] * eye[1] + p[2] * eye[2]);
+                }
+                for (int c = 4; c < 6; ++c) {
+                    f.planes[c][0] = f.planes[c][1] = f.planes[c][2] = 0.0f;
+                    f.planes[c][3] = 1.0f;
+                }
+            }
+        }
+    }
+};
+
+#endif // IMPOSTOR_H
@@ -0,0 +1,243 @@
+#ifndef INSTANCE_BATCH_H
+#define INSTANCE_BATCH_H
+
+// --- Instance Batches ---
+// Many copies of one baked prototype mesh, each with its own position,
+// rotation about Y, scale and tint. The fixed-function pipeline has no
+// hardware instancing, so the instances are expanded into one static mesh
+// the first time the batch is drawn after a change, and the whole batch is
+// then replayed with a single display list call per frame.
+//
+// TiledInstanceBatch splits a large batch into spatial tiles so it can be
+// frustum culled per tile. Given one prototype per LOD level, each tile also
+// picks the level its nearest instance needs and bakes that level from its
+// one instance list on demand.
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "frustum.h"
+#include "lod.h"
+#include "mesh_cache.h"
+
+struct Instance {
+    float x, y, z;
+    float rotationY;    // Degrees
+    float scale[3];
+    float tint[3];      // Multiplies the prototype's vertex colors
+};
+
+inline Instance makeInstance(float x, float y, float z, float rotationY, float scale) {
+    Instance instance = { x, y, z, rotationY, { scale, scale, scale }, { 1.0f, 1.0f, 1.0f } };
+    return instance;
+}
+
+struct InstanceBatch {
+    const Mesh* prototype = nullptr;
+    bool texCoords = false;         // Keep the prototype's texture coordinates
+    std::vector<Instance> instances;
+    Mesh baked;
+    bool dirty = true;
+
+    void setPrototype(const Mesh& mesh, bool withTexCoords = false) {
+        prototype = &mesh;
+        texCoords = withTexCoords;
+        dirty = true;
+    }
+
+    void clear() {
+        instances.clear();
+        dirty = true;
+    }
+
+    void add(const Instance& instance) {
+        instances.push_back(instance);
+        dirty = true;
+    }
+
+    void rebuild() {
+        bakeInstances(prototype, texCoords, instances, baked);
+        dirty = false;
+    }
+
+    // Rebuilds and compiles the baked mesh if needed; null when empty
+    Mesh* prepare() {
+        if (dirty) rebuild();
+        return compileBakedInstances(baked);
+    }
+
+    void draw() {
+        if (Mesh* mesh = prepare()) drawMesh(*mesh);
+    }
+
+    // Expands 'instances' of 'prototype' into 'baked', replacing what it held
+    static void bakeInstances(const Mesh* prototype, bool texCoords, const std::vector<Instance>& instances,
+                              Mesh& baked) {
+        releaseMesh(baked);
+        baked = Mesh();
+        if (!prototype) return;
+        baked.positions.reserve(instances.size() * prototype->positions.size());
+        baked.normals.reserve(instances.size() * prototype->normals.size());
+        baked.colors.reserve(instances.size() * prototype->positions.size());
+        baked.indices.reserve(instances.size() * prototype->indices.size());
+
+        MeshBuilder builder(baked, texCoords);
+        for (const Instance& instance : instances) {
+            builder.loadMatrix(Mat4::translation(instance.x, instance.y, instance.z) *
+                               Mat4::rotation(instance.rotationY, 0.0f, 1.0f, 0.0f) *
+                               Mat4::scaling(instance.scale[0], instance.scale[1], instance.scale[2]));
+            builder.setColor(instance.tint[0], instance.tint[1], instance.tint[2]);
+            builder.addMesh(*prototype);
+        }
+    }
+
+    // Compiles a baked mesh the first time it is needed; null when empty
+    static Mesh* compileBakedInstances(Mesh& baked) {
+        if (baked.displayList == 0) {
+            if (baked.indices.empty()) return nullptr;
+            compileMesh(baked);
+            // The display list holds its own copy of the geometry
+            baked.positions = std::vector<float>();
+            baked.normals = std::vector<float>();
+            baked.texCoords = std::vector<float>();
+            baked.colors = std::vector<float>();
+            baked.indices = std::vector<unsigned int>();
+        }
+        return &baked;
+    }
+};
+
+// An instance batch split into square tiles on the XZ plane. Each tile is
+// its own batch with a bounding sphere, so tiles outside the view frustum
+// are skipped as a whole while each visible tile is still one draw call.
+struct TiledInstanceBatch {
+    struct Tile {
+        std::vector<Instance> instances;
+        Mesh baked[LOD_LEVELS];          // Expanded per level the first time it is drawn
+        bool dirty[LOD_LEVELS] = { true, true, true, true };
+        BoundingSphere bounds;
+        float instanceRadius = 0.0f;     // Largest instance's bounding radius
+        LodState lod;
+
+        void invalidate() {
+            for (bool& level : dirty) level = true;
+        }
+    };
+
+    const Mesh* prototypes[LOD_LEVELS] = { nullptr, nullptr, nullptr, nullptr };
+    int levelCount = 1;
+    bool texCoords = false;
+    float tileSize;
+    std::map<std::pair<int, int>, size_t> tileIndex; // (tile x, tile z) -> tiles[]
+    std::vector<Tile> tiles;
+    bool boundsDirty = true;
+
+    explicit TiledInstanceBatch(float size = 500.0f) : tileSize(size) {}
+
+    void setPrototype(const Mesh& mesh, bool withTexCoords = false) {
+        const Mesh* levels[1] = { &mesh };
+        setLodPrototypes(levels, 1, withTexCoords);
+    }
+
+    // One prototype per LOD level, finest first; level 0 sets the bounds
+    void setLodPrototypes(const Mesh* const* meshes, int count, bool withTexCoords = false) {
+        levelCount = std::max(1, std::min(count, LOD_LEVELS));
+        for (int level = 0; level < LOD_LEVELS; ++level) {
+            prototypes[level] = level < levelCount ? meshes[level] : nullptr;
+        }
+        texCoords = withTexCoords;
+        for (Tile& tile : tiles) tile.invalidate();
+        boundsDirty = true;
+    }
+
+    void clear() {
+        for (Tile& tile : tiles) {
+            for (Mesh& mesh : tile.baked) releaseMesh(mesh);
+        }
+        tiles.clear();
+        tileIndex.clear();
+        boundsDirty = true;
+    }
+
+    void add(const Instance& instance) {
+        std::pair<int, int> key((int)floorf(instance.x / tileSize), (int)floorf(instance.z / tileSize));
+        auto found = tileIndex.find(key);
+        if (found == tileIndex.end()) {
+            found = tileIndex.insert(std::make_pair(key, tiles.size())).first;
+            tiles.push_back(Tile());
+        }
+        Tile& tile = tiles[found->second];
+        tile.instances.push_back(instance);
+        tile.invalidate();
+        boundsDirty = true;
+    }
+
+    size_t instanceCount() const {
+        size_t count = 0;
+        for (const Tile& tile : tiles) count += tile.instances.size();
+        return count;
+    }
+
+    void updateBounds() {
+        BoundingSphere local = prototypes[0] ? meshBoundingSphere(*prototypes[0]) : makeBoundingSphere(0, 0, 0, 0);
+        for (Tile& tile : tiles) {
+            bool first = true;
+            tile.instanceRadius = 0.0f;
+            for (const Instance& instance : tile.instances) {
+                Mat4 transform = Mat4::translation(instance.x, instance.y, instance.z) *
+                                 Mat4::rotation(instance.rotationY, 0.0f, 1.0f, 0.0f) *
+                                 Mat4::scaling(instance.scale[0], instance.scale[1], instance.scale[2]);
+                float localCenter[3] = { local.x, local.y, local.z }, center[3];
+                transform.transformPoint(localCenter, center);
+                float scale = std::max(instance.scale[0], std::max(instance.scale[1], instance.scale[2]));
+                BoundingSphere sphere = makeBoundingSphere(center[0], center[1], center[2], local.radius * scale);
+                tile.bounds = first ? sphere : mergeBoundingSpheres(tile.bounds, sphere);
+                tile.instanceRadius = std::max(tile.instanceRadius, sphere.radius);
+                first = false;
+            }
+        }
+        boundsDirty = false;
+    }
+
+    // Level a tile needs: the projected size of its largest instance placed
+    // as close to the eye as the tile's bounds allow
+    int selectLevel(Tile& tile) {
+        if (levelCount == 1) return 0;
+        const LodView& view = lodView();
+        float dx = tile.bounds.x - view.eyeX, dy = tile.bounds.y - view.eyeY, dz = tile.bounds.z - view.eyeZ;
+        float nearest = sqrtf(dx * dx + dy * dy + dz * dz) - (tile.bounds.radius - tile.instanceRadius);
+        return std::min(levelCount - 1, tile.lod.update(lodPixelsAtDistance(tile.instanceRadius, nearest)));
+    }
+
+    // Calls visit(mesh, bounds) with the compiled mesh of every tile that
+    // intersects the frustum and counts the instances in skipped tiles as culled
+    template <typename Visitor>
+    void visit(const Frustum& frustum, CullCounter& counter, LodCounter* lodCounter, Visitor visitor) {
+        if (boundsDirty) updateBounds();
+        for (Tile& tile : tiles) {
+            int count = (int)tile.instances.size();
+            if (!counter.record(sphereInFrustum(frustum, tile.bounds), count)) continue;
+            int level = selectLevel(tile);
+            if (lodCounter) lodCounter->record(level, count);
+            if (Mesh* mesh = prepare(tile, level)) visitor(*mesh, tile.bounds);
+        }
+    }
+
+    // Draws the tiles that intersect the frustum
+    void draw(const Frustum& frustum, CullCounter& counter, LodCounter* lodCounter = nullptr) {
+        visit(frustum, counter, lodCounter, [](Mesh& mesh, const BoundingSphere&) { drawMesh(mesh); });
+    }
+
+private:
+    // Bakes and compiles the tile's mesh for 'level' if needed; null when empty
+    Mesh* prepare(Tile& tile, int level) {
+        if (tile.dirty[level]) {
+            InstanceBatch::bakeInstances(prototypes[level], texCoords, tile.instances, tile.baked[level]);
+            tile.dirty[level] = false;
+        }
+        return InstanceBatch::compileBakedInstances(tile.baked[level]);
+    }
+};
+
+#endif // INSTANCE_BATCH_H
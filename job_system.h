@@ -0,0 +1,276 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+// --- Job System ---
+// Work-stealing thread pool for per-frame simulation work. Each worker owns a
+// deque: it pushes and pops its own jobs at the back and steals from the
+// front of the other deques when it runs dry. A thread waiting on a
+// JobCounter keeps running jobs instead of sleeping, so the GLUT thread
+// helps with the work it fans out and nested parallelFor calls cannot
+// deadlock.
+//
+// The pool starts hardware_concurrency() - 1 workers on first use (the GLUT
+// thread is the remaining one). SCENE_JOB_THREADS=<n> overrides the worker
+// count; 0 runs every job inline on the calling thread.
+//
+// Threads outside the pool each queue into a slot of their own: the GLUT
+// thread uses slot 0, a background thread (the scene loader) calls
+// useBackgroundSlot() first. Such threads only run their own jobs while
+// they wait, never steal, so a frame never stalls on a chunk of loader work
+// and the loader never runs simulation jobs. Workers run everything.
+//
+// Jobs must never call GL: only the thread that owns the context may.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace_events.h"
+
+// Number of outstanding jobs; wait on it with jobSystem().wait(counter)
+struct JobCounter {
+    std::atomic<int> pending{0};
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+class JobSystem {
+public:
+    typedef std::function<void()> Job;
+
+    explicit JobSystem(int workerCount) : stopping(false), sleeping(0) {
+        queues.resize(workerCount + EXTERNAL_SLOTS);
+        for (auto& queue : queues) queue.reset(new WorkQueue());
+        for (int i = 0; i < workerCount; ++i) {
+            threads.emplace_back(&JobSystem::workerLoop, this, i + EXTERNAL_SLOTS);
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    int workerCount() const { return (int)threads.size(); }
+
+    // Worker threads plus the calling thread
+    int concurrency() const { return workerCount() + 1; }
+
+    void run(Job job, JobCounter& counter) {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        if (threads.empty()) {
+            execute(job, counter);
+            return;
+        }
+        WorkQueue& queue = *queues[threadSlot()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(Item{ std::move(job), &counter });
+        }
+        if (sleeping.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    // Runs queued jobs on the calling thread until the counter drains
+    void wait(JobCounter& counter) {
+        int slot = threadSlot();
+        while (!counter.done()) {
+            if (!runOne(slot, slot >= EXTERNAL_SLOTS)) std::this_thread::yield();
+        }
+    }
+
+    // Gives the calling thread, which is not the GLUT thread and not in the
+    // pool, its own queue; call before its first job
+    static void useBackgroundSlot() { threadSlotRef() = BACKGROUND_SLOT; }
+
+private:
+    static const int GLUT_SLOT = 0;
+    static const int BACKGROUND_SLOT = 1;
+    static const int EXTERNAL_SLOTS = 2; // Slots before the workers'
+
+    struct Item {
+        Job job;
+        JobCounter* counter;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Item> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::atomic<int> sleeping;
+
+    static int& threadSlotRef() {
+        static thread_local int slot = GLUT_SLOT;
+        return slot;
+    }
+
+    static int threadSlot() { return threadSlotRef(); }
+
+    static void execute(Job& job, JobCounter& counter) {
+        {
+            TraceScope scope("job", "job");
+            job();
+        }
+        counter.pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool popOwn(int slot, Item& item) {
+        WorkQueue& queue = *queues[slot];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        item = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(int slot, Item& item) {
+        int count = (int)queues.size();
+        for (int offset = 1; offset < count; ++offset) {
+            WorkQueue& queue = *queues[(slot + offset) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty()) continue;
+            item = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    bool runOne(int slot, bool maySteal = true) {
+        Item item;
+        if (!popOwn(slot, item) && !(maySteal && steal(slot, item))) return false;
+        execute(item.job, *item.counter);
+        return true;
+    }
+
+    bool anyQueued() {
+        for (auto& queue : queues) {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            if (!queue->jobs.empty()) return true;
+        }
+        return false;
+    }
+
+    void workerLoop(int slot) {
+        threadSlotRef() = slot;
+        traceSetThreadName("job worker");
+        for (;;) {
+            if (runOne(slot)) continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleeping.fetch_add(1, std::memory_order_acq_rel);
+            // Re-check under the lock so a push between runOne and here is not missed
+            wake.wait(lock, [&] { return stopping || anyQueued(); });
+            sleeping.fetch_sub(1, std::memory_order_acq_rel);
+            if (stopping) return;
+        }
+    }
+};
+
+inline int jobSystemDefaultWorkers() {
+    const char* forced = getenv("SCENE_JOB_THREADS");
+    if (forced) return std::max(0, atoi(forced));
+    int cores = (int)std::thread::hardware_concurrency();
+    return std::max(0, cores - 1);
+}
+
+inline JobSystem& jobSystem() {
+    static JobSystem system(jobSystemDefaultWorkers());
+    return system;
+}
+
+// Calls body(chunkBegin, chunkEnd) over [begin, end) split into chunks of
+// at most grainSize items, and returns once every chunk has finished.
+inline void parallelFor(size_t begin, size_t end, size_t grainSize,
+                        const std::function<void(size_t, size_t)>& body) {
+    if (begin >= end) return;
+    grainSize = std::max<size_t>(1, grainSize);
+    JobSystem& system = jobSystem();
+    if (end - begin <= grainSize || system.workerCount() == 0) {
+        for (size_t chunk = begin; chunk < end; chunk += grainSize) {
+            body(chunk, std::min(end, chunk + grainSize));
+        }
+        return;
+    }
+
+    JobCounter counter;
+    for (size_t chunk = begin; chunk < end; chunk += grainSize) {
+        size_t chunkEnd = std::min(end, chunk + grainSize);
+        system.run([&body, chunk, chunkEnd] { body(chunk, chunkEnd); }, counter);
+    }
+    system.wait(counter);
+}
+
+// --- Task Graph ---
+// Tasks with dependencies, built once and run every frame. A task becomes
+// ready when all of its predecessors have finished; ready tasks are handed
+// to the job system, so independent branches run in parallel.
+class TaskGraph {
+public:
+    typedef int TaskId;
+
+    TaskId add(std::function<void()> work) {
+        tasks.emplace_back(new Task());
+        tasks.back()->work = std::move(work);
+        return (TaskId)tasks.size() - 1;
+    }
+
+    // 'after' does not start until 'before' has finished
+    void precede(TaskId before, TaskId after) {
+        tasks[before]->successors.push_back(after);
+        tasks[after]->dependencyCount++;
+    }
+
+    void run() {
+        JobCounter counter;
+        for (auto& task : tasks) {
+            task->remaining.store(task->dependencyCount, std::memory_order_relaxed);
+        }
+        for (TaskId id = 0; id < (TaskId)tasks.size(); ++id) {
+            if (tasks[id]->dependencyCount == 0) schedule(id, counter);
+        }
+        jobSystem().wait(counter);
+    }
+
+private:
+    struct Task {
+        std::function<void()> work;
+        std::vector<TaskId> successors;
+        int dependencyCount = 0;
+        std::atomic<int> remaining{0};
+    };
+
+    std::vector<std::unique_ptr<Task>> tasks;
+
+    void schedule(TaskId id, JobCounter& counter) {
+        jobSystem().run([this, id, &counter] {
+            Task& task = *tasks[id];
+            task.work();
+            for (TaskId next : task.successors) {
+                if (tasks[next]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    schedule(next, counter);
+                }
+            }
+        }, counter);
+    }
+};
+
+#endif // JOB_SYSTEM_H
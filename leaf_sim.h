@@ -0,0 +1,339 @@
+#ifndef LEAF_SIM_H
+#define LEAF_SIM_H
+
+// --- Leaf Simulation ---
+// Falling leaves stored as structure-of-arrays so one tick can be run with
+// SSE2 or AVX2 over many leaves at once. The kernel is picked at runtime
+// from what the CPU supports; LEAF_SIM_KERNEL=scalar|sse|avx2 overrides it.
+//
+// A tick is split in two passes:
+//   1. leafSimKernel(): fall, spin, wind/sway offsets and the respawn mask
+//   2. leafSimRespawn(): re-seeds the (few) leaves that hit the ground
+//
+// leafSimStepChunk() keeps the previous tick's render position and rotation,
+// so drawing can blend between ticks with leafSimInterpolate().
+//
+// Leaves are grouped in fixed chunks of LEAF_SIM_CHUNK, each with its own
+// respawn generator, so chunks can be stepped on any thread in any order and
+// the result does not depend on the thread count.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "simd_math.h"
+
+const size_t LEAF_SIM_CHUNK = 2048;
+
+// Respawn generator state for one chunk, derived from the store seed
+inline uint32_t leafSimChunkSeed(uint32_t seed, size_t chunk) {
+    uint32_t h = seed ^ (uint32_t)(chunk * 0x9E3779B9u);
+    h ^= h >> 16; h *= 0x85EBCA6Bu;
+    h ^= h >> 13; h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h ? h : 0x6D2B79F5u; // xorshift must not start at zero
+}
+
+struct LeafStore {
+    // Simulation state
+    std::vector<float> x, y, z;
+    std::vector<float> fallSpeed;
+    std::vector<float> rotation, rotationSpeed; // Degrees, degrees per tick
+    // Appearance
+    std::vector<float> size;
+    std::vector<float> r, g, b;
+    // Kernel output: position including drift, sway and wind, ready to draw
+    std::vector<float> renderX, renderY, renderZ;
+    std::vector<uint8_t> respawn;
+    // Render position and rotation as of the previous tick
+    std::vector<float> prevRenderX, prevRenderY, prevRenderZ, prevRotation;
+    // Respawn randomness, never libc rand(): one generator per chunk
+    uint32_t seed = 0x9E3779B9u; // Set before adding leaves
+    std::vector<uint32_t> chunkRng;
+
+    size_t count() const { return x.size(); }
+
+    void clear() {
+        resize(0);
+    }
+
+    // Grows or shrinks the store; new leaves must be filled in with set()
+    void resize(size_t n) {
+        x.resize(n); y.resize(n); z.resize(n);
+        fallSpeed.resize(n); rotation.resize(n); rotationSpeed.resize(n);
+        size.resize(n); r.resize(n); g.resize(n); b.resize(n);
+        renderX.resize(n); renderY.resize(n); renderZ.resize(n);
+        respawn.resize(n);
+        prevRenderX.resize(n); prevRenderY.resize(n); prevRenderZ.resize(n); prevRotation.resize(n);
+
+        size_t chunks = (n + LEAF_SIM_CHUNK - 1) / LEAF_SIM_CHUNK;
+        while (chunkRng.size() < chunks) chunkRng.push_back(leafSimChunkSeed(seed, chunkRng.size()));
+        chunkRng.resize(chunks);
+    }
+
+    // Initializes leaf i. Distinct leaves may be set from different threads.
+    void set(size_t i, float px, float py, float pz, const float color[3], float leafSize,
+             float leafFallSpeed, float leafRotation = 0.0f, float leafRotationSpeed = 0.0f) {
+        x[i] = px; y[i] = py; z[i] = pz;
+        fallSpeed[i] = leafFallSpeed;
+        rotation[i] = leafRotation;
+        rotationSpeed[i] = leafRotationSpeed;
+        size[i] = leafSize;
+        r[i] = color[0]; g[i] = color[1]; b[i] = color[2];
+        renderX[i] = prevRenderX[i] = px;
+        renderY[i] = prevRenderY[i] = py;
+        renderZ[i] = prevRenderZ[i] = pz;
+        prevRotation[i] = leafRotation;
+        respawn[i] = 0;
+    }
+
+    void add(float px, float py, float pz, const float color[3], float leafSize,
+             float leafFallSpeed, float leafRotation = 0.0f, float leafRotationSpeed = 0.0f) {
+        resize(count() + 1);
+        set(count() - 1, px, py, pz, color, leafSize, leafFallSpeed, leafRotation, leafRotationSpeed);
+    }
+};
+
+// Per-tick inputs shared by every leaf
+struct LeafSimParams {
+    float drift;          // Phase of the horizontal drift (leafDriftSpeed)
+    float driftAmplitude; // renderX += driftAmplitude * sin(drift + z * 0.1)
+    float swayAmplitude;  // renderY += swayAmplitude * cos(2 * drift + x * 0.1)
+    float windX, windZ;   // Added to renderX/renderZ
+};
+
+// Where and how leaves come back after touching the ground
+struct LeafSpawnRange {
+    float minX, maxX, minZ, maxZ;
+    float respawnY;       // Respawn height...
+    float respawnJitter;  // ...plus up to this much
+    float minFallSpeed;
+    float fallSpeedRange; // 0 keeps the leaf's fall speed
+    bool randomRotation;
+};
+
+// --- Kernels ---
+
+typedef void (*LeafSimKernel)(LeafStore& leaves, const LeafSimParams& params, size_t begin, size_t end);
+
+inline void leafSimKernelScalar(LeafStore& leaves, const LeafSimParams& params, size_t begin, size_t end) {
+    float* x = leaves.x.data(); float* y = leaves.y.data(); float* z = leaves.z.data();
+    const float* fall = leaves.fallSpeed.data();
+    float* rot = leaves.rotation.data(); const float* spin = leaves.rotationSpeed.data();
+    float* rx = leaves.renderX.data(); float* ry = leaves.renderY.data(); float* rz = leaves.renderZ.data();
+    uint8_t* respawn = leaves.respawn.data();
+
+    for (size_t i = begin; i < end; ++i) {
+        y[i] -= fall[i];
+        rot[i] += spin[i];
+        rx[i] = x[i] + params.driftAmplitude * fastSin(params.drift + z[i] * 0.1f) + params.windX;
+        ry[i] = y[i] + params.swayAmplitude * fastCos(params.drift * 2.0f + x[i] * 0.1f);
+        rz[i] = z[i] + params.windZ;
+        respawn[i] = y[i] < 0.0f;
+    }
+}
+
+#ifdef SIMD_MATH_X86
+
+__attribute__((target("sse2")))
+inline void leafSimKernelSSE(LeafStore& leaves, const LeafSimParams& params, size_t begin, size_t end) {
+    float* x = leaves.x.data(); float* y = leaves.y.data(); float* z = leaves.z.data();
+    const float* fall = leaves.fallSpeed.data();
+    float* rot = leaves.rotation.data(); const float* spin = leaves.rotationSpeed.data();
+    float* rx = leaves.renderX.data(); float* ry = leaves.renderY.data(); float* rz = leaves.renderZ.data();
+    uint8_t* respawn = leaves.respawn.data();
+
+    const __m128 drift = _mm_set1_ps(params.drift);
+    const __m128 drift2 = _mm_set1_ps(params.drift * 2.0f);
+    const __m128 driftAmp = _mm_set1_ps(params.driftAmplitude);
+    const __m128 swayAmp = _mm_set1_ps(params.swayAmplitude);
+    const __m128 windX = _mm_set1_ps(params.windX);
+    const __m128 windZ = _mm_set1_ps(params.windZ);
+    const __m128 tenth = _mm_set1_ps(0.1f);
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 vy = _mm_sub_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(fall + i));
+        _mm_storeu_ps(y + i, vy);
+        _mm_storeu_ps(rot + i, _mm_add_ps(_mm_loadu_ps(rot + i), _mm_loadu_ps(spin + i)));
+
+        __m128 driftX = _mm_mul_ps(driftAmp, sinPs(_mm_add_ps(drift, _mm_mul_ps(vz, tenth))));
+        __m128 swayY = _mm_mul_ps(swayAmp, cosPs(_mm_add_ps(drift2, _mm_mul_ps(vx, tenth))));
+        _mm_storeu_ps(rx + i, _mm_add_ps(_mm_add_ps(vx, driftX), windX));
+        _mm_storeu_ps(ry + i, _mm_add_ps(vy, swayY));
+        _mm_storeu_ps(rz + i, _mm_add_ps(vz, windZ));
+
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(vy, zero));
+        respawn[i] = mask & 1;
+        respawn[i + 1] = (mask >> 1) & 1;
+        respawn[i + 2] = (mask >> 2) & 1;
+        respawn[i + 3] = (mask >> 3) & 1;
+    }
+    leafSimKernelScalar(leaves, params, i, end);
+}
+
+__attribute__((target("avx2")))
+inline void leafSimKernelAVX2(LeafStore& leaves, const LeafSimParams& params, size_t begin, size_t end) {
+    float* x = leaves.x.data(); float* y = leaves.y.data(); float* z = leaves.z.data();
+    const float* fall = leaves.fallSpeed.data();
+    float* rot = leaves.rotation.data(); const float* spin = leaves.rotationSpeed.data();
+    float* rx = leaves.renderX.data(); float* ry = leaves.renderY.data(); float* rz = leaves.renderZ.data();
+    uint8_t* respawn = leaves.respawn.data();
+
+    const __m256 drift = _mm256_set1_ps(params.drift);
+    const __m256 drift2 = _mm256_set1_ps(params.drift * 2.0f);
+    const __m256 driftAmp = _mm256_set1_ps(params.driftAmplitude);
+    const __m256 swayAmp = _mm256_set1_ps(params.swayAmplitude);
+    const __m256 windX = _mm256_set1_ps(params.windX);
+    const __m256 windZ = _mm256_set1_ps(params.windZ);
+    const __m256 tenth = _mm256_set1_ps(0.1f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+        __m256 vy = _mm256_sub_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(fall + i));
+        _mm256_storeu_ps(y + i, vy);
+        _mm256_storeu_ps(rot + i, _mm256_add_ps(_mm256_loadu_ps(rot + i), _mm256_loadu_ps(spin + i)));
+
+        __m256 driftX = _mm256_mul_ps(driftAmp, sin256(_mm256_add_ps(drift, _mm256_mul_ps(vz, tenth))));
+        __m256 swayY = _mm256_mul_ps(swayAmp, cos256(_mm256_add_ps(drift2, _mm256_mul_ps(vx, tenth))));
+        _mm256_storeu_ps(rx + i, _mm256_add_ps(_mm256_add_ps(vx, driftX), windX));
+        _mm256_storeu_ps(ry + i, _mm256_add_ps(vy, swayY));
+        _mm256_storeu_ps(rz + i, _mm256_add_ps(vz, windZ));
+
+        // One 0/1 byte per lane: shift the compare mask down to bit 0 and pack
+        __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cmp_ps(vy, zero, _CMP_LT_OQ)), 31);
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1));
+        _mm_storel_epi64((__m128i*)(respawn + i), _mm_packus_epi16(packed, packed));
+    }
+    leafSimKernelSSE(leaves, params, i, end);
+}
+
+#endif // SIMD_MATH_X86
+
+// Kernel by name, or nullptr if it is not available on this CPU
+inline LeafSimKernel leafSimKernelByName(const char* name) {
+    if (strcmp(name, "scalar") == 0) return leafSimKernelScalar;
+#ifdef SIMD_MATH_X86
+    if (strcmp(name, "sse") == 0) return leafSimKernelSSE;
+    if (strcmp(name, "avx2") == 0 && cpuHasAVX2()) return leafSimKernelAVX2;
+#endif
+    return nullptr;
+}
+
+struct LeafSimKernelChoice {
+    LeafSimKernel kernel;
+    const char* name;
+};
+
+// Fastest kernel for this CPU (or LEAF_SIM_KERNEL), chosen once on first
+// use. Job system workers call this concurrently; a function-local static
+// is initialized exactly once, with the other callers waiting for it.
+inline const LeafSimKernelChoice& leafSimKernelChoice() {
+    static const LeafSimKernelChoice choice = [] {
+        const char* candidates[] = { "avx2", "sse", "scalar" };
+        const char* forced = getenv("LEAF_SIM_KERNEL");
+        if (forced && leafSimKernelByName(forced)) {
+            candidates[0] = forced;
+        }
+        for (const char* name : candidates) {
+            if (LeafSimKernel kernel = leafSimKernelByName(name)) return LeafSimKernelChoice{ kernel, name };
+        }
+        return LeafSimKernelChoice{ leafSimKernelScalar, "scalar" };
+    }();
+    return choice;
+}
+
+inline LeafSimKernel leafSimKernel() {
+    return leafSimKernelChoice().kernel;
+}
+
+inline const char* leafSimKernelName() {
+    return leafSimKernelChoice().name;
+}
+
+// --- Respawn ---
+
+// xorshift32; cheap and owned by the caller, so there is no shared lock
+inline float leafSimRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+// Re-seeds every leaf flagged by the kernel in [begin, end). Returns how many respawned.
+inline size_t leafSimRespawn(LeafStore& leaves, const LeafSimParams& params, const LeafSpawnRange& spawn,
+                             size_t begin, size_t end, uint32_t& rng) {
+    size_t respawned = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (!leaves.respawn[i]) continue;
+        ++respawned;
+
+        leaves.y[i] = spawn.respawnY + leafSimRandom(rng) * spawn.respawnJitter;
+        leaves.x[i] = spawn.minX + leafSimRandom(rng) * (spawn.maxX - spawn.minX);
+        leaves.z[i] = spawn.minZ + leafSimRandom(rng) * (spawn.maxZ - spawn.minZ);
+        if (spawn.fallSpeedRange > 0.0f) {
+            leaves.fallSpeed[i] = spawn.minFallSpeed + leafSimRandom(rng) * spawn.fallSpeedRange;
+        }
+        if (spawn.randomRotation) {
+            leaves.rotation[i] = leafSimRandom(rng) * 360.0f;
+        }
+
+        leaves.renderX[i] = leaves.x[i] + params.driftAmplitude * fastSin(params.drift + leaves.z[i] * 0.1f) + params.windX;
+        leaves.renderY[i] = leaves.y[i] + params.swayAmplitude * fastCos(params.drift * 2.0f + leaves.x[i] * 0.1f);
+        leaves.renderZ[i] = leaves.z[i] + params.windZ;
+        leaves.respawn[i] = 0;
+
+        // Do not streak from the ground back up to the spawn height
+        leaves.prevRenderX[i] = leaves.renderX[i];
+        leaves.prevRenderY[i] = leaves.renderY[i];
+        leaves.prevRenderZ[i] = leaves.renderZ[i];
+        leaves.prevRotation[i] = leaves.rotation[i];
+    }
+    return respawned;
+}
+
+inline size_t leafSimChunkCount(const LeafStore& leaves) {
+    return leaves.chunkRng.size();
+}
+
+// One simulation tick for the leaves of one chunk. Distinct chunks touch
+// disjoint data and may run concurrently.
+inline void leafSimStepChunk(LeafStore& leaves, const LeafSimParams& params, const LeafSpawnRange& spawn, size_t chunk) {
+    size_t begin = chunk * LEAF_SIM_CHUNK;
+    size_t end = std::min(leaves.count(), begin + LEAF_SIM_CHUNK);
+    size_t bytes = (end - begin) * sizeof(float);
+    memcpy(&leaves.prevRenderX[begin], &leaves.renderX[begin], bytes);
+    memcpy(&leaves.prevRenderY[begin], &leaves.renderY[begin], bytes);
+    memcpy(&leaves.prevRenderZ[begin], &leaves.renderZ[begin], bytes);
+    memcpy(&leaves.prevRotation[begin], &leaves.rotation[begin], bytes);
+    leafSimKernel()(leaves, params, begin, end);
+    leafSimRespawn(leaves, params, spawn, begin, end, leaves.chunkRng[chunk]);
+}
+
+// One full simulation tick for every leaf, on the calling thread
+inline void leafSimStep(LeafStore& leaves, const LeafSimParams& params, const LeafSpawnRange& spawn) {
+    for (size_t chunk = 0; chunk < leafSimChunkCount(leaves); ++chunk) {
+        leafSimStepChunk(leaves, params, spawn, chunk);
+    }
+}
+
+// Render position and rotation of leaf i, 'alpha' of the way from the
+// previous tick to the current one
+inline void leafSimInterpolate(const LeafStore& leaves, size_t i, float alpha,
+                               float& x, float& y, float& z, float& rotation) {
+    x = leaves.prevRenderX[i] + (leaves.renderX[i] - leaves.prevRenderX[i]) * alpha;
+    y = leaves.prevRenderY[i] + (leaves.renderY[i] - leaves.prevRenderY[i]) * alpha;
+    z = leaves.prevRenderZ[i] + (leaves.renderZ[i] - leaves.prevRenderZ[i]) * alpha;
+    rotation = leaves.prevRotation[i] + (leaves.rotation[i] - leaves.prevRotation[i]) * alpha;
+}
+
+#endif // LEAF_SIM_H
@@ -0,0 +1,114 @@
+// Throughput benchmark for the leaf simulation kernels in leaf_sim.h.
+// Needs no GL context:
+//     g++ -std=c++11 -O2 leaf_sim_bench.cpp -o leaf_sim_bench
+//     ./leaf_sim_bench > leaf_sim.json
+//
+// Every kernel available on this CPU is timed at 10^4, 10^5 and 10^6 leaves,
+// both on its own and together with the respawn pass (a full leafSimStep).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "leaf_sim.h"
+
+using namespace std;
+
+const LeafSpawnRange BENCH_SPAWN = { -500.0f, 500.0f, -500.0f, 500.0f, 500.0f, 100.0f, 0.3f, 1.0f, true };
+
+void fillLeaves(LeafStore& leaves, size_t count) {
+    uint32_t rng = 12345u;
+    const float color[3] = { 0.8f, 0.4f, 0.1f };
+    leaves.clear();
+    for (size_t i = 0; i < count; ++i) {
+        leaves.add(leafSimRandom(rng) * 1000.0f - 500.0f,
+                   leafSimRandom(rng) * 500.0f,
+                   leafSimRandom(rng) * 1000.0f - 500.0f,
+                   color, 2.0f,
+                   0.3f + leafSimRandom(rng),
+                   leafSimRandom(rng) * 360.0f,
+                   leafSimRandom(rng) * 2.0f - 1.0f);
+    }
+}
+
+// Returns nanoseconds per leaf per tick, best of several repetitions
+double timeKernel(LeafSimKernel kernel, size_t count, bool withRespawn) {
+    typedef chrono::steady_clock Clock;
+    LeafStore leaves;
+    fillLeaves(leaves, count);
+
+    // Keep the total work roughly constant across sizes
+    int ticks = (int)(20000000 / count);
+    if (ticks < 5) ticks = 5;
+
+    LeafSimParams params = { 0.0f, 20.0f, 5.0f, 3.0f, -2.0f };
+    uint32_t rng = 0x9E3779B9u;
+    double best = 1e30;
+    for (int rep = 0; rep < 5; ++rep) {
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < ticks; ++t) {
+            params.drift += 0.02f;
+            kernel(leaves, params, 0, count);
+            if (withRespawn) {
+                leafSimRespawn(leaves, params, BENCH_SPAWN, 0, count, rng);
+            }
+        }
+        double ns = chrono::duration<double, nano>(Clock::now() - start).count();
+        if (ns < best) best = ns;
+    }
+
+    // Touch the output so the work cannot be optimized away
+    volatile float sink = leaves.renderX[count / 2];
+    (void)sink;
+    return best / ((double)ticks * count);
+}
+
+// Largest difference between a kernel and the scalar reference after a few ticks
+float maxError(LeafSimKernel kernel) {
+    const size_t count = 1003; // Not a multiple of the vector width
+    LeafStore reference, tested;
+    fillLeaves(reference, count);
+    fillLeaves(tested, count);
+    LeafSimParams params = { 0.0f, 20.0f, 5.0f, 3.0f, -2.0f };
+    float error = 0.0f;
+    for (int t = 0; t < 50; ++t) {
+        params.drift += 0.02f;
+        leafSimKernelScalar(reference, params, 0, count);
+        kernel(tested, params, 0, count);
+        for (size_t i = 0; i < count; ++i) {
+            error = max(error, fabsf(reference.renderX[i] - tested.renderX[i]));
+            error = max(error, fabsf(reference.renderY[i] - tested.renderY[i]));
+            if (reference.respawn[i] != tested.respawn[i]) error = 1e30f;
+        }
+    }
+    return error;
+}
+
+int main() {
+    const char* kernelNames[] = { "scalar", "sse", "avx2" };
+    const size_t sizes[] = { 10000, 100000, 1000000 };
+
+    printf("{\n");
+    printf("  \"selected_kernel\": \"%s\",\n", leafSimKernelName());
+    printf("  \"results\": [\n");
+    bool first = true;
+    for (const char* name : kernelNames) {
+        LeafSimKernel kernel = leafSimKernelByName(name);
+        if (!kernel) continue;
+        float error = maxError(kernel);
+        for (size_t count : sizes) {
+            double kernelNs = timeKernel(kernel, count, false);
+            double stepNs = timeKernel(kernel, count, true);
+            printf("%s    {\"kernel\": \"%s\", \"leaves\": %zu, \"kernel_ns_per_leaf\": %.3f, "
+                   "\"kernel_mleaves_per_s\": %.1f, \"step_ns_per_leaf\": %.3f, "
+                   "\"step_mleaves_per_s\": %.1f, \"max_abs_error\": %g}",
+                   first ? "" : ",\n", name, count, kernelNs, 1000.0 / kernelNs,
+                   stepNs, 1000.0 / stepNs, error);
+            first = false;
+        }
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
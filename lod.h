@@ -0,0 +1,130 @@
+#ifndef LOD_H
+#define LOD_H
+
+// --- Level of Detail ---
+// Every primitive and prop type comes in LOD_LEVELS tessellations, from
+// level 0 (the original detail) down to level 3. Each frame an object picks
+// a level from its projected size: the diameter in pixels its bounding
+// sphere covers from the current eye point. The switch points carry a
+// hysteresis band, so an object hovering at a threshold does not pop back
+// and forth between two levels; each object keeps its level in a LodState.
+//
+// Primitive levels are plain mesh cache entries with fewer slices and
+// stacks, so all of them can be tessellated up front with lodPrepare*().
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "mesh_cache.h"
+
+const int LOD_LEVELS = 4;
+
+// Fraction of the full slice/stack count kept at each level
+const float LOD_DETAIL[LOD_LEVELS] = { 1.0f, 0.6f, 0.35f, 0.2f };
+
+// Projected diameter in pixels below which level i hands over to level i + 1
+const float LOD_SWITCH_PIXELS[LOD_LEVELS - 1] = { 240.0f, 80.0f, 24.0f };
+
+// An object only changes level once it is this far past a switch point
+const float LOD_HYSTERESIS = 0.15f;
+
+// Eye point and projection scale the projected sizes are measured with
+struct LodView {
+    float eyeX = 0.0f, eyeY = 0.0f, eyeZ = 0.0f;
+    float pixelsPerUnit = 1.0f; // Pixels covered by one unit at distance 1
+};
+
+inline LodView& lodView() {
+    static LodView view;
+    return view;
+}
+
+// Call after setting up the camera, with the values given to gluPerspective
+inline void lodSetView(float eyeX, float eyeY, float eyeZ, float fovYDegrees, int viewportHeight) {
+    LodView& view = lodView();
+    view.eyeX = eyeX; view.eyeY = eyeY; view.eyeZ = eyeZ;
+    view.pixelsPerUnit = viewportHeight / (2.0f * tanf(fovYDegrees * MESH_PI / 360.0f));
+}
+
+// Diameter in pixels of a sphere whose nearest point is 'distance' from the eye
+inline float lodPixelsAtDistance(float radius, float distance) {
+    return 2.0f * radius * lodView().pixelsPerUnit / std::max(distance, std::max(radius, 1.0f));
+}
+
+inline float lodProjectedPixels(float x, float y, float z, float radius) {
+    const LodView& view = lodView();
+    float dx = x - view.eyeX, dy = y - view.eyeY, dz = z - view.eyeZ;
+    return lodPixelsAtDistance(radius, sqrtf(dx * dx + dy * dy + dz * dz));
+}
+
+// Level for an object of 'pixels' projected size that currently uses 'current'
+inline int lodSelect(int current, float pixels) {
+    int level = current;
+    while (level > 0 && pixels > LOD_SWITCH_PIXELS[level - 1] * (1.0f + LOD_HYSTERESIS)) --level;
+    while (level < LOD_LEVELS - 1 && pixels < LOD_SWITCH_PIXELS[level] * (1.0f - LOD_HYSTERESIS)) ++level;
+    return level;
+}
+
+// Per-object level, carried from frame to frame for the hysteresis
+struct LodState {
+    uint8_t level = 0;
+
+    int update(float pixels) {
+        level = (uint8_t)lodSelect(level, pixels);
+        return level;
+    }
+
+    int update(float x, float y, float z, float radius) {
+        return update(lodProjectedPixels(x, y, z, radius));
+    }
+};
+
+// Slice or stack count for 'level' of a primitive tessellated 'full' ways at level 0
+inline int lodSegments(int full, int level, int minimum) {
+    return std::max(std::min(full, minimum), (int)(full * LOD_DETAIL[level] + 0.5f));
+}
+
+inline void drawLodSphere(float radius, int slices, int stacks, int level) {
+    drawSolidSphere(radius, lodSegments(slices, level, 6), lodSegments(stacks, level, 4));
+}
+
+inline void drawLodCylinder(float baseRadius, float topRadius, float height, int slices, int stacks, int level) {
+    drawSolidCylinder(baseRadius, topRadius, height, lodSegments(slices, level, 6), lodSegments(stacks, level, 1));
+}
+
+// Tessellates every level of a sphere up front instead of on first sight
+inline void lodPrepareSphere(int slices, int stacks) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        getPrimitiveMesh(MESH_SPHERE, lodSegments(slices, level, 6), lodSegments(stacks, level, 4), 0.0f);
+    }
+}
+
+inline void lodPrepareCylinder(float ratio, int slices, int stacks) {
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        getPrimitiveMesh(MESH_CYLINDER, lodSegments(slices, level, 6), lodSegments(stacks, level, 1), ratio);
+    }
+}
+
+// Objects drawn at each level: the last frame plus running totals
+struct LodCounter {
+    int objects[LOD_LEVELS] = { 0, 0, 0, 0 };
+    long long totalObjects[LOD_LEVELS] = { 0, 0, 0, 0 };
+
+    void beginFrame() {
+        for (int i = 0; i < LOD_LEVELS; ++i) objects[i] = 0;
+    }
+
+    void resetTotals() {
+        for (int i = 0; i < LOD_LEVELS; ++i) totalObjects[i] = 0;
+    }
+
+    // Records 'count' objects at 'level' and returns 'level'
+    int record(int level, int count = 1) {
+        objects[level] += count;
+        totalObjects[level] += count;
+        return level;
+    }
+};
+
+#endif // LOD_H
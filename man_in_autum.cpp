@@ -1,8 +1,11 @@
 #include <iostream>
+#include <chrono>
 #include <cmath>
+#include <string>
 #include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <memory>
 
 #include <GL/gl.h>
 #include <GL/glu.h>
@@ -13,6 +16,27 @@
 #include <GL/glut.h>
 #endif
 
+#include "mesh_cache.h"
+#include "asset_cache.h"
+#include "async_loader.h"
+#include "cloud_batch.h"
+#include "frame_profiler.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "impostor.h"
+#include "instance_batch.h"
+#include "job_system.h"
+#include "leaf_sim.h"
+#include "lod.h"
+#include "procedural_texture.h"
+#include "render_queue.h"
+#include "scene_rng.h"
+#include "scene_bench.h"
+#include "sim_clock.h"
+#include "sky_dome.h"
+#include "spatial_grid.h"
+#include "trace_events.h"
+
 #ifndef GL_MULTISAMPLE
 #define GL_MULTISAMPLE 0x809D
 #endif
@@ -26,6 +50,9 @@ using namespace std;
 // --- Global Constants ---
 const int WINDOW_WIDTH = 1200;
 const int WINDOW_HEIGHT = 800;
+const char* const WINDOW_TITLE = "Enhanced Realistic 3D Autumn Scene - with Mountains";
+const float FIELD_OF_VIEW = 60.0f; // Vertical, in degrees
+const float FAR_CLIP = 6000.0f;
 const int NUM_LEAVES = 500; // Increased for more atmosphere
 
 // --- Camera & Interaction Globals ---
@@ -65,24 +92,87 @@ const float WIND_CHANGE_RATE = 0.02f;
 
 // --- Sky System ---
 float skyColorTransition = 0.0f;
+SkyDome skyDome;
+const float SUN_RADIUS = 60.0f;
 struct Cloud {
-    float x, y, z;
+    float x, y, z;       // Bounded by a sphere of 1.6 * size around (x, y, z)
+    float prevX; // x as of the previous tick
     float size;
     float speed;
     float density;
+    LodState lod;
 };
 vector<Cloud> clouds;
-
-// --- Leaf Structure ---
-struct Leaf {
-    float x, y, z;
-    float color[3];
-    float size;
-    float fallSpeed;
-    float rotationSpeed;
-    float rotation;
+SceneRng cloudRng = { 0, 0 }; // Cloud respawn stream, owned by stepClouds()
+int cloudCount = 35;          // --clouds <n>
+bool cloudSprites = false;    // --cloud-sprites or B: clouds at CLOUD_SPRITE_LEVEL and up as sprites
+const int CLOUD_SPRITE_LEVEL = 2;
+CloudBatch cloudBatch;        // Every visible cloud, rebuilt each frame
+long long totalMeshClouds = 0;
+long long totalSpriteClouds = 0;
+
+// --- Leaves ---
+LeafStore fallingLeaves;     // Structure-of-arrays, stepped by the SIMD leaf kernel
+const LeafSpawnRange LEAF_SPAWN = { -500.0f, 500.0f, -500.0f, 500.0f, 500.0f, 100.0f, 0.3f, 1.0f, true };
+DynamicStream leafTriangles; // Rebuilt every frame from fallingLeaves
+DynamicStream leafStems;
+
+// --- Culling ---
+// Objects are tested against the view frustum before any GL work
+enum CullCategory {
+    CULL_HILLS, CULL_MOUNTAINS, CULL_DISTANT_TREES, CULL_LEAF_PILES, CULL_PUMPKINS,
+    CULL_FLOWERS, CULL_CLOUDS, CULL_TREE_TRUNKS, CULL_TREE_CANOPIES, CULL_LEAVES,
+    CULL_CATEGORY_COUNT
+};
+const char* const CULL_CATEGORY_NAMES[CULL_CATEGORY_COUNT] = {
+    "hills", "mountains", "distant_trees", "leaf_piles", "pumpkins",
+    "flowers", "clouds", "tree_trunks", "tree_canopies", "leaves"
+};
+CullCounter cullCounters[CULL_CATEGORY_COUNT];
+Frustum viewFrustum;
+
+// --- Level of Detail ---
+// Visible objects pick a tessellation level by projected size (lod.h),
+// counted per cull category
+LodCounter lodCounters[CULL_CATEGORY_COUNT];
+LodState manLod;
+int viewportHeight = WINDOW_HEIGHT;
+int frameTriangles = 0;        // Mesh triangles submitted by the last frame
+long long totalTriangles = 0;
+
+// --- Fixed Timestep ---
+// The simulation ticks at a fixed rate from idleScene(); drawScene() blends
+// the previous and current tick by renderAlpha.
+SimClock simClock(60.0);
+float renderAlpha = 1.0f;
+
+// Scalar simulation state drawn with interpolation
+struct SceneSnapshot {
+    float cameraAngle, cameraPitch, distanceFromMan;
+    float walkPhase;
+    float sunAngle, timeOfDay;
+    float jacketColor[3];
 };
-vector<Leaf> fallingLeaves;
+SceneSnapshot previousSnapshot; // Taken at the start of the latest tick
+SceneSnapshot renderSnapshot;   // What the current frame draws
+
+SceneSnapshot captureSnapshot() {
+    SceneSnapshot snapshot = { cameraAngle, cameraPitch, distanceFromMan, walkPhase, sunAngle, timeOfDay,
+                               { jacketColor[0], jacketColor[1], jacketColor[2] } };
+    return snapshot;
+}
+
+SceneSnapshot blendSnapshots(const SceneSnapshot& a, const SceneSnapshot& b, float t) {
+    SceneSnapshot out;
+    out.cameraAngle = simLerp(a.cameraAngle, b.cameraAngle, t);
+    out.cameraPitch = simLerp(a.cameraPitch, b.cameraPitch, t);
+    out.distanceFromMan = simLerp(a.distanceFromMan, b.distanceFromMan, t);
+    out.walkPhase = simLerpWrapped(a.walkPhase, b.walkPhase, t, 2.0f * M_PI);
+    out.sunAngle = simLerpWrapped(a.sunAngle, b.sunAngle, t, 2.0f * M_PI);
+    out.timeOfDay = simLerp(a.timeOfDay, b.timeOfDay, t);
+    for (int i = 0; i < 3; ++i) out.jacketColor[i] = simLerp(a.jacketColor[i], b.jacketColor[i], t);
+    return out;
+}
 
 // --- Ground Objects ---
 struct Pumpkin {
@@ -91,26 +181,52 @@ struct Pumpkin {
     float rotation;
 };
 vector<Pumpkin> pumpkins;
+const int NUM_PUMPKINS = 25;
+Mesh pumpkinMeshes[LOD_LEVELS]; // Unit-size pumpkin per LOD level, baked once at startup
+TiledInstanceBatch pumpkinBatch; // One instance per Pumpkin record
 
 struct Flower {
     float x, z;
     float color[3];
     float petalRotation;
+    BoundingSphere bounds;
+    LodState lod;
 };
 vector<Flower> flowers;
 
+const int LEAVES_PER_PILE = 8;
 struct LeafPile {
     float x, z;
     float size;
     float height;
+    float groundY;
+    // Baked in initializeLeaves() so drawing does no rand() calls
+    float leafOffset[LEAVES_PER_PILE][3];
+    float leafColor[LEAVES_PER_PILE][3];
+    BoundingSphere bounds;
+    LodState lod;
 };
 vector<LeafPile> leafPiles;
 
+// --- Forest ---
+// Foreground trees are two instance batches sharing one trunk and one canopy mesh
+const int FOREST_GRID_RADIUS = 3; // (2 * 3 + 1)^2 - 1 = 48 trees
+const float FOREST_TREE_SPACING = 180.0f;
+Mesh treeTrunkMeshes[LOD_LEVELS];
+Mesh treeCanopyMeshes[LOD_LEVELS];
+TiledInstanceBatch treeTrunkBatch;
+TiledInstanceBatch treeCanopyBatch;
+vector<BoundingSphere> forestTreeBounds; // One per tree, for the spatial grid
+
 // --- Background Elements ---
 struct DistantTree {
     float x, z;
     float height;
     float width;
+    float foliageColor[3];
+    BoundingSphere bounds;
+    LodState lod;
+    uint8_t impostorSets; // Bit s: baked into far-field texture set s
 };
 vector<DistantTree> distantTrees;
 
@@ -119,302 +235,549 @@ struct Hill {
     float radius;
     float height;
     bool isMountain; // NEW: distinguish mountains from hills
+    float color[3];
+    BoundingSphere bounds;
+    LodState lod;
+    uint8_t impostorSets; // Bit s: baked into far-field texture set s
 };
 vector<Hill> hills;
 
+// --- Spatial Index ---
+// Static props are binned into uniform XZ grids once at startup. Culling and
+// proximity queries only visit the grid cells they overlap, so their cost
+// follows what is near the view rather than the total prop count.
+SpatialGrid pumpkinGrid;
+SpatialGrid flowerGrid;
+SpatialGrid leafPileGrid;
+SpatialGrid forestGrid;
+SpatialGrid distantTreeGrid;
+const float PROXIMITY_RADIUS = 150.0f; // Reach of the "props near the man" query
+
+// --- Terrain ---
+// Heights are cached on the same grid the ground mesh is built from. The
+// mesh is split into square tiles so distant ones can be culled or baked.
+const int TERRAIN_GRID_SIZE = 60;
+const float TERRAIN_CELL_SIZE = 80.0f;
+const int TERRAIN_TILE_CELLS = 6; // Grid cells along one side of a ground tile
+vector<float> terrainHeights; // (TERRAIN_GRID_SIZE + 1)^2, indexed [i * (TERRAIN_GRID_SIZE + 1) + j]
+struct TerrainTile {
+    Mesh mesh;
+    BoundingSphere bounds;
+    float boxLo[3], boxHi[3];
+    uint8_t impostorSets; // Bit s: baked into far-field texture set s
+};
+vector<TerrainTile> terrainTiles;
+
+// --- Far-Field Impostor ---
+// Ground tiles, hills and distant trees with nothing closer than
+// FAR_FIELD_RADIUS to the eye are baked into a panorama (impostor.h) and
+// drawn as a backdrop instead. Which objects went into a texture set is kept
+// per object, so the live pass always skips exactly what the backdrop shows.
+// A rebake starts once the eye, the sun or the sky colour has drifted far
+// enough from what the front set was baked with.
+PanoramaImpostor farField;
+const float FAR_FIELD_RADIUS = 900.0f;
+const int IMPOSTOR_PANEL_SIZE = 512;
+const float IMPOSTOR_BOTTOM = -40.0f; // Elevation range of the panorama, degrees
+const float IMPOSTOR_TOP = 35.0f;
+const int IMPOSTOR_PANELS_PER_FRAME = 2;
+const float IMPOSTOR_REBAKE_DISTANCE = 20.0f;
+const float IMPOSTOR_REBAKE_SUN_ANGLE = 0.08f;  // Radians
+const float IMPOSTOR_REBAKE_SKY_COLOR = 0.02f;  // Largest change of one channel
+float impostorSunAngle[2];
+float impostorSkyColor[2][3];
+int impostorBakedObjects[2];       // Hills and distant trees in each texture set
+long long impostorBakeTriangles = 0; // Mesh triangles drawn while baking, all frames
+
+// --- Render Queues ---
+RenderQueue sceneQueue; // Opaque scene of the current frame
+RenderQueue bakeQueue;  // Far-field panels
+
 // --- Textures ---
 GLuint barkTexture;
 GLuint groundTexture;
+int textureSize = TEXTURE_REFERENCE_SIZE; // --texture-size
+double textureGenerateMs = 0.0;
+double textureUploadMs = 0.0;
+
+// --- Asset Cache ---
+// Textures, the terrain and the pumpkin and tree prototypes are kept in an
+// asset cache file (asset_cache.h) keyed by everything they are generated
+// from. A matching file is mapped and used instead of generating them.
+// The terrain and prototypes do not depend on the scene seed, so it is not
+// part of the key. The textures do: they are stored with the seed they were
+// generated from and only used when it matches. They are only written when
+// the seed repeats (--seed or a benchmark). Interactive runs pick a new seed
+// each launch, so they map the file for the meshes but never rewrite it.
+const uint32_t SCENE_ASSET_VERSION = 1; // Bump when a generator changes its output
+enum SceneAsset {
+    ASSET_BARK_TEXTURE,
+    ASSET_GROUND_TEXTURE,
+    ASSET_TERRAIN_HEIGHTS,
+    ASSET_TERRAIN_TILE,
+    ASSET_PUMPKIN_MESH,
+    ASSET_TREE_TRUNK_MESH,
+    ASSET_TREE_CANOPY_MESH,
+    ASSET_TEXTURE_SEED      // Seed the cached textures were generated from
+};
+string assetCachePath = "man_in_autum.cache"; // --asset-cache; empty: off
+bool assetCacheHit = false;          // Terrain and prototypes came from the cache
+bool assetCacheTextureHit = false;   // So did the textures
+bool assetCacheWritten = false;
+size_t assetCacheBytes = 0;  // Mapped or written
+double assetBuildMs = 0.0;   // Terrain and prototypes, loaded or generated
+double assetWriteMs = 0.0;
+
+// --- Startup ---
+// initialize() builds what the first frame needs on the GL thread: the
+// terrain and the prototype meshes (from the asset cache when it matches),
+// the sky and the cloud layout. The props, leaves and clouds are populated
+// and the textures generated on the loader thread (async_loader.h). Until
+// the population is handed over, frames show the ground, the man and the
+// sky; until its texture is uploaded, the ground or bark is drawn in its
+// flat material color.
+AsyncLoader sceneLoader;
+bool sceneLoaded = false;  // Props, leaves and clouds may be read; GL thread
+bool fullyLoaded = false;  // Everything the loader posted has run
+const size_t LOAD_UPLOAD_BUDGET = 4 << 20; // Texture bytes uploaded per frame while loading
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+double firstFrameMs = 0.0;  // From process start to the end of the first frame
+double fullyLoadedMs = 0.0; // ... to the end of the first frame with everything in
+int loadingFrames = 0;      // Frames drawn up to and including that one
+
+// --- Frame Profile ---
+// Sections the frame profiler (frame_profiler.h) times, in HUD and CSV
+// order. Simulation systems run on the job system and are timed on the CPU
+// only, summed over however many ticks the frame ran. The opaque passes
+// only record into the render queue; their CPU time is recording (culling,
+// LOD selection, queuing) and their GPU time is what the queue's sorted
+// submission spent on their items. "submit" is the CPU side of that
+// submission.
+enum ProfileSection {
+    PROFILE_UPDATE, PROFILE_CAMERA, PROFILE_LEAF_SIM, PROFILE_CLOUD_SIM, PROFILE_MAN_SKY,
+    PROFILE_UPLOADS, PROFILE_FAR_FIELD_BAKE,
+    PROFILE_GROUND, PROFILE_HILLS, PROFILE_DISTANT_TREES, PROFILE_LEAF_PILES, PROFILE_PUMPKINS,
+    PROFILE_FLOWERS, PROFILE_FOREST, PROFILE_MAN, PROFILE_SUBMIT,
+    PROFILE_SKY, PROFILE_FAR_FIELD, PROFILE_CLOUDS, PROFILE_LEAVES,
+    PROFILE_SECTION_COUNT
+};
+
+const ProfileSectionDesc PROFILE_SECTIONS[PROFILE_SECTION_COUNT] = {
+    { "update", false, 0 }, { "camera", false, 1 }, { "leaf_sim", false, 1 }, { "cloud_sim", false, 1 },
+    { "man_sky", false, 1 },
+    { "uploads", true, 0 }, { "far_field_bake", true, 0 },
+    { "ground", true, 0 }, { "hills", true, 0 }, { "distant_trees", true, 0 }, { "leaf_piles", true, 0 },
+    { "pumpkins", true, 0 }, { "flowers", true, 0 }, { "forest", true, 0 }, { "man", true, 0 },
+    { "submit", false, 0 },
+    { "sky", true, 0 }, { "far_field", true, 0 }, { "clouds", true, 0 }, { "leaves", true, 0 }
+};
+
+bool profilerHud = false;   // P: rolling per-section times over the scene
+string profileCsvPath;      // --profile-csv <path>: one row per frame
+bool profileFromStart = false; // --profile: profile without the HUD, e.g. in benchmarks
 
 // --- Utility Functions ---
 
 void setMaterialColor(float r, float g, float b) {
-    GLfloat ambient[] = { r * 0.3f, g * 0.3f, b * 0.3f, 1.0f };
-    GLfloat diffuse[] = { r, g, b, 1.0f };
-    GLfloat specular[] = { 0.3f, 0.3f, 0.3f, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT, ambient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, specular);
-    glMaterialf(GL_FRONT, GL_SHININESS, 32.0f);
-    glColor3f(r, g, b);
-}
-
-void drawCylinder(float baseRadius, float topRadius, float height) {
-    GLUquadricObj *quadric = gluNewQuadric();
-    gluQuadricNormals(quadric, GLU_SMOOTH);
-    gluCylinder(quadric, baseRadius, topRadius, height, 24, 1);
-    gluDeleteQuadric(quadric);
-}
-
-// IMPROVED: Higher quality bark texture
-GLuint createBarkTexture() {
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    const int SIZE = 512; // Increased from 256
-    unsigned char data[SIZE * SIZE * 3];
-    
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            int idx = (i * SIZE + j) * 3;
-            float verticalPattern = sin(j * 0.15f) * 25.0f;
-            float horizontalPattern = sin(i * 0.05f) * 15.0f;
-            float noise = (rand() % 30 - 15);
-            float detail = verticalPattern + horizontalPattern + noise;
-            
-            data[idx] = 55 + detail;
-            data[idx+1] = 35 + detail;
-            data[idx+2] = 15 + detail;
+    applyMaterialColor(r, g, b);
+}
+
+void queueCylinder(RenderQueue& queue, float baseRadius, float topRadius, float height, int level = 0) {
+    queueLodCylinder(queue, baseRadius, topRadius, height, 24, 1, level);
+}
+
+// Level for a visible object, counted under its cull category
+int selectLod(LodState& lod, const BoundingSphere& bounds, CullCategory category) {
+    return lodCounters[category].record(lod.update(bounds.x, bounds.y, bounds.z, bounds.radius));
+}
+
+// Bark: vertical grain plus slow horizontal bands. Ground: a grass check
+// pattern in red and green. Both get coarse per-texel noise.
+const ProceduralTextureDesc BARK_TEXTURE = {
+    { 55.0f, 35.0f, 15.0f }, { 1.0f, 1.0f, 1.0f },
+    { 15.0f, 0.05f }, { 25.0f, 0.15f }, { 0.0f, 0.0f }, { 0.0f, 0.0f }, 30
+};
+const ProceduralTextureDesc GROUND_TEXTURE = {
+    { 35.0f, 65.0f, 15.0f }, { 1.0f, 1.0f, 0.0f },
+    { 0.0f, 0.0f }, { 0.0f, 0.0f }, { 10.0f, 0.3f }, { 1.0f, 0.3f }, 40
+};
+
+// Generates both textures and their mip chains on the job system. Runs on
+// the loader thread; the GL thread uploads them.
+void generateTextures(TextureImage& bark, TextureImage& ground) {
+    TraceScope scope("generateTextures", "load");
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    generateProceduralTexture(BARK_TEXTURE, textureSize, sceneRngKey(sceneSeed(), RNG_BARK_TEXTURE, 0), bark);
+    generateProceduralTexture(GROUND_TEXTURE, textureSize, sceneRngKey(sceneSeed(), RNG_GROUND_TEXTURE, 0), ground);
+    textureGenerateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Uploads a mip chain LOAD_UPLOAD_BUDGET bytes per frame and points
+// 'texture' at it once complete; 'owner' keeps the texels alive until then
+GlTask textureUploadTask(GLuint& texture, const unsigned char* texels, shared_ptr<const void> owner) {
+    shared_ptr<TextureChainUpload> upload = make_shared<TextureChainUpload>();
+    return [&texture, texels, owner, upload](size_t& budget) {
+        TraceScope scope("textureUpload", "load");
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        if (upload->texture == 0) upload->begin(texels, textureSize);
+        size_t available = budget;
+        bool done = upload->step(budget);
+        scope.setArg("bytes", (int64_t)(available - budget));
+        glState().invalidateTextures(); // The upload binds behind the cache's back
+        textureUploadMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (done) texture = upload->texture;
+        return done;
+    };
+}
+
+// Rolling ground height; only evaluated when the terrain is built
+float terrainFormula(float x, float z) {
+    return 3.0f * sin(x * 0.008f + z * 0.008f) + 
+           1.5f * cos(x * 0.02f) * sin(z * 0.015f);
+}
+
+// Bounding sphere and box of a tile's mesh
+void measureTerrainTile(TerrainTile& tile) {
+    tile.bounds = meshBoundingSphere(tile.mesh);
+    const vector<float>& p = tile.mesh.positions;
+    for (int k = 0; k < 3; k++) tile.boxLo[k] = tile.boxHi[k] = p[k];
+    for (size_t v = 0; v < p.size(); v += 3) {
+        for (int k = 0; k < 3; k++) {
+            tile.boxLo[k] = min(tile.boxLo[k], p[v + k]);
+            tile.boxHi[k] = max(tile.boxHi[k], p[v + k]);
         }
     }
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SIZE, SIZE, 0, 
-                 GL_RGB, GL_UNSIGNED_BYTE, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, SIZE, SIZE, 
-                      GL_RGB, GL_UNSIGNED_BYTE, data);
-    
-    return texture;
 }
 
-// IMPROVED: Higher quality ground texture
-GLuint createGroundTexture() {
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+// Builds the cached height field and the ground mesh with analytic normals.
+// Triangles match the old per-frame triangle strips, one strip per grid column.
+void buildTerrain() {
+    const int gridSize = TERRAIN_GRID_SIZE;
+    const float cellSize = TERRAIN_CELL_SIZE;
+    const int row = gridSize + 1;
     
-    const int SIZE = 512; // Increased from 256
-    unsigned char data[SIZE * SIZE * 3];
+    terrainHeights.assign(row * row, 0.0f);
+    for (int i = 0; i <= gridSize; i++) {
+        for (int j = 0; j <= gridSize; j++) {
+            float x = (i - gridSize/2) * cellSize;
+            float z = (j - gridSize/2) * cellSize;
+            terrainHeights[i * row + j] = terrainFormula(x, z);
+        }
+    }
     
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            int idx = (i * SIZE + j) * 3;
-            float grassPattern = sin(i * 0.3f) * sin(j * 0.3f) * 10.0f;
-            float variation = (rand() % 40 - 20);
+    // Each tile repeats the vertices along its edges, so tiles line up exactly
+    const int tiles = (gridSize + TERRAIN_TILE_CELLS - 1) / TERRAIN_TILE_CELLS;
+    terrainTiles.assign(tiles * tiles, TerrainTile());
+    for (int ti = 0; ti < tiles; ti++) {
+        for (int tj = 0; tj < tiles; tj++) {
+            TerrainTile& tile = terrainTiles[ti * tiles + tj];
+            int i0 = ti * TERRAIN_TILE_CELLS, i1 = min(gridSize, i0 + TERRAIN_TILE_CELLS);
+            int j0 = tj * TERRAIN_TILE_CELLS, j1 = min(gridSize, j0 + TERRAIN_TILE_CELLS);
+            const int tileRow = j1 - j0 + 1;
+            
+            for (int i = i0; i <= i1; i++) {
+                for (int j = j0; j <= j1; j++) {
+                    float x = (i - gridSize/2) * cellSize;
+                    float z = (j - gridSize/2) * cellSize;
+                    
+                    // Normal from the partial derivatives of terrainFormula
+                    float ridge = 3.0f * 0.008f * cos(x * 0.008f + z * 0.008f);
+                    float dhdx = ridge - 1.5f * 0.02f * sin(x * 0.02f) * sin(z * 0.015f);
+                    float dhdz = ridge + 1.5f * 0.015f * cos(x * 0.02f) * cos(z * 0.015f);
+                    float len = sqrt(dhdx * dhdx + 1.0f + dhdz * dhdz);
+                    
+                    tile.mesh.addVertex(x, terrainHeights[i * row + j], z, -dhdx / len, 1.0f / len, -dhdz / len);
+                    tile.mesh.texCoords.push_back(i * 0.3f);
+                    tile.mesh.texCoords.push_back(j * 0.3f);
+                }
+            }
             
-            data[idx] = 35 + grassPattern + variation;
-            data[idx+1] = 65 + grassPattern + variation;
-            data[idx+2] = 15 + variation;
+            for (int i = 0; i < i1 - i0; i++) {
+                for (int j = 0; j < j1 - j0; j++) {
+                    unsigned int a0 = (i + 1) * tileRow + j, a1 = a0 + 1; // x2 column
+                    unsigned int b0 = i * tileRow + j, b1 = b0 + 1;       // x1 column
+                    tile.mesh.addTriangle(a0, b0, a1);
+                    tile.mesh.addTriangle(a1, b0, b1);
+                }
+            }
+            measureTerrainTile(tile);
         }
     }
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SIZE, SIZE, 0, 
-                 GL_RGB, GL_UNSIGNED_BYTE, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, SIZE, SIZE, 
-                      GL_RGB, GL_UNSIGNED_BYTE, data);
-    
-    return texture;
 }
 
-void initializeLeaves() {
-    srand(time(0));
-    fallingLeaves.clear();
+// Ground height at (x, z), interpolated on the same triangles the ground is drawn with.
+// Points outside the grid are clamped to its edge.
+float heightAt(float x, float z) {
+    const int gridSize = TERRAIN_GRID_SIZE;
+    const int row = gridSize + 1;
+    
+    float fx = x / TERRAIN_CELL_SIZE + gridSize/2;
+    float fz = z / TERRAIN_CELL_SIZE + gridSize/2;
+    if (fx < 0.0f) fx = 0.0f;
+    if (fz < 0.0f) fz = 0.0f;
+    if (fx > gridSize) fx = (float)gridSize;
+    if (fz > gridSize) fz = (float)gridSize;
+    
+    int i = (int)fx, j = (int)fz;
+    if (i >= gridSize) i = gridSize - 1;
+    if (j >= gridSize) j = gridSize - 1;
+    float tx = fx - i, tz = fz - j;
+    
+    float h00 = terrainHeights[i * row + j];
+    float h10 = terrainHeights[(i + 1) * row + j];
+    float h01 = terrainHeights[i * row + j + 1];
+    float h11 = terrainHeights[(i + 1) * row + j + 1];
+    
+    // Each cell is split along its (i, j)-(i+1, j+1) diagonal
+    if (tx >= tz) return h00 + (h10 - h00) * tx + (h11 - h10) * tz;
+    return h00 + (h11 - h01) * tx + (h01 - h00) * tz;
+}
 
-    for (int i = 0; i < NUM_LEAVES; ++i) {
-        Leaf l;
-        l.x = (rand() % 1000) - 500.0f;
-        l.y = (rand() % 400) + 100.0f;
-        l.z = (rand() % 1000) - 500.0f;
-
-        float r = static_cast <float> (rand()) / RAND_MAX;
-        if (r < 0.25f) { l.color[0] = 0.8f; l.color[1] = 0.2f; l.color[2] = 0.0f; }
-        else if (r < 0.50f) { l.color[0] = 1.0f; l.color[1] = 0.5f; l.color[2] = 0.0f; }
-        else if (r < 0.75f) { l.color[0] = 1.0f; l.color[1] = 0.8f; l.color[2] = 0.0f; }
-        else { l.color[0] = 0.6f; l.color[1] = 0.3f; l.color[2] = 0.1f; }
-
-        l.size = 1.5f + (static_cast <float> (rand() % 100) / 100.0f) * 1.5f;
-        l.fallSpeed = 0.3f + (static_cast <float> (rand() % 100) / 100.0f) * 1.0f;
-        l.rotationSpeed = (rand() % 100) / 50.0f - 1.0f;
-        l.rotation = rand() % 360;
-        
-        fallingLeaves.push_back(l);
-    }
-    
-    pumpkins.clear();
-    for (int i = 0; i < 25; ++i) {
-        Pumpkin p;
-        p.x = (rand() % 800) - 400.0f;
-        p.z = (rand() % 800) - 400.0f;
-        p.size = 12.0f + (rand() % 100) / 100.0f * 12.0f;
-        p.rotation = rand() % 360;
-        pumpkins.push_back(p);
-    }
+// Every object is generated from its own SceneRng stream keyed by
+// (sceneSeed(), kind, index), so each loop runs as a parallelFor and the
+// scene is identical for a given --seed regardless of thread count.
+void initializeLeaves() {
+    TraceScope scope("initializeLeaves", "load");
+    const uint64_t seed = sceneSeed();
+    const size_t GRAIN = 16;
     
-    flowers.clear();
-    for (int i = 0; i < 40; ++i) {
-        Flower f;
-        f.x = (rand() % 800) - 400.0f;
-        f.z = (rand() % 800) - 400.0f;
-        f.petalRotation = rand() % 360;
-        
-        float colorChoice = static_cast <float> (rand()) / RAND_MAX;
-        if (colorChoice < 0.3f) { f.color[0] = 1.0f; f.color[1] = 0.8f; f.color[2] = 0.0f; }
-        else if (colorChoice < 0.5f) { f.color[0] = 1.0f; f.color[1] = 0.5f; f.color[2] = 0.0f; }
-        else if (colorChoice < 0.7f) { f.color[0] = 0.9f; f.color[1] = 0.3f; f.color[2] = 0.2f; }
-        else { f.color[0] = 0.8f; f.color[1] = 0.6f; f.color[2] = 0.9f; }
-        
-        flowers.push_back(f);
+    fallingLeaves.clear();
+    fallingLeaves.seed = (uint32_t)sceneRngKey(seed, RNG_LEAF_RESPAWN, 0);
+    fallingLeaves.resize(NUM_LEAVES);
+    parallelFor(0, NUM_LEAVES, 64, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_LEAF, i);
+            float x = rng.range(-500.0f, 500.0f);
+            float y = rng.range(100.0f, 500.0f);
+            float z = rng.range(-500.0f, 500.0f);
+
+            float color[3];
+            float r = rng.uniform();
+            if (r < 0.25f) { color[0] = 0.8f; color[1] = 0.2f; color[2] = 0.0f; }
+            else if (r < 0.50f) { color[0] = 1.0f; color[1] = 0.5f; color[2] = 0.0f; }
+            else if (r < 0.75f) { color[0] = 1.0f; color[1] = 0.8f; color[2] = 0.0f; }
+            else { color[0] = 0.6f; color[1] = 0.3f; color[2] = 0.1f; }
+
+            float size = rng.range(1.5f, 3.0f);
+            float fallSpeed = rng.range(0.3f, 1.3f);
+            float rotationSpeed = rng.range(-1.0f, 1.0f);
+            float rotation = rng.range(0.0f, 360.0f);
+            
+            fallingLeaves.set(i, x, y, z, color, size, fallSpeed, rotation, rotationSpeed);
+        }
+    });
+    
+    pumpkins.assign(NUM_PUMPKINS, Pumpkin());
+    parallelFor(0, NUM_PUMPKINS, GRAIN, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_PUMPKIN, i);
+            Pumpkin& p = pumpkins[i];
+            p.x = rng.range(-400.0f, 400.0f);
+            p.z = rng.range(-400.0f, 400.0f);
+            p.size = rng.range(12.0f, 24.0f);
+            p.rotation = rng.range(0.0f, 360.0f);
+        }
+    });
+    pumpkinBatch.clear();
+    for (const auto& p : pumpkins) {
+        // Raised to 1.1f * size to be clearly above ground
+        pumpkinBatch.add(makeInstance(p.x, heightAt(p.x, p.z) + p.size * 1.1f, p.z, p.rotation, p.size));
     }
     
-    leafPiles.clear();
-    for (int i = 0; i < 35; ++i) {
-        LeafPile lp;
-        lp.x = (rand() % 800) - 400.0f;
-        lp.z = (rand() % 800) - 400.0f;
-        lp.size = 20.0f + (rand() % 100) / 100.0f * 25.0f;
-        lp.height = 4.0f + (rand() % 100) / 100.0f * 6.0f;
-        leafPiles.push_back(lp);
-    }
+    flowers.assign(40, Flower());
+    parallelFor(0, flowers.size(), GRAIN, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_FLOWER, i);
+            Flower& f = flowers[i];
+            f.x = rng.range(-400.0f, 400.0f);
+            f.z = rng.range(-400.0f, 400.0f);
+            f.petalRotation = rng.range(0.0f, 360.0f);
+            
+            float colorChoice = rng.uniform();
+            if (colorChoice < 0.3f) { f.color[0] = 1.0f; f.color[1] = 0.8f; f.color[2] = 0.0f; }
+            else if (colorChoice < 0.5f) { f.color[0] = 1.0f; f.color[1] = 0.5f; f.color[2] = 0.0f; }
+            else if (colorChoice < 0.7f) { f.color[0] = 0.9f; f.color[1] = 0.3f; f.color[2] = 0.2f; }
+            else { f.color[0] = 0.8f; f.color[1] = 0.6f; f.color[2] = 0.9f; }
+            f.bounds = makeBoundingSphere(f.x, heightAt(f.x, f.z) + 5.0f, f.z, 9.0f);
+        }
+    });
+    
+    leafPiles.assign(35, LeafPile());
+    parallelFor(0, leafPiles.size(), GRAIN, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_LEAF_PILE, i);
+            LeafPile& lp = leafPiles[i];
+            lp.x = rng.range(-400.0f, 400.0f);
+            lp.z = rng.range(-400.0f, 400.0f);
+            lp.size = rng.range(20.0f, 45.0f);
+            lp.height = rng.range(4.0f, 10.0f);
+            lp.groundY = heightAt(lp.x, lp.z) + 0.1f;
+            lp.bounds = makeBoundingSphere(lp.x, lp.groundY + lp.height * 0.25f, lp.z, lp.size * 0.75f);
+            
+            for (int j = 0; j < LEAVES_PER_PILE; ++j) {
+                lp.leafOffset[j][0] = rng.range(-1.0f, 1.0f) * lp.size * 0.3f;
+                lp.leafOffset[j][2] = rng.range(-1.0f, 1.0f) * lp.size * 0.3f;
+                lp.leafOffset[j][1] = rng.uniform() * lp.height * 0.5f;
+                
+                float* color = lp.leafColor[j];
+                float colorRand = rng.uniform();
+                if (colorRand < 0.33f) { color[0] = 0.8f; color[1] = 0.3f; color[2] = 0.0f; }
+                else if (colorRand < 0.66f) { color[0] = 1.0f; color[1] = 0.6f; color[2] = 0.0f; }
+                else { color[0] = 0.6f; color[1] = 0.4f; color[2] = 0.1f; }
+            }
+        }
+    });
     
     // Enhanced cloud system
-    clouds.clear();
-    for (int i = 0; i < 35; ++i) {
-        Cloud c;
-        c.x = (rand() % 3000) - 1500.0f;
-        c.y = 250.0f + (rand() % 250);
-        c.z = (rand() % 3000) - 1500.0f;
-        c.size = 35.0f + (rand() % 100) / 100.0f * 70.0f;
-        c.speed = 0.2f + (rand() % 100) / 100.0f * 0.5f;
-        c.density = 0.7f + (rand() % 100) / 300.0f;
-        clouds.push_back(c);
-    }
-    
-    // Background hills
-    hills.clear();
-    for (int i = 0; i < 12; ++i) {
-        Hill h;
-        h.x = (rand() % 3000) - 1500.0f;
-        h.z = -800.0f - (rand() % 1000);
-        h.radius = 200.0f + (rand() % 300);
-        h.height = 80.0f + (rand() % 120);
-        h.isMountain = false;
-        hills.push_back(h);
-    }
-    
-    // NEW: Add surrounding mountains in a circle
+    clouds.assign(cloudCount, Cloud());
+    cloudRng = sceneRng(seed, RNG_CLOUD_RESPAWN, 0);
+    parallelFor(0, clouds.size(), GRAIN, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_CLOUD, i);
+            Cloud& c = clouds[i];
+            c.x = rng.range(-1500.0f, 1500.0f);
+            c.prevX = c.x;
+            c.y = rng.range(250.0f, 500.0f);
+            c.z = rng.range(-1500.0f, 1500.0f);
+            c.size = rng.range(35.0f, 105.0f);
+            c.speed = rng.range(0.2f, 0.7f);
+            c.density = rng.range(0.7f, 1.033f);
+        }
+    });
+    
+    // Background hills, then the surrounding ring of mountains
+    const int numHills = 12;
     const int numMountains = 24; // Mountains around the perimeter
     const float mountainDistance = 1800.0f;
-    for (int i = 0; i < numMountains; i++) {
-        Hill mountain;
-        float angle = (i * 2.0f * M_PI) / numMountains;
-        mountain.x = mountainDistance * cos(angle);
-        mountain.z = mountainDistance * sin(angle);
-        mountain.radius = 250.0f + (rand() % 200);
-        mountain.height = 300.0f + (rand() % 250); // Much taller
-        mountain.isMountain = true;
-        hills.push_back(mountain);
-    }
+    hills.assign(numHills + numMountains, Hill());
+    parallelFor(0, numHills, GRAIN, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_HILL, i);
+            Hill& h = hills[i];
+            h.x = rng.range(-1500.0f, 1500.0f);
+            h.z = rng.range(-1800.0f, -800.0f);
+            h.radius = rng.range(200.0f, 500.0f);
+            h.height = rng.range(80.0f, 200.0f);
+            h.isMountain = false;
+            h.color[0] = rng.range(0.4f, 0.6f);
+            h.color[1] = rng.range(0.5f, 0.7f);
+            h.color[2] = 0.2f;
+            h.bounds = makeBoundingSphere(h.x, 0.0f, h.z, max(h.radius, h.height));
+        }
+    });
+    parallelFor(0, numMountains, GRAIN, [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_MOUNTAIN, i);
+            Hill& mountain = hills[numHills + i];
+            float angle = (i * 2.0f * M_PI) / numMountains;
+            mountain.x = mountainDistance * cos(angle);
+            mountain.z = mountainDistance * sin(angle);
+            mountain.radius = rng.range(250.0f, 450.0f);
+            mountain.height = rng.range(300.0f, 550.0f); // Much taller
+            mountain.isMountain = true;
+            // Mountains are darker and more dramatic
+            mountain.color[0] = rng.range(0.35f, 0.5f);
+            mountain.color[1] = rng.range(0.4f, 0.55f);
+            mountain.color[2] = 0.25f;
+            mountain.bounds = makeBoundingSphere(mountain.x, 0.0f, mountain.z, max(mountain.radius, mountain.height));
+        }
+    });
     
     // Distant trees
-    distantTrees.clear();
-    for (int i = 0; i < 60; ++i) {
-        DistantTree dt;
-        dt.x = (rand() % 2000) - 1000.0f;
-        dt.z = -600.0f - (rand() % 800);
-        dt.height = 60.0f + (rand() % 80);
-        dt.width = 30.0f + (rand() % 40);
-        distantTrees.push_back(dt);
-    }
+    distantTrees.assign(60, DistantTree());
+    parallelFor(0, distantTrees.size(), GRAIN, [seed](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            SceneRng rng = sceneRng(seed, RNG_DISTANT_TREE, i);
+            DistantTree& dt = distantTrees[i];
+            dt.x = rng.range(-1000.0f, 1000.0f);
+            dt.z = rng.range(-1400.0f, -600.0f);
+            dt.height = rng.range(60.0f, 140.0f);
+            dt.width = rng.range(30.0f, 70.0f);
+            dt.foliageColor[0] = rng.range(0.7f, 0.9f);
+            dt.foliageColor[1] = rng.range(0.4f, 0.6f);
+            dt.foliageColor[2] = 0.1f;
+            dt.bounds = makeBoundingSphere(dt.x, dt.height * 0.5f, dt.z, max(dt.width, dt.height * 0.6f));
+        }
+    });
 }
 
-// IMPROVED: Better ground with more detail - FIXED winding order
-void drawGround() {
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, groundTexture);
-    setMaterialColor(0.25f, 0.55f, 0.15f);
-    
-    const int gridSize = 60;
-    const float cellSize = 80.0f;
-    
-    for (int i = 0; i < gridSize; i++) {
-        glBegin(GL_TRIANGLE_STRIP);
-        for (int j = 0; j <= gridSize; j++) {
-            float x1 = (i - gridSize/2) * cellSize;
-            float x2 = (i + 1 - gridSize/2) * cellSize;
-            float z = (j - gridSize/2) * cellSize;
-            
-            float h1 = 3.0f * sin(x1 * 0.008f + z * 0.008f) + 
-                      1.5f * cos(x1 * 0.02f) * sin(z * 0.015f);
-            float h2 = 3.0f * sin(x2 * 0.008f + z * 0.008f) + 
-                      1.5f * cos(x2 * 0.02f) * sin(z * 0.015f);
-            
-            // Fixed: Swapped vertex order and flipped normal
-            glNormal3f(0, 1, 0);
-            glTexCoord2f((i+1) * 0.3f, j * 0.3f);
-            glVertex3f(x2, h2, z);
-            glTexCoord2f(i * 0.3f, j * 0.3f);
-            glVertex3f(x1, h1, z);
-        }
-        glEnd();
+// True when the far-field backdrop currently shows the object, so the live
+// pass must skip it
+bool farFieldBaked(uint8_t impostorSets) {
+    return farField.ready() && ((impostorSets >> farField.frontSet()) & 1);
+}
+
+// Ground tiles inside 'frustum' that are (baked) or are not (!baked) in
+// texture set 'set' of the far field; every tile when 'set' is negative
+void drawGroundTiles(RenderQueue& queue, const Frustum& frustum, int set, bool baked) {
+    queue.setTexture(groundTexture);
+    queue.setMaterialColor(0.25f, 0.55f, 0.15f);
+    for (auto& tile : terrainTiles) {
+        if (set >= 0 && ((tile.impostorSets >> set) & 1) != baked) continue;
+        if (sphereInFrustum(frustum, tile.bounds)) queue.drawMesh(tile.mesh, tile.bounds.x, tile.bounds.y, tile.bounds.z);
     }
-    
-    glDisable(GL_TEXTURE_2D);
+    queue.setTexture(0);
+}
+
+void drawGround(RenderQueue& queue) {
+    drawGroundTiles(queue, viewFrustum, farField.ready() ? farField.frontSet() : -1, false);
+}
+
+void drawHill(RenderQueue& queue, const Hill& hill, int level) {
+    queue.pushMatrix();
+    queue.translate(hill.x, 0, hill.z);
+    queue.setMaterialColor(hill.color[0], hill.color[1], hill.color[2]);
+    queue.scale(hill.radius, hill.height, hill.radius);
+    queueLodSphere(queue, 1.0f, 20, 12, level);
+    queue.popMatrix();
 }
 
 // Draw distant hills for background
-void drawHills() {
-    for (const auto& hill : hills) {
-        glPushMatrix();
-        glTranslatef(hill.x, 0, hill.z);
-        
-        if (hill.isMountain) {
-            // Mountains are darker and more dramatic
-            setMaterialColor(0.35f + (rand() % 15) / 100.0f, 
-                            0.4f + (rand() % 15) / 100.0f, 
-                            0.25f);
-        } else {
-            // Regular hills
-            setMaterialColor(0.4f + (rand() % 20) / 100.0f, 
-                            0.5f + (rand() % 20) / 100.0f, 
-                            0.2f);
+void drawHills(RenderQueue& queue) {
+    for (auto& hill : hills) {
+        CullCategory category = hill.isMountain ? CULL_MOUNTAINS : CULL_HILLS;
+        bool inside = sphereInFrustum(viewFrustum, hill.bounds);
+        if (inside && farFieldBaked(hill.impostorSets)) {
+            cullCounters[category].recordBaked();
+            continue;
         }
-        
-        glScalef(hill.radius, hill.height, hill.radius);
-        glutSolidSphere(1.0f, 20, 12);
-        
-        glPopMatrix();
+        if (!cullCounters[category].record(inside)) continue;
+        drawHill(queue, hill, selectLod(hill.lod, hill.bounds, category));
     }
 }
 
 // Draw simplified distant trees
-void drawDistantTree(float x, float z, float height, float width) {
-    glPushMatrix();
-    glTranslatef(x, 0, z);
+void drawDistantTree(RenderQueue& queue, const DistantTree& tree, int level) {
+    float height = tree.height;
+    float width = tree.width;
+    queue.pushMatrix();
+    queue.translate(tree.x, 0, tree.z);
     
     // Trunk
-    setMaterialColor(0.3f, 0.2f, 0.1f);
-    glPushMatrix();
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    drawCylinder(width * 0.15f, width * 0.12f, height * 0.4f);
-    glPopMatrix();
+    queue.setMaterialColor(0.3f, 0.2f, 0.1f);
+    queue.pushMatrix();
+    queue.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    queueCylinder(queue, width * 0.15f, width * 0.12f, height * 0.4f, level);
+    queue.popMatrix();
     
     // Autumn foliage
-    glPushMatrix();
-    glTranslatef(0, height * 0.5f, 0);
-    setMaterialColor(0.7f + (rand() % 20) / 100.0f, 
-                    0.4f + (rand() % 20) / 100.0f, 
-                    0.1f);
-    glScalef(width, height * 0.6f, width);
-    glutSolidSphere(1.0f, 12, 12);
-    glPopMatrix();
-    
-    glPopMatrix();
+    queue.pushMatrix();
+    queue.translate(0, height * 0.5f, 0);
+    queue.setMaterialColor(tree.foliageColor[0], tree.foliageColor[1], tree.foliageColor[2]);
+    queue.scale(width, height * 0.6f, width);
+    queueLodSphere(queue, 1.0f, 12, 12, level);
+    queue.popMatrix();
+    
+    queue.popMatrix();
 }
 
-void draw3DMan(float x, float y, float z) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
-    glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
+void draw3DMan(RenderQueue& queue, float x, float y, float z) {
+    int level = manLod.update(x, y + 50.0f, z, 60.0f);
+    queue.pushMatrix();
+    queue.translate(x, y, z);
+    queue.rotate(90.0f, 0.0f, 1.0f, 0.0f);
 
     const float MAN_HEIGHT = 100.0f;
     const float TORSO_HEIGHT = MAN_HEIGHT * 0.45f;
@@ -423,259 +786,250 @@ void draw3DMan(float x, float y, float z) {
     const float BODY_RADIUS = 12.0f;
     const float LIMB_RADIUS = 5.0f;
 
-    setMaterialColor(1.0f, 0.8f, 0.7f);
-    glPushMatrix();
-    glTranslatef(0.0f, TORSO_HEIGHT + LEG_LENGTH + 10.0f, 0.0f);
-    glutSolidSphere(10.0f, 20, 20);
-    glPopMatrix();
+    queue.setMaterialColor(1.0f, 0.8f, 0.7f);
+    queue.pushMatrix();
+    queue.translate(0.0f, TORSO_HEIGHT + LEG_LENGTH + 10.0f, 0.0f);
+    queueLodSphere(queue, 10.0f, 20, 20, level);
+    queue.popMatrix();
 
-    setMaterialColor(jacketColor[0], jacketColor[1], jacketColor[2]);
-    glPushMatrix();
-    glTranslatef(0.0f, LEG_LENGTH, 0.0f);
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    drawCylinder(BODY_RADIUS, BODY_RADIUS * 0.8f, TORSO_HEIGHT);
-    glPopMatrix();
+    const float* jacket = renderSnapshot.jacketColor;
+    queue.setMaterialColor(jacket[0], jacket[1], jacket[2]);
+    queue.pushMatrix();
+    queue.translate(0.0f, LEG_LENGTH, 0.0f);
+    queue.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    queueCylinder(queue, BODY_RADIUS, BODY_RADIUS * 0.8f, TORSO_HEIGHT, level);
+    queue.popMatrix();
 
-    float armAngle = 20.0f * sin(walkPhase);
-    setMaterialColor(jacketColor[0] * 0.8f, jacketColor[1] * 0.8f, jacketColor[2] * 0.8f);
+    float armAngle = 20.0f * sin(renderSnapshot.walkPhase);
+    queue.setMaterialColor(jacket[0] * 0.8f, jacket[1] * 0.8f, jacket[2] * 0.8f);
 
     for (int i = -1; i <= 1; i += 2) {
-        glPushMatrix();
-        glTranslatef(i * BODY_RADIUS, LEG_LENGTH + TORSO_HEIGHT * 0.8f, 0.0f);
-        glRotatef(i * armAngle, 1.0f, 0.0f, 0.0f);
-        glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-        drawCylinder(LIMB_RADIUS, LIMB_RADIUS * 0.8f, ARM_LENGTH);
+        queue.pushMatrix();
+        queue.translate(i * BODY_RADIUS, LEG_LENGTH + TORSO_HEIGHT * 0.8f, 0.0f);
+        queue.rotate(i * armAngle, 1.0f, 0.0f, 0.0f);
+        queue.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+        queueCylinder(queue, LIMB_RADIUS, LIMB_RADIUS * 0.8f, ARM_LENGTH, level);
         
-        glPushMatrix();
-        glTranslatef(0.0f, 0.0f, ARM_LENGTH);
-        glutSolidSphere(LIMB_RADIUS * 0.8f, 12, 12);
-        glPopMatrix();
+        queue.pushMatrix();
+        queue.translate(0.0f, 0.0f, ARM_LENGTH);
+        queueLodSphere(queue, LIMB_RADIUS * 0.8f, 12, 12, level);
+        queue.popMatrix();
         
-        glPopMatrix();
+        queue.popMatrix();
     }
 
-    float legAngle = 30.0f * sin(walkPhase);
-    setMaterialColor(0.1f, 0.1f, 0.5f);
+    float legAngle = 30.0f * sin(renderSnapshot.walkPhase);
+    queue.setMaterialColor(0.1f, 0.1f, 0.5f);
 
     for (int i = -1; i <= 1; i += 2) {
-        glPushMatrix();
-        glTranslatef(i * LIMB_RADIUS, LEG_LENGTH, 0.0f);
-        glRotatef(i * legAngle, 1.0f, 0.0f, 0.0f);
-        glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-        drawCylinder(LIMB_RADIUS + 2.0f, LIMB_RADIUS, LEG_LENGTH);
-        glPopMatrix();
+        queue.pushMatrix();
+        queue.translate(i * LIMB_RADIUS, LEG_LENGTH, 0.0f);
+        queue.rotate(i * legAngle, 1.0f, 0.0f, 0.0f);
+        queue.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+        queueCylinder(queue, LIMB_RADIUS + 2.0f, LIMB_RADIUS, LEG_LENGTH, level);
+        queue.popMatrix();
     }
 
-    glPopMatrix();
+    queue.popMatrix();
 }
 
 // NEW: Enhanced sky with gradient
-void drawEnhancedSky() {
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
-    
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    
-    glBegin(GL_QUADS);
-    
-    float timeInfluence = sin(timeOfDay * 0.5f);
-    float topR = 0.6f + 0.15f * timeInfluence;
-    float topG = 0.7f + 0.1f * timeInfluence;
-    float topB = 0.85f + 0.1f * timeInfluence;
-    
-    float botR = 0.95f + 0.05f * timeInfluence;
-    float botG = 0.85f + 0.05f * timeInfluence;
-    float botB = 0.7f;
-    
-    glColor3f(topR, topG, topB);
-    glVertex3f(-1.0f, 1.0f, -0.99f);
-    glVertex3f(1.0f, 1.0f, -0.99f);
-    
-    glColor3f(botR, botG, botB);
-    glVertex3f(1.0f, -0.3f, -0.99f);
-    glVertex3f(-1.0f, -0.3f, -0.99f);
-    glEnd();
-    
-    glPopMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
+// Sky gradient for the current time of day: zenith above, horizon below
+SkyColors skyColors() {
+    float timeInfluence = sin(renderSnapshot.timeOfDay * 0.5f);
+    SkyColors colors = {
+        { 0.95f + 0.05f * timeInfluence, 0.85f + 0.05f * timeInfluence, 0.7f },
+        { 0.6f + 0.15f * timeInfluence, 0.7f + 0.1f * timeInfluence, 0.85f + 0.1f * timeInfluence }
+    };
+    return colors;
 }
 
 // IMPROVED: Better cloud rendering
-void drawCloud(float x, float y, float z, float size, float density) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
-    
-    float cloudR = 0.95f - (1.0f - density) * 0.15f;
-    float cloudG = 0.93f - (1.0f - density) * 0.15f;
-    float cloudB = 0.90f - (1.0f - density) * 0.10f;
-    setMaterialColor(cloudR, cloudG, cloudB);
-    
-    glutSolidSphere(size * density, 20, 20);
-    
-    glTranslatef(size * 0.6f, size * 0.15f, size * 0.1f);
-    glutSolidSphere(size * 0.85f * density, 18, 18);
-    
-    glTranslatef(-size * 1.3f, size * 0.1f, -size * 0.2f);
-    glutSolidSphere(size * 0.75f * density, 16, 16);
-    
-    glTranslatef(size * 0.7f, -size * 0.35f, size * 0.35f);
-    glutSolidSphere(size * 0.65f * density, 14, 14);
-    
-    glTranslatef(0, size * 0.25f, -size * 0.7f);
-    glutSolidSphere(size * 0.55f * density, 12, 12);
-    
-    glTranslatef(-size * 0.3f, -size * 0.2f, size * 0.4f);
-    glutSolidSphere(size * 0.4f * density, 10, 10);
+// All visible clouds in one draw call (cloud_batch.h); the puff layout is
+// baked once, so only each cloud's position, size and density go in per frame
+void drawClouds() {
+    cloudBatch.spriteLevel = cloudSprites ? CLOUD_SPRITE_LEVEL : LOD_LEVELS;
+    cloudBatch.begin();
+    for (auto& cloud : clouds) {
+        float x = simLerp(cloud.prevX, cloud.x, renderAlpha);
+        BoundingSphere bounds = makeBoundingSphere(x, cloud.y, cloud.z, cloud.size * 1.6f);
+        if (!cullCounters[CULL_CLOUDS].test(viewFrustum, bounds)) continue;
+        cloudBatch.add(x, cloud.y, cloud.z, cloud.size, cloud.density, selectLod(cloud.lod, bounds, CULL_CLOUDS));
+    }
     
-    glPopMatrix();
+    // Specular and shininess; vertex colors supply ambient and diffuse
+    setMaterialColor(0.95f, 0.93f, 0.90f);
+    cloudBatch.draw();
+    glState().invalidateColor();
+    totalMeshClouds += cloudBatch.meshClouds;
+    totalSpriteClouds += cloudBatch.spriteClouds;
 }
 
-// IMPROVED: Enhanced sun with glow
-void drawSun(float x, float y, float z) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
-    
-    // Main sun body
-    setMaterialColor(1.0f, 0.85f, 0.5f);
-    glutSolidSphere(60.0f, 32, 32);
-    
-    // Multiple glow layers
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_FALSE);
-    
-    setMaterialColor(1.0f, 0.9f, 0.7f);
-    glutSolidSphere(75.0f, 24, 24);
-    
-    setMaterialColor(1.0f, 0.85f, 0.6f);
-    glutSolidSphere(95.0f, 20, 20);
-    
-    setMaterialColor(1.0f, 0.8f, 0.5f);
-    glutSolidSphere(120.0f, 16, 16);
-    
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
-    
-    glPopMatrix();
+// Sun position - MUCH HIGHER in the sky
+void sunPosition(float sun[3]) {
+    sun[0] = 1200.0f * cos(renderSnapshot.sunAngle);
+    sun[1] = 600.0f + 400.0f * sin(renderSnapshot.sunAngle); // Raised from 300 + 250
+    sun[2] = 1200.0f * sin(renderSnapshot.sunAngle);
 }
 
-void drawDynamicSky() {
-    // Draw enhanced sky gradient
-    drawEnhancedSky();
-    
-    // Draw sun - MUCH HIGHER in the sky
-    float sunX = 1200.0f * cos(sunAngle);
-    float sunY = 600.0f + 400.0f * sin(sunAngle); // Raised from 300 + 250
-    float sunZ = 1200.0f * sin(sunAngle);
-    drawSun(sunX, sunY, sunZ);
-    
-    // Draw clouds
-    for (const auto& cloud : clouds) {
-        drawCloud(cloud.x, cloud.y, cloud.z, cloud.size, cloud.density);
-    }
+// IMPROVED: Enhanced sun with glow
+// Gradient, sun disc and glow in one pass (sky_dome.h), drawn after the
+// opaque scene in place of a color clear. The dome sits just inside the far
+// plane, beyond the terrain's corners (about 3400 units out), so it never
+// hides live ground when the far field is not baked.
+void drawDynamicSky(float eyeX, float eyeY, float eyeZ) {
+    const float eye[3] = { eyeX, eyeY, eyeZ };
+    float sun[3];
+    sunPosition(sun);
+    float toSun[3] = { sun[0] - eyeX, sun[1] - eyeY, sun[2] - eyeZ };
+    float distance = sqrt(toSun[0] * toSun[0] + toSun[1] * toSun[1] + toSun[2] * toSun[2]);
+    skyDome.draw(eye, toSun, atan2(SUN_RADIUS, distance), skyColors(), 0.95f * FAR_CLIP);
+    glState().invalidateColor();
 }
 
 // IMPROVED: Higher polygon count trees
-void draw3DTree(float x, float z) {
-    glPushMatrix();
-    glTranslatef(x, 0.0f, z);
+// Trunk and canopy prototypes for the foreground forest at one LOD level,
+// in tree-local space
+void buildTreeMeshes(int level) {
+    MeshBuilder trunk(treeTrunkMeshes[level], true);
+    trunk.setColor(0.35f, 0.25f, 0.15f);
+    trunk.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    trunk.scale(15.0f, 15.0f, 120.0f);
+    trunk.addMesh(getPrimitiveMesh(MESH_CYLINDER, lodSegments(32, level, 6), lodSegments(16, level, 1), 10.0f / 15.0f));
+
+    MeshBuilder canopy(treeCanopyMeshes[level]);
+    canopy.translate(0.0f, 120.0f, 0.0f);
+    canopy.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    
+    canopy.setColor(0.75f, 0.35f, 0.05f);
+    canopy.pushMatrix();
+    canopy.scale(60.0f, 60.0f, 70.0f);
+    canopy.addMesh(getPrimitiveMesh(MESH_CONE, lodSegments(24, level, 6), lodSegments(24, level, 1), 0.0f));
+    canopy.popMatrix();
+    
+    canopy.translate(0.0f, 0.0f, 35.0f);
+    canopy.setColor(0.85f, 0.55f, 0.1f);
+    canopy.scale(50.0f, 50.0f, 70.0f);
+    canopy.addMesh(getPrimitiveMesh(MESH_CONE, lodSegments(24, level, 6), lodSegments(24, level, 1), 0.0f));
+}
 
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, barkTexture);
-    setMaterialColor(0.35f, 0.25f, 0.15f);
-    
-    GLUquadricObj *quadric = gluNewQuadric();
-    gluQuadricTexture(quadric, GL_TRUE);
-    gluQuadricNormals(quadric, GLU_SMOOTH);
-    
-    glPushMatrix();
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    gluCylinder(quadric, 15.0f, 10.0f, 120.0f, 32, 16);
-    glPopMatrix();
-    
-    gluDeleteQuadric(quadric);
-    glDisable(GL_TEXTURE_2D);
+// Foreground trees on a grid around the valley center, leaving the middle free
+void buildForest() {
+    TraceScope scope("buildForest", "load");
+    const Mesh* trunkLevels[LOD_LEVELS];
+    const Mesh* canopyLevels[LOD_LEVELS];
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        trunkLevels[level] = &treeTrunkMeshes[level];
+        canopyLevels[level] = &treeCanopyMeshes[level];
+    }
+    treeTrunkBatch.setLodPrototypes(trunkLevels, LOD_LEVELS, true);
+    treeCanopyBatch.setLodPrototypes(canopyLevels, LOD_LEVELS);
+    treeTrunkBatch.clear();
+    treeCanopyBatch.clear();
+    forestTreeBounds.clear();
+    BoundingSphere treeBounds = mergeBoundingSpheres(meshBoundingSphere(treeTrunkMeshes[0]), meshBoundingSphere(treeCanopyMeshes[0]));
+    
+    for (int i = -FOREST_GRID_RADIUS; i <= FOREST_GRID_RADIUS; i++) {
+        for (int j = -FOREST_GRID_RADIUS; j <= FOREST_GRID_RADIUS; j++) {
+            if (i == 0 && j == 0) continue;
+            float x = i * FOREST_TREE_SPACING;
+            float z = j * FOREST_TREE_SPACING;
+            Instance tree = makeInstance(x, heightAt(x, z), z, 0.0f, 1.0f);
+            treeTrunkBatch.add(tree);
+            treeCanopyBatch.add(tree);
+            forestTreeBounds.push_back(makeBoundingSphere(x + treeBounds.x, tree.y + treeBounds.y, z + treeBounds.z, treeBounds.radius));
+        }
+    }
+}
 
-    glPushMatrix();
-    glTranslatef(0.0f, 120.0f, 0.0f);
-    
-    setMaterialColor(0.75f, 0.35f, 0.05f);
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    glutSolidCone(60.0f, 70.0f, 24, 24);
-    
-    glTranslatef(0.0f, 0.0f, 35.0f);
-    setMaterialColor(0.85f, 0.55f, 0.1f);
-    glutSolidCone(50.0f, 70.0f, 24, 24);
+// Queues the visible tiles of a batch whose meshes carry vertex colors
+void queueTiles(RenderQueue& queue, TiledInstanceBatch& batch, CullCategory category) {
+    queue.setVertexColors();
+    batch.visit(viewFrustum, cullCounters[category], &lodCounters[category],
+                [&queue](Mesh& mesh, const BoundingSphere& bounds) { queue.drawMesh(mesh, bounds.x, bounds.y, bounds.z); });
+}
 
-    glPopMatrix();
-    glPopMatrix();
+void drawForest(RenderQueue& queue) {
+    queue.setTexture(barkTexture);
+    queueTiles(queue, treeTrunkBatch, CULL_TREE_TRUNKS);
+    queue.setTexture(0);
+    queueTiles(queue, treeCanopyBatch, CULL_TREE_CANOPIES);
 }
 
-void draw3DLeaf(float x, float y, float z, const float color[3], float size, float rotation) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
-    
-    glRotatef(rotation, 0, 1, 0);
-    glRotatef(sin(rotation * 0.1f) * 30, 1, 0, 0);
-    
-    setMaterialColor(color[0], color[1], color[2]);
-    
-    glBegin(GL_TRIANGLES);
-    
-    glNormal3f(0, 0.7f, 0.3f);
-    glVertex3f(0, 0, 0);
-    glVertex3f(-size, size * 0.5f, 0);
-    glVertex3f(0, size * 1.2f, 0);
-    
-    glVertex3f(0, 0, 0);
-    glVertex3f(0, size * 1.2f, 0);
-    glVertex3f(size, size * 0.5f, 0);
-    
-    glEnd();
-    
-    setMaterialColor(color[0] * 0.7f, color[1] * 0.7f, color[2] * 0.7f);
-    glBegin(GL_LINES);
-    glVertex3f(0, 0, 0);
-    glVertex3f(0, -size * 0.3f, 0);
-    glEnd();
-    
-    glPopMatrix();
+// Writes one leaf (two triangles plus a stem line) into the leaf streams.
+// Same shape as the old per-leaf glRotatef path: spin about Y, then tilt about X.
+void emitLeaf(float x, float y, float z, const float color[3], float size, float rotation) {
+    float spin = rotation * M_PI / 180.0f;
+    float tilt = sin(rotation * 0.1f) * 30.0f * M_PI / 180.0f;
+    float cs = cos(spin), ss = sin(spin);
+    float ct = cos(tilt), st = sin(tilt);
+    
+    // Leaf-local x and y axes in world space
+    float ax[3] = { cs, 0.0f, -ss };
+    float ay[3] = { st * ss, ct, st * cs };
+    
+    // Local normal (0, 0.7, 0.3) rotated the same way
+    float nx = 0.7f * ay[0] + 0.3f * ct * ss;
+    float ny = 0.7f * ay[1] - 0.3f * st;
+    float nz = 0.7f * ay[2] + 0.3f * ct * cs;
+    
+    auto point = [&](float lx, float ly, float out[3]) {
+        out[0] = x + lx * ax[0] + ly * ay[0];
+        out[1] = y + lx * ax[1] + ly * ay[1];
+        out[2] = z + lx * ax[2] + ly * ay[2];
+    };
+    
+    float base[3], left[3], tip[3], right[3], stemEnd[3];
+    point(0, 0, base);
+    point(-size, size * 0.5f, left);
+    point(0, size * 1.2f, tip);
+    point(size, size * 0.5f, right);
+    point(0, -size * 0.3f, stemEnd);
+    
+    float r = color[0], g = color[1], b = color[2];
+    leafTriangles.vertex(base[0], base[1], base[2], nx, ny, nz, r, g, b);
+    leafTriangles.vertex(left[0], left[1], left[2], nx, ny, nz, r, g, b);
+    leafTriangles.vertex(tip[0], tip[1], tip[2], nx, ny, nz, r, g, b);
+    
+    leafTriangles.vertex(base[0], base[1], base[2], nx, ny, nz, r, g, b);
+    leafTriangles.vertex(tip[0], tip[1], tip[2], nx, ny, nz, r, g, b);
+    leafTriangles.vertex(right[0], right[1], right[2], nx, ny, nz, r, g, b);
+    
+    leafStems.vertex(base[0], base[1], base[2], nx, ny, nz, r * 0.7f, g * 0.7f, b * 0.7f);
+    leafStems.vertex(stemEnd[0], stemEnd[1], stemEnd[2], nx, ny, nz, r * 0.7f, g * 0.7f, b * 0.7f);
 }
 
+// All falling leaves in two draw calls: one triangle list and one line list.
+// Drift, sway and wind are already applied by the leaf kernel in stepScene().
 void draw3DLeaves() {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
-    for (const auto& leaf : fallingLeaves) {
-        float windEffectX = windStrength * 30.0f * cos(windDirection);
-        float windEffectZ = windStrength * 30.0f * sin(windDirection);
-        
-        float currentX = leaf.x + 20.0f * sin(leafDriftSpeed + leaf.z * 0.1f) + windEffectX;
-        float currentY = leaf.y + 5.0f * cos(leafDriftSpeed * 2.0f + leaf.x * 0.1f);
-        float currentZ = leaf.z + windEffectZ;
-        
-        draw3DLeaf(currentX, currentY, currentZ, leaf.color, leaf.size, leaf.rotation);
+    leafTriangles.clear();
+    leafStems.clear();
+    const LeafStore& leaves = fallingLeaves;
+    for (size_t i = 0; i < leaves.count(); ++i) {
+        float x, y, z, rotation;
+        leafSimInterpolate(leaves, i, renderAlpha, x, y, z, rotation);
+        if (!cullCounters[CULL_LEAVES].test(viewFrustum, makeBoundingSphere(x, y, z, leaves.size[i] * 1.3f))) continue;
+        float color[3] = { leaves.r[i], leaves.g[i], leaves.b[i] };
+        emitLeaf(x, y, z, color, leaves.size[i], rotation);
     }
     
-    glDisable(GL_BLEND);
+    GlStateCache& state = glState();
+    state.enable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    leafTriangles.draw(GL_TRIANGLES);
+    leafStems.draw(GL_LINES);
+    state.disable(GL_BLEND);
+    state.invalidateColor();
 }
 
-void drawDetailedPumpkin(float x, float z, float size, float rotation) {
-    glPushMatrix();
-    glTranslatef(x, size * 1.1f, z);  // Raised even higher - now 1.1f * size to be clearly above ground
-    glRotatef(rotation, 0.0f, 1.0f, 0.0f);
+// Tessellates one unit-size pumpkin (body, caps, stem, grooves and leaves)
+// into a colored mesh. Every pumpkin in the scene is an instance of it.
+// One LOD level of the unit pumpkin; coarser levels drop the small stem details
+void buildPumpkinMesh(Mesh& mesh, int level) {
+    MeshBuilder b(mesh);
+    const float size = 1.0f;
     
-    const int segments = 40; // Even more segments for ultra-smooth surface
+    const int segments = lodSegments(40, level, 6); // Even more segments for ultra-smooth surface
     const int ridges = 14;   // More ridges for better detail
     
     // Draw each ridge as a vertical section
@@ -686,12 +1040,13 @@ void drawDetailedPumpkin(float x, float z, float size, float rotation) {
         // Alternate colors with more variation for depth
         float colorVar = 0.05f * sin(r * 0.5f);
         if (r % 2 == 0) {
-            setMaterialColor(1.0f, 0.5f + colorVar, 0.05f);
+            b.setColor(1.0f, 0.5f + colorVar, 0.05f);
         } else {
-            setMaterialColor(0.95f, 0.45f + colorVar, 0.02f);
+            b.setColor(0.95f, 0.45f + colorVar, 0.02f);
         }
         
-        glBegin(GL_QUAD_STRIP);
+        // Quad strip: each new pair of vertices closes a quad with the previous pair
+        unsigned int prev1 = 0, prev2 = 0;
         for (int s = 0; s <= segments; s++) {
             float v = (float)s / segments;
             
@@ -730,186 +1085,654 @@ void drawDetailedPumpkin(float x, float z, float size, float rotation) {
             float nz2 = sin(angle2) * heightFactor;
             float ny = -yNormalized * 0.4f;
             
-            glNormal3f(nx1, ny, nz1);
-            glVertex3f(x1, yPos, z1);
-            glNormal3f(nx2, ny, nz2);
-            glVertex3f(x2, yPos, z2);
+            unsigned int v1 = b.vertex(x1, yPos, z1, nx1, ny, nz1);
+            unsigned int v2 = b.vertex(x2, yPos, z2, nx2, ny, nz2);
+            if (s > 0) {
+                b.triangle(prev1, prev2, v2);
+                b.triangle(prev1, v2, v1);
+            }
+            prev1 = v1;
+            prev2 = v2;
         }
-        glEnd();
     }
     
     // Bottom cap (more detailed and flattened)
-    setMaterialColor(0.85f, 0.38f, 0.0f);
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0, -1, 0);
-    glVertex3f(0, -size * 0.85f, 0);
+    b.setColor(0.85f, 0.38f, 0.0f);
+    unsigned int bottomCenter = b.vertex(0, -size * 0.85f, 0, 0, -1, 0);
     for (int i = 0; i <= ridges * 2; i++) {
         float angle = (i * 2.0f * M_PI) / (ridges * 2);
         float bottomRadius = size * 0.35f;
         // Add slight wave to bottom edge
         float edgeWave = 0.03f * size * sin(i * M_PI / ridges);
-        glVertex3f((bottomRadius + edgeWave) * cos(angle), -size * 0.85f, (bottomRadius + edgeWave) * sin(angle));
+        unsigned int rim = b.vertex((bottomRadius + edgeWave) * cos(angle), -size * 0.85f, (bottomRadius + edgeWave) * sin(angle), 0, -1, 0);
+        if (i > 0) b.triangle(bottomCenter, rim - 1, rim);
     }
-    glEnd();
     
     // Top cap (where stem connects) - with more detail
-    setMaterialColor(0.88f, 0.42f, 0.01f);
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0, 1, 0);
-    glVertex3f(0, size * 0.85f, 0);
+    b.setColor(0.88f, 0.42f, 0.01f);
+    unsigned int topCenter = b.vertex(0, size * 0.85f, 0, 0, 1, 0);
     for (int i = 0; i <= ridges * 2; i++) {
         float angle = (i * 2.0f * M_PI) / (ridges * 2);
         float topRadius = size * 0.28f;
         // Add indentation pattern around stem
         float indent = 0.02f * size * sin(i * M_PI / ridges * 2.0f);
-        glVertex3f((topRadius - indent) * cos(angle), size * 0.85f, (topRadius - indent) * sin(angle));
+        unsigned int rim = b.vertex((topRadius - indent) * cos(angle), size * 0.85f, (topRadius - indent) * sin(angle), 0, 1, 0);
+        if (i > 0) b.triangle(topCenter, rim - 1, rim);
     }
-    glEnd();
     
     // Enhanced stem with much more detail
-    glPushMatrix();
-    glTranslatef(0, size * 0.85f, 0);
+    b.pushMatrix();
+    b.translate(0, size * 0.85f, 0);
     
     // Stem base ring (decorative detail where stem meets pumpkin)
-    setMaterialColor(0.32f, 0.42f, 0.09f);
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    glutSolidTorus(size * 0.04f, size * 0.18f, 8, 16);
+    b.setColor(0.32f, 0.42f, 0.09f);
+    b.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    b.pushMatrix();
+    b.scale(size * 0.18f, size * 0.18f, size * 0.18f);
+    b.addMesh(getPrimitiveMesh(MESH_TORUS, lodSegments(8, level, 4), lodSegments(16, level, 6), 0.04f / 0.18f));
+    b.popMatrix();
     
     // Stem base (slightly wider and textured)
-    setMaterialColor(0.35f, 0.45f, 0.1f);
-    drawCylinder(size * 0.16f, size * 0.13f, size * 0.18f);
+    b.setColor(0.35f, 0.45f, 0.1f);
+    b.pushMatrix();
+    b.scale(size * 0.16f, size * 0.16f, size * 0.18f);
+    b.addMesh(getPrimitiveMesh(MESH_CYLINDER, lodSegments(24, level, 6), 1, 0.13f / 0.16f));
+    b.popMatrix();
     
     // Main stem section 1 (curved)
-    glTranslatef(0, 0, size * 0.18f);
-    glRotatef(10.0f, 0.0f, 1.0f, 0.0f);
-    glRotatef(3.0f, 1.0f, 0.0f, 0.0f);
-    setMaterialColor(0.3f, 0.5f, 0.12f);
-    drawCylinder(size * 0.13f, size * 0.10f, size * 0.25f);
+    b.translate(0, 0, size * 0.18f);
+    b.rotate(10.0f, 0.0f, 1.0f, 0.0f);
+    b.rotate(3.0f, 1.0f, 0.0f, 0.0f);
+    b.setColor(0.3f, 0.5f, 0.12f);
+    b.pushMatrix();
+    b.scale(size * 0.13f, size * 0.13f, size * 0.25f);
+    b.addMesh(getPrimitiveMesh(MESH_CYLINDER, lodSegments(24, level, 6), 1, 0.10f / 0.13f));
+    b.popMatrix();
     
     // Add texture bumps on main stem
-    for (int i = 0; i < 4; i++) {
-        glPushMatrix();
-        glTranslatef(0, 0, size * 0.06f * i);
-        setMaterialColor(0.28f, 0.46f, 0.10f);
-        glutSolidTorus(size * 0.015f, size * 0.11f, 6, 12);
-        glPopMatrix();
+    for (int i = 0; i < 4 && level < 2; i++) {
+        b.pushMatrix();
+        b.translate(0, 0, size * 0.06f * i);
+        b.setColor(0.28f, 0.46f, 0.10f);
+        b.scale(size * 0.11f, size * 0.11f, size * 0.11f);
+        b.addMesh(getPrimitiveMesh(MESH_TORUS, 6, 12, 0.015f / 0.11f));
+        b.popMatrix();
     }
     
     // Main stem section 2 (continues curve)
-    glTranslatef(0, 0, size * 0.25f);
-    glRotatef(12.0f, 0.0f, 1.0f, 0.0f);
-    glRotatef(5.0f, 1.0f, 0.0f, 0.0f);
-    setMaterialColor(0.29f, 0.49f, 0.11f);
-    drawCylinder(size * 0.10f, size * 0.07f, size * 0.22f);
+    b.translate(0, 0, size * 0.25f);
+    b.rotate(12.0f, 0.0f, 1.0f, 0.0f);
+    b.rotate(5.0f, 1.0f, 0.0f, 0.0f);
+    b.setColor(0.29f, 0.49f, 0.11f);
+    b.pushMatrix();
+    b.scale(size * 0.10f, size * 0.10f, size * 0.22f);
+    b.addMesh(getPrimitiveMesh(MESH_CYLINDER, lodSegments(24, level, 6), 1, 0.07f / 0.10f));
+    b.popMatrix();
     
     // Stem top section (tapers to point)
-    glTranslatef(0, 0, size * 0.22f);
-    glRotatef(8.0f, 1.0f, 0.0f, 0.0f);
-    setMaterialColor(0.28f, 0.48f, 0.1f);
-    drawCylinder(size * 0.07f, size * 0.03f, size * 0.15f);
+    b.translate(0, 0, size * 0.22f);
+    b.rotate(8.0f, 1.0f, 0.0f, 0.0f);
+    b.setColor(0.28f, 0.48f, 0.1f);
+    b.pushMatrix();
+    b.scale(size * 0.07f, size * 0.07f, size * 0.15f);
+    b.addMesh(getPrimitiveMesh(MESH_CYLINDER, lodSegments(24, level, 6), 1, 0.03f / 0.07f));
+    b.popMatrix();
     
-    glPopMatrix();
+    b.popMatrix();
     
     // Add decorative grooves/ridges on the stem
-    glPushMatrix();
-    glTranslatef(0, size * 0.85f, 0);
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    setMaterialColor(0.25f, 0.4f, 0.08f);
-    for (int i = 0; i < 5; i++) {
-        glPushMatrix();
-        glTranslatef(0, 0, size * 0.22f + i * size * 0.11f);
-        glutSolidTorus(size * 0.018f, size * 0.09f - i * size * 0.01f, 6, 12);
-        glPopMatrix();
+    b.pushMatrix();
+    b.translate(0, size * 0.85f, 0);
+    b.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    b.setColor(0.25f, 0.4f, 0.08f);
+    for (int i = 0; i < 5 && level < 2; i++) {
+        float ringRadius = size * 0.09f - i * size * 0.01f;
+        b.pushMatrix();
+        b.translate(0, 0, size * 0.22f + i * size * 0.11f);
+        b.scale(ringRadius, ringRadius, ringRadius);
+        b.addMesh(getPrimitiveMesh(MESH_TORUS, 6, 12, size * 0.018f / ringRadius));
+        b.popMatrix();
     }
-    glPopMatrix();
+    b.popMatrix();
     
     // Add small leaf details on stem
     for (int i = 0; i < 2; i++) {
-        glPushMatrix();
-        glTranslatef(0, size * (0.85f + 0.3f + i * 0.25f), 0);
-        glRotatef(i * 120.0f, 0.0f, 1.0f, 0.0f);
-        glTranslatef(size * 0.12f, 0, 0);
-        glRotatef(-45.0f, 0.0f, 0.0f, 1.0f);
+        b.pushMatrix();
+        b.translate(0, size * (0.85f + 0.3f + i * 0.25f), 0);
+        b.rotate(i * 120.0f, 0.0f, 1.0f, 0.0f);
+        b.translate(size * 0.12f, 0, 0);
+        b.rotate(-45.0f, 0.0f, 0.0f, 1.0f);
         
         // Small leaf shape
-        setMaterialColor(0.25f, 0.55f, 0.15f);
-        glBegin(GL_TRIANGLES);
-        glNormal3f(0, 0, 1);
-        glVertex3f(0, 0, 0);
-        glVertex3f(-size * 0.08f, size * 0.06f, 0);
-        glVertex3f(0, size * 0.12f, 0);
+        b.setColor(0.25f, 0.55f, 0.15f);
+        unsigned int base = b.vertex(0, 0, 0, 0, 0, 1);
+        unsigned int left = b.vertex(-size * 0.08f, size * 0.06f, 0, 0, 0, 1);
+        unsigned int tip = b.vertex(0, size * 0.12f, 0, 0, 0, 1);
+        unsigned int right = b.vertex(size * 0.08f, size * 0.06f, 0, 0, 0, 1);
+        b.triangle(base, left, tip);
+        b.triangle(base, tip, right);
         
-        glVertex3f(0, 0, 0);
-        glVertex3f(0, size * 0.12f, 0);
-        glVertex3f(size * 0.08f, size * 0.06f, 0);
-        glEnd();
-        
-        glPopMatrix();
+        b.popMatrix();
     }
-    
-    glPopMatrix();
 }
 
-void drawChrysanthemum(float x, float z, float r, float g, float b, float rotation) {
-    glPushMatrix();
-    glTranslatef(x, 0.0f, z);
+void drawPumpkins(RenderQueue& queue) {
+    queueTiles(queue, pumpkinBatch, CULL_PUMPKINS);
+}
+
+void drawChrysanthemum(RenderQueue& queue, float x, float z, float r, float g, float b, float rotation, int level) {
+    queue.pushMatrix();
+    queue.translate(x, heightAt(x, z), z);
     
-    setMaterialColor(0.2f, 0.6f, 0.2f);
-    glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    drawCylinder(0.5f, 0.3f, 8.0f);
-    glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
+    queue.setMaterialColor(0.2f, 0.6f, 0.2f);
+    queue.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+    queueCylinder(queue, 0.5f, 0.3f, 8.0f, level);
+    queue.rotate(90.0f, 1.0f, 0.0f, 0.0f);
     
-    glTranslatef(0.0f, 8.5f, 0.0f);
-    setMaterialColor(1.0f, 0.9f, 0.0f);
-    glutSolidSphere(2.5f, 12, 12);
+    queue.translate(0.0f, 8.5f, 0.0f);
+    queue.setMaterialColor(1.0f, 0.9f, 0.0f);
+    queueLodSphere(queue, 2.5f, 12, 12, level);
     
-    setMaterialColor(r, g, b);
+    queue.setMaterialColor(r, g, b);
     for (int i = 0; i < 8; ++i) {
         float angle = (i * 45.0f + rotation) * M_PI / 180.0f;
-        glPushMatrix();
-        glTranslatef(4.0f * cos(angle), 0.0f, 4.0f * sin(angle));
-        glScalef(2.0f, 0.4f, 1.2f);
-        glutSolidSphere(1.5f, 10, 10);
-        glPopMatrix();
+        queue.pushMatrix();
+        queue.translate(4.0f * cos(angle), 0.0f, 4.0f * sin(angle));
+        queue.scale(2.0f, 0.4f, 1.2f);
+        queueLodSphere(queue, 1.5f, 10, 10, level);
+        queue.popMatrix();
     }
     
-    glPopMatrix();
+    queue.popMatrix();
 }
 
-void drawLeafPile(float x, float z, float size, float height) {
-    glPushMatrix();
-    glTranslatef(x, 0.1f, z);
+void drawLeafPile(RenderQueue& queue, const LeafPile& pile, int level) {
+    queue.pushMatrix();
+    queue.translate(pile.x, pile.groundY, pile.z);
     
-    int numLeafsInPile = 8;
-    for (int i = 0; i < numLeafsInPile; ++i) {
-        float offsetX = (rand() % 100 - 50) / 50.0f * size * 0.3f;
-        float offsetZ = (rand() % 100 - 50) / 50.0f * size * 0.3f;
-        float offsetY = (rand() % 100) / 100.0f * height * 0.5f;
-        
-        float colorRand = static_cast <float> (rand()) / RAND_MAX;
-        if (colorRand < 0.33f) setMaterialColor(0.8f, 0.3f, 0.0f);
-        else if (colorRand < 0.66f) setMaterialColor(1.0f, 0.6f, 0.0f);
-        else setMaterialColor(0.6f, 0.4f, 0.1f);
+    for (int i = 0; i < LEAVES_PER_PILE; ++i) {
+        const float* offset = pile.leafOffset[i];
+        const float* color = pile.leafColor[i];
+        queue.setMaterialColor(color[0], color[1], color[2]);
         
-        glPushMatrix();
-        glTranslatef(offsetX, offsetY, offsetZ);
-        glScalef(size * 0.3f, height * 0.3f, size * 0.3f);
-        glutSolidSphere(1.0f, 12, 12);
-        glPopMatrix();
+        queue.pushMatrix();
+        queue.translate(offset[0], offset[1], offset[2]);
+        queue.scale(pile.size * 0.3f, pile.height * 0.3f, pile.size * 0.3f);
+        queueLodSphere(queue, 1.0f, 12, 12, level);
+        queue.popMatrix();
     }
     
-    glPopMatrix();
+    queue.popMatrix();
 }
 
 void reshape(int w, int h) {
     glViewport(0, 0, w, h);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluPerspective(60.0, (GLfloat)w / (GLfloat)h, 1.0, 6000.0);
+    gluPerspective(FIELD_OF_VIEW, (GLfloat)w / (GLfloat)h, 1.0, FAR_CLIP);
+    viewportHeight = h;
     glMatrixMode(GL_MODELVIEW);
 }
 
+// Tessellates every LOD level of the primitives the scene draws directly
+void prepareLodMeshes() {
+    TraceScope scope("prepareLodMeshes", "init");
+    const int spheres[][2] = { { 20, 12 }, { 12, 12 }, { 20, 20 }, { 10, 10 } };
+    for (const auto& sphere : spheres) lodPrepareSphere(sphere[0], sphere[1]);
+    cloudBatch.build();
+}
+
+// Indexes every static prop; runs after initializeLeaves() and buildForest()
+void buildSpatialGrids() {
+    TraceScope scope("buildSpatialGrids", "load");
+    vector<BoundingSphere> bounds;
+
+    // Pumpkin instances spin about Y, so the prototype sphere's offset can
+    // point anywhere around the instance origin
+    BoundingSphere pumpkinBounds = meshBoundingSphere(pumpkinMeshes[0]);
+    float pumpkinReach = sqrtf(pumpkinBounds.x * pumpkinBounds.x + pumpkinBounds.y * pumpkinBounds.y +
+                               pumpkinBounds.z * pumpkinBounds.z) + pumpkinBounds.radius;
+    bounds.clear();
+    for (const auto& p : pumpkins) {
+        bounds.push_back(makeBoundingSphere(p.x, heightAt(p.x, p.z) + p.size * 1.1f, p.z, pumpkinReach * p.size));
+    }
+    pumpkinGrid.build(bounds);
+
+    bounds.clear();
+    for (const auto& f : flowers) bounds.push_back(f.bounds);
+    flowerGrid.build(bounds);
+
+    bounds.clear();
+    for (const auto& lp : leafPiles) bounds.push_back(lp.bounds);
+    leafPileGrid.build(bounds);
+
+    forestGrid.build(forestTreeBounds);
+
+    bounds.clear();
+    for (const auto& dt : distantTrees) bounds.push_back(dt.bounds);
+    distantTreeGrid.build(bounds);
+}
+
+// Static props whose bounds reach within 'radius' of (x, z) on the ground
+int countPropsNear(float x, float z, float radius) {
+    int found = 0;
+    auto count = [&found](uint32_t) { ++found; };
+    pumpkinGrid.queryRadius(x, z, radius, count);
+    flowerGrid.queryRadius(x, z, radius, count);
+    leafPileGrid.queryRadius(x, z, radius, count);
+    forestGrid.queryRadius(x, z, radius, count);
+    distantTreeGrid.queryRadius(x, z, radius, count);
+    return found;
+}
+
+// Draws the props a grid finds inside the view frustum; the rest count as culled
+template <class Draw>
+void drawVisibleProps(const SpatialGrid& grid, CullCategory category, Draw draw) {
+    int visible = (int)grid.queryFrustum(viewFrustum, draw);
+    cullCounters[category].record(true, visible);
+    cullCounters[category].record(false, (int)grid.size() - visible);
+}
+
+// Autumn sun lighting - warmer and lower angle. Call with the view set up,
+// since the light position is transformed by the modelview matrix.
+void setSunLight() {
+    float sun[3];
+    sunPosition(sun);
+    
+    GLfloat light_position[] = { sun[0], sun[1], sun[2], 0.0f };
+    GLfloat light_ambient[] = { 0.45f, 0.4f, 0.35f, 1.0f };
+    GLfloat light_diffuse[] = { 1.0f, 0.88f, 0.65f, 1.0f };
+    GLfloat light_specular[] = { 0.9f, 0.8f, 0.6f, 1.0f };
+    
+    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
+    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, light_specular);
+}
+
+// --- Far-Field Baking ---
+
+// True when nothing inside 'bounds' is within FAR_FIELD_RADIUS of 'eye'
+bool beyondFarFieldRadius(const BoundingSphere& bounds, const float eye[3]) {
+    float dx = bounds.x - eye[0], dy = bounds.y - eye[1], dz = bounds.z - eye[2];
+    return sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius >= FAR_FIELD_RADIUS;
+}
+
+// Sets or clears texture set 'set' in an object's impostorSets; returns 'baked'
+bool markFarField(uint8_t& impostorSets, int set, bool baked) {
+    if (baked) impostorSets |= (uint8_t)(1 << set);
+    else impostorSets &= (uint8_t)~(1 << set);
+    return baked;
+}
+
+// Level an object would get from the current lodView(), leaving its state alone
+int peekLod(const LodState& lod, const BoundingSphere& bounds) {
+    return lodSelect(lod.level, lodProjectedPixels(bounds.x, bounds.y, bounds.z, bounds.radius));
+}
+
+// Whether the front panorama no longer matches the eye, sun or sky
+bool farFieldStale(const float eye[3], const float sky[3]) {
+    if (!farField.ready()) return true;
+    int set = farField.frontSet();
+    const float* bakedEye = farField.frontEye();
+    float dx = eye[0] - bakedEye[0], dy = eye[1] - bakedEye[1], dz = eye[2] - bakedEye[2];
+    if (dx * dx + dy * dy + dz * dz > IMPOSTOR_REBAKE_DISTANCE * IMPOSTOR_REBAKE_DISTANCE) return true;
+    float turn = fabs(renderSnapshot.sunAngle - impostorSunAngle[set]);
+    if (min(turn, 2.0f * (float)M_PI - turn) > IMPOSTOR_REBAKE_SUN_ANGLE) return true;
+    for (int k = 0; k < 3; ++k) {
+        if (fabs(sky[k] - impostorSkyColor[set][k]) > IMPOSTOR_REBAKE_SKY_COLOR) return true;
+    }
+    return false;
+}
+
+// Starts baking a panorama around 'eye': splits the far-field objects and
+// reports the box of each baked one, so the backdrop knows where it has content
+void beginFarFieldBake(const float eye[3], const float sky[3]) {
+    int set = farField.backSet();
+    int baked = 0;
+    farField.beginBake(eye);
+    for (auto& tile : terrainTiles) {
+        if (markFarField(tile.impostorSets, set, beyondFarFieldRadius(tile.bounds, eye))) {
+            farField.addContent(tile.boxLo, tile.boxHi);
+        }
+    }
+    for (auto& hill : hills) {
+        if (!markFarField(hill.impostorSets, set, beyondFarFieldRadius(hill.bounds, eye))) continue;
+        const float lo[3] = { hill.x - hill.radius, 0.0f, hill.z - hill.radius };
+        const float hi[3] = { hill.x + hill.radius, hill.height, hill.z + hill.radius };
+        farField.addContent(lo, hi);
+        ++baked;
+    }
+    for (auto& tree : distantTrees) {
+        if (!markFarField(tree.impostorSets, set, beyondFarFieldRadius(tree.bounds, eye))) continue;
+        const float lo[3] = { tree.x - tree.width, 0.0f, tree.z - tree.width };
+        const float hi[3] = { tree.x + tree.width, tree.height * 1.1f, tree.z + tree.width };
+        farField.addContent(lo, hi);
+        ++baked;
+    }
+    impostorBakedObjects[set] = baked;
+    impostorSunAngle[set] = renderSnapshot.sunAngle;
+    for (int k = 0; k < 3; ++k) impostorSkyColor[set][k] = sky[k];
+}
+
+// Renders one panorama panel. Objects that stay live only fill depth, which
+// leaves the backdrop transparent wherever they will be drawn in front of it.
+void bakeFarFieldPanel(const Frustum& frustum) {
+    int set = farField.backSet();
+    const float* eye = farField.backEye();
+    setSunLight();
+    for (int pass = 0; pass < 2; ++pass) {
+        bool baked = pass == 1;
+        glColorMask(baked, baked, baked, baked);
+        bakeQueue.begin(eye[0], eye[1], eye[2]);
+        drawGroundTiles(bakeQueue, frustum, set, baked);
+        for (const auto& hill : hills) {
+            if (((hill.impostorSets >> set) & 1) != baked || !sphereInFrustum(frustum, hill.bounds)) continue;
+            drawHill(bakeQueue, hill, peekLod(hill.lod, hill.bounds));
+        }
+        distantTreeGrid.queryFrustum(frustum, [set, baked](uint32_t i) {
+            const DistantTree& tree = distantTrees[i];
+            if (((tree.impostorSets >> set) & 1) == baked) {
+                drawDistantTree(bakeQueue, tree, peekLod(tree.lod, tree.bounds));
+            }
+        });
+        bakeQueue.flush();
+    }
+}
+
+// Starts a rebake when the front panorama is stale and renders the panels
+// due this frame; the first panorama is baked in one go. Runs with the
+// camera set up but before the frame is cleared.
+void updateFarField(float eyeX, float eyeY, float eyeZ, const float sky[3]) {
+    if (!farField.enabled()) return;
+    const float eye[3] = { eyeX, eyeY, eyeZ };
+    if (!farField.baking() && farFieldStale(eye, sky)) beginFarFieldBake(eye, sky);
+    if (!farField.baking()) return;
+    
+    long long triangles = meshTrianglesDrawn();
+    lodSetView(eyeX, eyeY, eyeZ, farField.panelFieldOfView(), farField.panelSize());
+    farField.bakePanels(farField.ready() ? IMPOSTOR_PANELS_PER_FRAME : PanoramaImpostor::PANELS, bakeFarFieldPanel);
+    glState().invalidateTextures();
+    impostorBakeTriangles += meshTrianglesDrawn() - triangles;
+}
+
+uint64_t sceneAssetKey() {
+    AssetCacheKey key;
+    key.add(SCENE_ASSET_VERSION);
+    key.add(textureSize);
+    key.add(BARK_TEXTURE);
+    key.add(GROUND_TEXTURE);
+    key.add(TERRAIN_GRID_SIZE);
+    key.add(TERRAIN_CELL_SIZE);
+    key.add(TERRAIN_TILE_CELLS);
+    key.add(LOD_LEVELS);
+    return key.hash;
+}
+
+int terrainTileCount() {
+    int tiles = (TERRAIN_GRID_SIZE + TERRAIN_TILE_CELLS - 1) / TERRAIN_TILE_CELLS;
+    return tiles * tiles;
+}
+
+// Textures depend on the seed; they are only worth caching when it repeats
+bool cacheSeededAssets() {
+    return sceneSeedGiven() || benchEnabled();
+}
+
+// True if 'cache' holds both textures, generated from the current seed
+bool cachedTexturesMatch(const AssetCache& cache) {
+    size_t seedBytes, barkBytes, groundBytes;
+    const void* seed = cache.find(ASSET_TEXTURE_SEED, 0, seedBytes);
+    const void* bark = cache.find(ASSET_BARK_TEXTURE, 0, barkBytes);
+    const void* ground = cache.find(ASSET_GROUND_TEXTURE, 0, groundBytes);
+    if (!seed || !bark || !ground || seedBytes != sizeof(uint64_t) || barkBytes != textureChainBytes(textureSize) ||
+        groundBytes != textureChainBytes(textureSize)) {
+        return false;
+    }
+    uint64_t cachedSeed;
+    memcpy(&cachedSeed, seed, sizeof(cachedSeed));
+    return cachedSeed == sceneSeed();
+}
+
+// Takes the terrain and the prototypes from 'cache'. Nothing is changed
+// unless all of them are present and well formed; the textures, if any,
+// are left in the mapping for the loader to hand to the GL thread.
+bool loadCachedAssets(const AssetCache& cache) {
+    size_t heightBytes, bytes;
+    const void* heights = cache.find(ASSET_TERRAIN_HEIGHTS, 0, heightBytes);
+    const size_t heightCount = (size_t)(TERRAIN_GRID_SIZE + 1) * (TERRAIN_GRID_SIZE + 1);
+    if (!heights || heightBytes != heightCount * sizeof(float)) return false;
+
+    vector<TerrainTile> tiles(terrainTileCount());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const void* blob = cache.find(ASSET_TERRAIN_TILE, (uint32_t)i, bytes);
+        if (!readMeshBlob(blob, bytes, tiles[i].mesh)) return false;
+    }
+    Mesh pumpkinLevels[LOD_LEVELS], trunkLevels[LOD_LEVELS], canopyLevels[LOD_LEVELS];
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        const void* blob = cache.find(ASSET_PUMPKIN_MESH, level, bytes);
+        if (!readMeshBlob(blob, bytes, pumpkinLevels[level])) return false;
+        blob = cache.find(ASSET_TREE_TRUNK_MESH, level, bytes);
+        if (!readMeshBlob(blob, bytes, trunkLevels[level])) return false;
+        blob = cache.find(ASSET_TREE_CANOPY_MESH, level, bytes);
+        if (!readMeshBlob(blob, bytes, canopyLevels[level])) return false;
+    }
+
+    const float* h = (const float*)heights;
+    terrainHeights.assign(h, h + heightCount);
+    terrainTiles.swap(tiles);
+    for (TerrainTile& tile : terrainTiles) measureTerrainTile(tile);
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        pumpkinMeshes[level] = std::move(pumpkinLevels[level]);
+        treeTrunkMeshes[level] = std::move(trunkLevels[level]);
+        treeCanopyMeshes[level] = std::move(canopyLevels[level]);
+    }
+    return true;
+}
+
+// Terrain and prototype meshes: from the asset cache when it matches,
+// otherwise built. Returns the open cache on a hit, for its textures.
+shared_ptr<AssetCache> loadSceneAssets() {
+    TraceScope scope("loadSceneAssets", "init");
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    shared_ptr<AssetCache> cache = make_shared<AssetCache>();
+    if (!assetCachePath.empty() && cache->open(assetCachePath.c_str(), sceneAssetKey()) && loadCachedAssets(*cache)) {
+        assetCacheHit = true;
+        assetCacheBytes = cache->bytes();
+    } else {
+        cache.reset();
+        buildTerrain();
+        for (int level = 0; level < LOD_LEVELS; ++level) {
+            buildPumpkinMesh(pumpkinMeshes[level], level);
+            buildTreeMeshes(level);
+        }
+    }
+    assetBuildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    scope.setArg("cache_hit", assetCacheHit);
+    return cache;
+}
+
+// Writes the scene assets to a fresh cache file, the textures only if
+// given; loader thread. The GL thread only reads the terrain and prototype
+// arrays by now.
+void writeAssetCache(const TextureImage* bark, const TextureImage* ground) {
+    TraceScope scope("writeAssetCache", "load");
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    AssetCacheWriter writer;
+    const uint64_t seed = sceneSeed();
+    if (bark && ground) {
+        writer.add(ASSET_TEXTURE_SEED, 0, &seed, sizeof(seed));
+        writer.add(ASSET_BARK_TEXTURE, 0, bark->texels.data(), bark->texels.size());
+        writer.add(ASSET_GROUND_TEXTURE, 0, ground->texels.data(), ground->texels.size());
+    }
+    writer.add(ASSET_TERRAIN_HEIGHTS, 0, terrainHeights.data(), terrainHeights.size() * sizeof(float));
+    for (size_t i = 0; i < terrainTiles.size(); i++) writer.addMesh(ASSET_TERRAIN_TILE, (uint32_t)i, terrainTiles[i].mesh);
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        writer.addMesh(ASSET_PUMPKIN_MESH, level, pumpkinMeshes[level]);
+        writer.addMesh(ASSET_TREE_TRUNK_MESH, level, treeTrunkMeshes[level]);
+        writer.addMesh(ASSET_TREE_CANOPY_MESH, level, treeCanopyMeshes[level]);
+    }
+    size_t bytes = writer.write(assetCachePath.c_str(), sceneAssetKey());
+    if (bytes == 0) cerr << "Could not write asset cache " << assetCachePath << endl;
+    else assetCacheBytes = bytes;
+    assetCacheWritten = bytes != 0;
+    assetWriteMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Loader thread: populates the scene and hands it over, then the textures
+// (from the cache mapping when they match, generated otherwise). A miss
+// writes a fresh cache, as does generating textures for a repeatable seed.
+// The batches it fills are empty until now, so clearing them makes no GL
+// calls.
+void loadSceneInBackground(AsyncLoader& loader, shared_ptr<AssetCache> cache) {
+    initializeLeaves();
+    buildForest();
+    buildSpatialGrids();
+    loader.post([](size_t&) {
+        sceneLoaded = true;
+        traceInstant("scene loaded", "load");
+        return true;
+    });
+
+    if (cache && cachedTexturesMatch(*cache)) {
+        size_t bytes;
+        assetCacheTextureHit = true;
+        loader.post(textureUploadTask(groundTexture, (const unsigned char*)cache->find(ASSET_GROUND_TEXTURE, 0, bytes), cache));
+        loader.post(textureUploadTask(barkTexture, (const unsigned char*)cache->find(ASSET_BARK_TEXTURE, 0, bytes), cache));
+        return;
+    }
+    shared_ptr<TextureImage> bark = make_shared<TextureImage>(), ground = make_shared<TextureImage>();
+    generateTextures(*bark, *ground);
+    loader.post(textureUploadTask(groundTexture, ground->texels.data(), ground));
+    loader.post(textureUploadTask(barkTexture, bark->texels.data(), bark));
+    if (assetCachePath.empty()) return;
+    if (cacheSeededAssets()) writeAssetCache(bark.get(), ground.get());
+    else if (!cache) writeAssetCache(nullptr, nullptr);
+}
+
+// Ends each frame until the loader is done: notes the first frame and the
+// first frame with everything in, both from process start
+void recordStartupMilestones() {
+    if (fullyLoaded) return;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+    if (loadingFrames++ == 0) {
+        firstFrameMs = ms;
+        traceInstant("first frame", "load");
+    }
+    if (!sceneLoader.done()) return;
+    sceneLoader.join();
+    fullyLoaded = true;
+    fullyLoadedMs = ms;
+    traceInstant("fully loaded", "load");
+    if (benchEnabled()) return;
+    cout << "Startup: first frame after " << firstFrameMs << " ms, fully loaded after " << fullyLoadedMs
+         << " ms (" << loadingFrames << " frames)" << endl;
+    if (!assetCachePath.empty()) {
+        cout << "Asset cache: " << assetCachePath
+             << (assetCacheWritten ? " (written)" : assetCacheTextureHit ? " (loaded)"
+                 : assetCacheHit ? " (meshes loaded, textures generated for this seed)" : " (not writable)") << endl;
+    }
+}
+
+// Leaves through exit(), which also writes the trace if one is recorded
+void quitScene() {
+    frameProfiler().flush();
+    frameProfiler().closeCsv();
+    sceneLoader.join(); // Before the job system it may be using shuts down
+    exit(0);
+}
+
+// Times one opaque pass while it records and tags what it queues, so the
+// queue charges the GPU time of its sorted submission back to the pass
+template <typename Draw>
+void recordPass(RenderQueue& queue, ProfileSection section, Draw draw) {
+    ProfileScope scope(section, false);
+    queue.setProfileSection(section);
+    draw();
+}
+
+void drawHudText(float x, float y, const char* text) {
+    glRasterPos2f(x, y);
+    for (const char* c = text; *c; ++c) glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+}
+
+// Per-section CPU and GPU times, averaged over the last frames the profiler
+// completed, and the draw counts of the last frame, in the top left corner
+void drawProfilerHud() {
+    const FrameProfiler& profiler = frameProfiler();
+    double frameMs;
+    vector<double> cpuMs, gpuMs;
+    profiler.average(frameMs, cpuMs, gpuMs);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const int lineHeight = 14, width = 410;
+    int lines = PROFILE_SECTION_COUNT + 6;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_FOG);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_CULL_FACE);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, viewport[2], 0, viewport[3], -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    float top = (float)viewport[3];
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+    glRectf(0.0f, top - (lines + 1) * lineHeight, (float)width, top);
+
+    char line[96];
+    float y = top - lineHeight;
+    glColor3f(1.0f, 1.0f, 1.0f);
+    snprintf(line, sizeof(line), "frame %6.2f ms  (last %d frames)", frameMs, (int)profiler.recentFrames().size());
+    drawHudText(8.0f, y, line);
+    snprintf(line, sizeof(line), "%-18s %7s %7s %6s %7s", "section", "cpu ms", profiler.gpuTiming() ? "gpu ms" : "no gpu",
+             "calls", "verts");
+    drawHudText(8.0f, y -= lineHeight, line);
+
+    double sectionsMs = 0.0;
+    for (int i = 0; i < PROFILE_SECTION_COUNT; ++i) {
+        const ProfileSectionDesc& desc = PROFILE_SECTIONS[i];
+        if (desc.depth == 0) sectionsMs += cpuMs[i];
+        char gpu[16] = "-";
+        if (gpuMs[i] >= 0.0) snprintf(gpu, sizeof(gpu), "%7.2f", gpuMs[i]);
+        const DrawCounts& draws = drawCounters().lastFrame(i);
+        snprintf(line, sizeof(line), "%s%-*s %7.2f %7s %6lld %7lld", desc.depth ? "  " : "", desc.depth ? 16 : 18,
+                 desc.name, cpuMs[i], gpu, draws.value[DRAW_CALLS], draws.value[DRAW_VERTICES]);
+        drawHudText(8.0f, y -= lineHeight, line);
+    }
+    const DrawCounts& otherDraws = drawCounters().lastFrame(-1);
+    snprintf(line, sizeof(line), "%-18s %7.2f %7s %6lld %7lld", "other (swap, idle)", max(0.0, frameMs - sectionsMs), "",
+             otherDraws.value[DRAW_CALLS], otherDraws.value[DRAW_VERTICES]);
+    drawHudText(8.0f, y -= lineHeight, line);
+
+    DrawCounts draws = drawCounters().lastFrameTotal();
+    snprintf(line, sizeof(line), "calls %lld (%lld glBegin)  verts %lld  prims %lld", draws.value[DRAW_CALLS],
+             draws.value[DRAW_BEGIN_BLOCKS], draws.value[DRAW_VERTICES], draws.value[DRAW_PRIMITIVES]);
+    drawHudText(8.0f, y -= lineHeight, line);
+    snprintf(line, sizeof(line), "pushes %lld  materials %lld  binds %lld  blend %lld", draws.value[DRAW_MATRIX_PUSHES],
+             draws.value[DRAW_MATERIAL_CHANGES], draws.value[DRAW_TEXTURE_BINDS], draws.value[DRAW_BLEND_TOGGLES]);
+    drawHudText(8.0f, y -= lineHeight, line);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
 void initialize() {
+    TraceScope scope("initialize", "init");
     // IMPROVED: Enable antialiasing
     glEnable(GL_MULTISAMPLE);
     glEnable(GL_LINE_SMOOTH);
@@ -919,6 +1742,7 @@ void initialize() {
     
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
+    glEnable(GL_NORMALIZE); // Cached meshes are scaled by the modelview matrix
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
     glEnable(GL_CULL_FACE);
     
@@ -937,15 +1761,26 @@ void initialize() {
 
     glShadeModel(GL_SMOOTH);
     
-    barkTexture = createBarkTexture();
-    groundTexture = createGroundTexture();
-    
-    initializeLeaves();
+    shared_ptr<AssetCache> cache = loadSceneAssets();
+    const Mesh* pumpkinLevels[LOD_LEVELS];
+    for (int level = 0; level < LOD_LEVELS; ++level) pumpkinLevels[level] = &pumpkinMeshes[level];
+    pumpkinBatch.setLodPrototypes(pumpkinLevels, LOD_LEVELS);
+    prepareLodMeshes();
+    skyDome.init();
+    farField.init(IMPOSTOR_PANEL_SIZE, IMPOSTOR_BOTTOM, IMPOSTOR_TOP, FAR_FIELD_RADIUS, FAR_CLIP);
+    previousSnapshot = captureSnapshot();
+    sceneLoader.start([cache](AsyncLoader& loader) { loadSceneInBackground(loader, cache); });
 }
 
-void renderScene() {
+void drawScene() {
+    if (!fullyLoaded) {
+        ProfileScope scope(PROFILE_UPLOADS);
+        sceneLoader.pump(LOAD_UPLOAD_BUDGET);
+    }
+    renderSnapshot = blendSnapshots(previousSnapshot, captureSnapshot(), renderAlpha);
+    
     // Autumn sky colors - warmer tones
-    float timeInfluence = sin(timeOfDay * 0.5f);
+    float timeInfluence = sin(renderSnapshot.timeOfDay * 0.5f);
     float skyR = 0.75f + 0.15f * timeInfluence;
     float skyG = 0.65f + 0.1f * timeInfluence;
     float skyB = 0.55f + 0.05f * timeInfluence;
@@ -955,7 +1790,6 @@ void renderScene() {
     GLfloat fogColor[4] = {skyR, skyG, skyB, 1.0f};
     glFogfv(GL_FOG_COLOR, fogColor);
     
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 
@@ -969,101 +1803,176 @@ void renderScene() {
                   manPositionX, 0.0f, manPositionZ,
                   0.0f, 0.0f, -1.0f);
     } else {
-        float pitchRad = cameraPitch * M_PI / 180.0f;
-        float angleRad = cameraAngle * M_PI / 180.0f;
+        float pitchRad = renderSnapshot.cameraPitch * M_PI / 180.0f;
+        float angleRad = renderSnapshot.cameraAngle * M_PI / 180.0f;
+        float distance = renderSnapshot.distanceFromMan;
         
-        camX = manPositionX + distanceFromMan * sin(angleRad) * cos(pitchRad);
-        camY = 100.0f + distanceFromMan * sin(pitchRad);
-        camZ = manPositionZ + distanceFromMan * cos(angleRad) * cos(pitchRad);
+        camX = manPositionX + distance * sin(angleRad) * cos(pitchRad);
+        camY = 100.0f + distance * sin(pitchRad);
+        camZ = manPositionZ + distance * cos(angleRad) * cos(pitchRad);
         
         gluLookAt(camX, camY, camZ,
                   manPositionX, 30.0f, manPositionZ,
                   0.0f, 1.0f, 0.0f);
     }
 
-    // Autumn sun lighting - warmer and lower angle
-    float sunX = 1200.0f * cos(sunAngle);
-    float sunY = 600.0f + 400.0f * sin(sunAngle); // Match the raised sun position
-    float sunZ = 1200.0f * sin(sunAngle);
-    
-    GLfloat light_position[] = { sunX, sunY, sunZ, 0.0f };
-    GLfloat light_ambient[] = { 0.45f, 0.4f, 0.35f, 1.0f };
-    GLfloat light_diffuse[] = { 1.0f, 0.88f, 0.65f, 1.0f };
-    GLfloat light_specular[] = { 0.9f, 0.8f, 0.6f, 1.0f };
-    
-    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
-    glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
-    glLightfv(GL_LIGHT0, GL_SPECULAR, light_specular);
+    glState().beginFrame();
 
-    // Draw background elements first
-    drawHills();
+    // Far-field panels render into their textures through a framebuffer
+    // object (impostor.h, entry points from gl_extensions.h), with their own
+    // viewport and clears. Nothing is baked before the whole scene is in.
+    if (fullyLoaded) {
+        ProfileScope scope(PROFILE_FAR_FIELD_BAKE);
+        updateFarField(camX, camY, camZ, fogColor);
+    }
+    glClear(GL_DEPTH_BUFFER_BIT); // The sky dome covers every pixel
+
+    viewFrustum = frustumFromGL();
+    for (auto& counter : cullCounters) counter.beginFrame();
+    lodSetView(camX, camY, camZ, FIELD_OF_VIEW, viewportHeight);
+    for (auto& counter : lodCounters) counter.beginFrame();
+    meshTrianglesDrawn() = 0;
+
+    setSunLight();
+
+    // The opaque scene is queued, then drawn sorted by texture and material
+    RenderQueue& queue = sceneQueue;
+    queue.begin(camX, camY, camZ);
+
+    recordPass(queue, PROFILE_GROUND, [&queue] { drawGround(queue); });
     
-    // Draw distant trees
-    for (const auto& dt : distantTrees) {
-        drawDistantTree(dt.x, dt.z, dt.height, dt.width);
+    // Props exist once the loader has handed the population over
+    if (sceneLoaded) {
+        // Draw background elements first
+        recordPass(queue, PROFILE_HILLS, [&queue] { drawHills(queue); });
+        
+        // Draw distant trees
+        // Draw distant trees; those in the backdrop count as baked
+        recordPass(queue, PROFILE_DISTANT_TREES, [&queue] {
+            CullCounter& counter = cullCounters[CULL_DISTANT_TREES];
+            int inside = (int)distantTreeGrid.queryFrustum(viewFrustum, [&queue, &counter](uint32_t i) {
+                DistantTree& tree = distantTrees[i];
+                if (farFieldBaked(tree.impostorSets)) {
+                    counter.recordBaked();
+                    return;
+                }
+                counter.record(true);
+                drawDistantTree(queue, tree, selectLod(tree.lod, tree.bounds, CULL_DISTANT_TREES));
+            });
+            counter.record(false, (int)distantTreeGrid.size() - inside);
+        });
+        
+        recordPass(queue, PROFILE_LEAF_PILES, [&queue] {
+            drawVisibleProps(leafPileGrid, CULL_LEAF_PILES, [&queue](uint32_t i) {
+                LeafPile& pile = leafPiles[i];
+                drawLeafPile(queue, pile, selectLod(pile.lod, pile.bounds, CULL_LEAF_PILES));
+            });
+        });
+        
+        recordPass(queue, PROFILE_PUMPKINS, [&queue] { drawPumpkins(queue); });
+        
+        recordPass(queue, PROFILE_FLOWERS, [&queue] {
+            drawVisibleProps(flowerGrid, CULL_FLOWERS, [&queue](uint32_t i) {
+                Flower& flower = flowers[i];
+                drawChrysanthemum(queue, flower.x, flower.z, flower.color[0], flower.color[1], flower.color[2],
+                                  flower.petalRotation, selectLod(flower.lod, flower.bounds, CULL_FLOWERS));
+            });
+        });
+        
+        // Draw foreground trees
+        recordPass(queue, PROFILE_FOREST, [&queue] { drawForest(queue); });
     }
     
-    drawGround();
-    drawDynamicSky();
+    recordPass(queue, PROFILE_MAN, [&queue] {
+        draw3DMan(queue, manPositionX, heightAt(manPositionX, manPositionZ), manPositionZ);
+    });
     
-    for (const auto& pile : leafPiles) {
-        drawLeafPile(pile.x, pile.z, pile.size, pile.height);
+    {
+        ProfileScope scope(PROFILE_SUBMIT);
+        queue.flush();
     }
     
-    for (const auto& pumpkin : pumpkins) {
-        drawDetailedPumpkin(pumpkin.x, pumpkin.z, pumpkin.size, pumpkin.rotation);
+    // Sky into whatever the opaque scene left open, then the baked far field
+    // over it, then clouds in front of both
+    {
+        ProfileScope scope(PROFILE_SKY);
+        drawDynamicSky(camX, camY, camZ);
     }
-    
-    for (const auto& flower : flowers) {
-        drawChrysanthemum(flower.x, flower.z, flower.color[0], flower.color[1], flower.color[2], flower.petalRotation);
+    {
+        ProfileScope scope(PROFILE_FAR_FIELD);
+        farField.draw();
     }
-    
-    // Draw foreground trees
-    float treeSpacing = 180.0f;
-    for (int i = -3; i <= 3; i++) {
-        for (int j = -3; j <= 3; j++) {
-            if (i == 0 && j == 0) continue;
-            draw3DTree(i * treeSpacing, j * treeSpacing);
+    if (sceneLoaded) {
+        {
+            ProfileScope scope(PROFILE_CLOUDS);
+            drawClouds();
         }
+        ProfileScope scope(PROFILE_LEAVES);
+        draw3DLeaves();
     }
-    
-    draw3DMan(manPositionX, 0.0f, manPositionZ);
-    draw3DLeaves();
 
-    glutSwapBuffers();
+    frameTriangles = (int)meshTrianglesDrawn();
+    totalTriangles += frameTriangles;
+    recordStartupMilestones();
+    if (profilerHud) drawProfilerHud();
+    frameProfiler().endFrame();
+    if (traceHandleRequests()) quitScene();
 }
 
-void updateScene(int value) {
+void renderScene() {
+    {
+        TraceScope scope("drawScene", "frame");
+        drawScene();
+    }
+    {
+        TraceScope scope("glutSwapBuffers", "frame");
+        glutSwapBuffers();
+    }
+    
+    if (simClock.frameRendered()) {
+        char title[160];
+        simClock.formatTitle(title, sizeof(title), WINDOW_TITLE);
+        glutSetWindowTitle(title);
+    }
+}
+
+// --- Simulation Tasks ---
+// stepScene() runs these as a task graph on the job system. Camera, leaves,
+// clouds and the man/sky state touch disjoint data, so they update in
+// parallel; leaves are further split into chunks. No task issues GL calls.
+TaskGraph simulationGraph;
+LeafSimParams leafParams;  // Shared by every leaf chunk of the current tick
+
+void stepCamera() {
     // Smooth camera interpolation
     cameraAngle += (targetCameraAngle - cameraAngle) * CAMERA_SMOOTHNESS;
     cameraPitch += (targetCameraPitch - cameraPitch) * CAMERA_SMOOTHNESS;
     distanceFromMan += (targetDistanceFromMan - distanceFromMan) * CAMERA_SMOOTHNESS;
-    
-    // Update leaf positions with rotation
-    for (auto& leaf : fallingLeaves) {
-        leaf.y -= leaf.fallSpeed;
-        leaf.rotation += leaf.rotationSpeed;
-        
-        if (leaf.y < 0) {
-            leaf.y = 500.0f + (rand() % 100);
-            leaf.x = (rand() % 1000) - 500.0f;
-            leaf.z = (rand() % 1000) - 500.0f;
-            leaf.fallSpeed = 0.3f + (static_cast <float> (rand() % 100) / 100.0f) * 1.0f;
-            leaf.rotation = rand() % 360;
+}
+
+void stepLeaves() {
+    if (!sceneLoaded) return;
+    // Update leaf positions with rotation, drift and wind, one job per chunk
+    parallelFor(0, leafSimChunkCount(fallingLeaves), 1, [](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            leafSimStepChunk(fallingLeaves, leafParams, LEAF_SPAWN, chunk);
         }
-    }
-    
-    // Update clouds
+    });
+}
+
+void stepClouds() {
+    if (!sceneLoaded) return;
     for (auto& cloud : clouds) {
+        cloud.prevX = cloud.x;
         cloud.x += cloud.speed;
         if (cloud.x > 1500.0f) {
-            cloud.x = -1500.0f;
-            cloud.z = (rand() % 3000) - 1500.0f;
+            cloud.x = cloud.prevX = -1500.0f;
+            cloud.z = cloudRng.range(-1500.0f, 1500.0f);
         }
     }
+}
 
-    leafDriftSpeed += 0.02f;
+void stepManAndSky() {
     sunAngle += 0.003f;
     if (sunAngle > 2.0f * M_PI) sunAngle -= 2.0f * M_PI;
     
@@ -1096,9 +2005,214 @@ void updateScene(int value) {
         jacketColor[1] = 1.0f - (hue - 0.666f) * 3.0f; 
         jacketColor[2] = 1.0f; 
     }
+}
+
+void buildSimulationGraph() {
+    simulationGraph = TaskGraph();
+    simulationGraph.add([] { ProfileScope scope(PROFILE_CAMERA); stepCamera(); });
+    simulationGraph.add([] { ProfileScope scope(PROFILE_LEAF_SIM); stepLeaves(); });
+    simulationGraph.add([] { ProfileScope scope(PROFILE_CLOUD_SIM); stepClouds(); });
+    simulationGraph.add([] { ProfileScope scope(PROFILE_MAN_SKY); stepManAndSky(); });
+}
 
+// One fixed simulation tick
+void stepScene() {
+    ProfileScope scope(PROFILE_UPDATE);
+    previousSnapshot = captureSnapshot();
+    leafDriftSpeed += 0.02f;
+    leafParams = { leafDriftSpeed, 20.0f, 5.0f,
+                   windStrength * 30.0f * cos(windDirection),
+                   windStrength * 30.0f * sin(windDirection) };
+    simulationGraph.run();
+}
+
+// Runs whatever simulation ticks are due, then asks for a new frame right away
+void idleScene() {
+    TraceScope scope("idle", "frame");
+    int steps = simClock.advance();
+    scope.setArg("ticks", steps);
+    for (int i = 0; i < steps; ++i) {
+        stepScene();
+    }
+    renderAlpha = simClock.alpha();
     glutPostRedisplay();
-    glutTimerFunc(16, updateScene, 0);
+}
+
+// Objects drawn at each LOD level per category in the last frame
+void printLodStats() {
+    cout << "--- Level of detail (last frame, levels 0-" << LOD_LEVELS - 1 << ") ---" << endl;
+    for (int i = 0; i < CULL_CATEGORY_COUNT; ++i) {
+        const LodCounter& counter = lodCounters[i];
+        cout << CULL_CATEGORY_NAMES[i] << ":";
+        for (int level = 0; level < LOD_LEVELS; ++level) cout << " " << counter.objects[level];
+        cout << endl;
+    }
+    cout << "mesh triangles: " << frameTriangles << endl;
+}
+
+void printImpostorStats() {
+    cout << "--- Far-field impostor ---" << endl;
+    if (!farField.ready()) {
+        cout << "not in use (needs framebuffer objects)" << endl;
+        return;
+    }
+    cout << "baked hills and distant trees: " << impostorBakedObjects[farField.frontSet()] << endl;
+    cout << "panoramas baked: " << farField.bakesCompleted << " (" << farField.panelsBaked << " panels)"
+         << (farField.baking() ? ", rebaking" : "") << endl;
+}
+
+// Visible and culled objects per category in the last frame
+void printCullStats() {
+    cout << "--- Frustum culling (last frame) ---" << endl;
+    for (int i = 0; i < CULL_CATEGORY_COUNT; ++i) {
+        cout << CULL_CATEGORY_NAMES[i] << ": " << cullCounters[i].visible << " drawn, "
+             << cullCounters[i].culled << " culled";
+        if (cullCounters[i].baked) cout << ", " << cullCounters[i].baked << " in the far-field backdrop";
+        cout << endl;
+    }
+    cout << "props within " << PROXIMITY_RADIUS << " of the man: "
+         << (sceneLoaded ? countPropsNear(manPositionX, manPositionZ, PROXIMITY_RADIUS) : 0) << endl;
+    printLodStats();
+    cout << "clouds: " << cloudBatch.meshClouds << " meshes, " << cloudBatch.spriteClouds << " sprites, "
+         << cloudBatch.trianglesDrawn << " triangles in one batch" << endl;
+    printImpostorStats();
+    const RenderQueueStats& queued = sceneQueue.stats;
+    cout << "render queue: " << queued.items << " items, " << queued.textureChanges << " texture and "
+         << queued.materialChanges << " material changes (" << queued.unsortedTextureChanges << " and "
+         << queued.unsortedMaterialChanges << " unsorted)" << endl;
+    cout << "--- GL state calls (last frame) ---" << endl;
+    glStatePrintFrame(cout);
+    if (frameProfiler().active()) {
+        DrawCounts draws = drawCounters().lastFrameTotal();
+        cout << "--- Draw counters (last frame) ---" << endl;
+        for (int k = 0; k < DRAW_COUNTER_KIND_COUNT; ++k) cout << DRAW_COUNTER_NAMES[k] << ": " << draws.value[k] << endl;
+    }
+}
+
+// Mean visible, culled and impostor-drawn objects per frame, appended to the benchmark JSON
+void writeCullReport(FILE* out) {
+    double frames = benchTimedFrames();
+    fprintf(out, "  \"culling\": {");
+    for (int i = 0; i < CULL_CATEGORY_COUNT; ++i) {
+        fprintf(out, "%s\n    \"%s\": {\"visible\": %.2f, \"culled\": %.2f, \"impostor\": %.2f}", i ? "," : "",
+                CULL_CATEGORY_NAMES[i], cullCounters[i].totalVisible / frames, cullCounters[i].totalCulled / frames,
+                cullCounters[i].totalBaked / frames);
+    }
+    fprintf(out, "\n  }");
+}
+
+// Mean objects per LOD level and mesh triangles per frame, for the benchmark JSON
+void writeLodReport(FILE* out) {
+    double frames = benchTimedFrames();
+    fprintf(out, "  \"lod\": {");
+    for (int i = 0; i < CULL_CATEGORY_COUNT; ++i) {
+        const LodCounter& counter = lodCounters[i];
+        fprintf(out, "%s\n    \"%s\": [", i ? "," : "", CULL_CATEGORY_NAMES[i]);
+        for (int level = 0; level < LOD_LEVELS; ++level) {
+            fprintf(out, "%s%.2f", level ? ", " : "", counter.totalObjects[level] / frames);
+        }
+        fprintf(out, "]");
+    }
+    fprintf(out, "\n  },\n  \"mesh_triangles_per_frame\": %.0f", totalTriangles / frames);
+}
+
+// Far-field rebakes and their cost per frame, for the benchmark JSON
+void writeImpostorReport(FILE* out) {
+    double frames = benchTimedFrames();
+    fprintf(out, "  \"impostor\": {\"enabled\": %s, \"panoramas_baked\": %lld, \"panels_per_frame\": %.3f, "
+            "\"bake_triangles_per_frame\": %.0f, \"baked_objects\": %d}",
+            farField.ready() ? "true" : "false", farField.bakesCompleted, farField.panelsBaked / frames,
+            impostorBakeTriangles / frames, farField.ready() ? impostorBakedObjects[farField.frontSet()] : 0);
+}
+
+// Clouds drawn per frame as meshes and as sprites, for the benchmark JSON
+void writeCloudReport(FILE* out) {
+    double frames = benchTimedFrames();
+    fprintf(out, "  \"clouds\": {\"count\": %d, \"sprites_enabled\": %s, \"meshes_per_frame\": %.2f, "
+            "\"sprites_per_frame\": %.2f}",
+            (int)clouds.size(), cloudSprites ? "true" : "false", totalMeshClouds / frames, totalSpriteClouds / frames);
+}
+
+// Opaque items and the state changes submitting them took per frame, sorted
+// and as they were queued, for the benchmark JSON
+void writeRenderQueueReport(FILE* out) {
+    double frames = benchTimedFrames();
+    const RenderQueueStats& totals = sceneQueue.totals;
+    fprintf(out, "  \"render_queue\": {\"items_per_frame\": %.2f, \"texture_changes_per_frame\": %.2f, "
+            "\"material_changes_per_frame\": %.2f, \"unsorted_texture_changes_per_frame\": %.2f, "
+            "\"unsorted_material_changes_per_frame\": %.2f}",
+            totals.items / frames, totals.textureChanges / frames, totals.materialChanges / frames,
+            totals.unsortedTextureChanges / frames, totals.unsortedMaterialChanges / frames);
+}
+
+// Texture size and startup cost, for the benchmark JSON
+void writeTextureReport(FILE* out) {
+    fprintf(out, "  \"textures\": {\"size\": %d, \"kernel\": \"%s\", \"generate_ms\": %.2f, \"upload_ms\": %.2f}",
+            textureSize, textureRowKernelName(), textureGenerateMs, textureUploadMs);
+}
+
+// Time to the first frame and to the first frame with everything loaded
+void writeStartupReport(FILE* out) {
+    fprintf(out, "  \"startup\": {\"first_frame_ms\": %.2f, \"fully_loaded_ms\": %.2f, \"loading_frames\": %d}",
+            firstFrameMs, fullyLoadedMs, loadingFrames);
+}
+
+// Whether the assets came from the cache and what loading or building them cost
+void writeAssetCacheReport(FILE* out) {
+    fprintf(out, "  \"asset_cache\": {\"enabled\": %s, \"hit\": %s, \"texture_hit\": %s, \"bytes\": %zu, "
+            "\"build_ms\": %.2f, \"write_ms\": %.2f}",
+            assetCachePath.empty() ? "false" : "true", assetCacheHit ? "true" : "false",
+            assetCacheTextureHit ? "true" : "false", assetCacheBytes, assetBuildMs, assetWriteMs);
+}
+
+// Mean CPU and GPU time per profiled section, for the benchmark JSON; null
+// unless the run was profiled
+void writeProfileReport(FILE* out) {
+    frameProfiler().flush();
+    if (frameProfiler().framesCompleted() == 0) fprintf(out, "  \"profile\": null");
+    else frameProfiler().writeReport(out);
+}
+
+// Mean draw calls, vertices and state changes per frame and per section
+void writeDrawCounterReport(FILE* out) {
+    drawCounters().writeReport(out);
+}
+
+// Zeroes the totals the benchmark report averages, so only timed frames count
+void resetBenchCounters() {
+    for (CullCounter& counter : cullCounters) counter.resetTotals();
+    for (LodCounter& counter : lodCounters) counter.resetTotals();
+    totalTriangles = 0;
+    farField.bakesCompleted = farField.panelsBaked = 0;
+    impostorBakeTriangles = 0;
+    totalMeshClouds = totalSpriteClouds = 0;
+    sceneQueue.totals = RenderQueueStats();
+    glState().resetTotals();
+    drawCounters().resetTotals();
+}
+
+void writeBenchReport(FILE* out) {
+    writeCullReport(out);
+    fprintf(out, ",\n");
+    writeLodReport(out);
+    fprintf(out, ",\n");
+    writeImpostorReport(out);
+    fprintf(out, ",\n");
+    writeCloudReport(out);
+    fprintf(out, ",\n");
+    writeRenderQueueReport(out);
+    fprintf(out, ",\n");
+    glStateWriteReport(out);
+    fprintf(out, ",\n");
+    writeTextureReport(out);
+    fprintf(out, ",\n");
+    writeAssetCacheReport(out);
+    fprintf(out, ",\n");
+    writeStartupReport(out);
+    fprintf(out, ",\n");
+    writeProfileReport(out);
+    fprintf(out, ",\n");
+    writeDrawCounterReport(out);
 }
 
 void keyboardInput(unsigned char key, int x, int y) {
@@ -1112,7 +2226,16 @@ void keyboardInput(unsigned char key, int x, int y) {
         topDownView = !topDownView;
         cout << "Top-down view: " << (topDownView ? "ON" : "OFF") << endl;
     }
-    else if (key == 27) exit(0);
+    else if (key == 'c' || key == 'C') printCullStats();
+    else if (key == 'b' || key == 'B') {
+        cloudSprites = !cloudSprites;
+        cout << "Distant clouds as sprites: " << (cloudSprites ? "ON" : "OFF") << endl;
+    }
+    else if (key == 'p' || key == 'P') {
+        profilerHud = !profilerHud;
+        frameProfiler().setActive(profilerHud || profileFromStart || !profileCsvPath.empty());
+    }
+    else if (key == 27) quitScene();
     
     if (manPositionX < -800.0f) manPositionX = -800.0f;
     if (manPositionX > 800.0f) manPositionX = 800.0f;
@@ -1189,12 +2312,45 @@ void mouseMove(int x, int y) {
 }
 
 int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_MULTISAMPLE);
-    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-    glutCreateWindow("Enhanced Realistic 3D Autumn Scene - with Mountains");
+    traceParseArgs(argc, argv, "man_in_autum");
+    benchParseArgs(argc, argv);
+    sceneRngParseArgs(argc, argv, benchEnabled() ? SCENE_BENCH_SEED : (uint64_t)time(0));
+    cloudParseArgs(argc, argv, cloudCount, cloudSprites);
+    textureParseArgs(argc, argv, textureSize);
+    assetCacheParseArgs(argc, argv, assetCachePath);
+    profilerParseArgs(argc, argv, profileCsvPath, profileFromStart);
+    if (!benchCreateHeadlessContext(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH | GLUT_MULTISAMPLE);
+        glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+        glutCreateWindow(WINDOW_TITLE);
+    }
     
+    frameProfiler().init(PROFILE_SECTIONS, PROFILE_SECTION_COUNT);
     initialize();
+    buildSimulationGraph();
+    if (!profileCsvPath.empty() && !frameProfiler().openCsv(profileCsvPath.c_str())) {
+        cerr << "profile: cannot open " << profileCsvPath << " for writing" << endl;
+        profileCsvPath.clear();
+    }
+    // Benchmarks only time sections when asked: GPU queries change the frame
+    // times they measure. Draw counts cost nothing worth measuring.
+    frameProfiler().setActive(profileFromStart || !profileCsvPath.empty());
+    if (benchEnabled()) drawCounters().setEnabled(true);
+
+    if (benchEnabled()) {
+        reshape(WINDOW_WIDTH, WINDOW_HEIGHT);
+        // Startup frames until the loader is done, so every timed frame sees the whole scene
+        while (!fullyLoaded) {
+            drawScene();
+            if (benchOptions().headless) benchFinishFrame();
+            else glutSwapBuffers();
+        }
+        resetBenchCounters(); // Loading frames are never part of the averages
+        benchReportWriter() = writeBenchReport;
+        benchResetHook() = resetBenchCounters;
+        return benchRun("man_in_autum", stepScene, drawScene, glutSwapBuffers);
+    }
     
     glutDisplayFunc(renderScene);
     glutReshapeFunc(reshape);
@@ -1202,7 +2358,7 @@ int main(int argc, char** argv) {
     glutSpecialFunc(specialKeyInput);
     glutMouseFunc(mouseInput);
     glutMotionFunc(mouseMove);
-    glutTimerFunc(16, updateScene, 0);
+    glutIdleFunc(idleScene);
     
     cout << "=== ENHANCED REALISTIC AUTUMN SCENE - WITH MOUNTAINS ===" << endl;
     cout << "\n--- CONTROLS ---" << endl;
@@ -1210,7 +2366,12 @@ int main(int argc, char** argv) {
     cout << "Zoom: Up/Down Arrow Keys or Right Click + Drag" << endl;
     cout << "Rotate Camera: Left Click + Drag" << endl;
     cout << "Toggle Top-Down View: V key" << endl;
+    cout << "Print Frustum Culling Stats: C key" << endl;
+    cout << "Toggle Sprite Clouds in the Distance: B key" << endl;
+    cout << "Toggle Frame Profiler HUD: P key (--profile-csv <file> logs every frame, --profile profiles benchmarks)" << endl;
+    cout << "Timeline: --trace <file> (written at exit, on SIGUSR1 and on Ctrl-C)" << endl;
     cout << "ESC: Exit" << endl;
+    cout << "Scene seed: " << sceneSeed() << " (replay with --seed)" << endl;
     cout << "\n--- NEW IMPROVEMENTS ---" << endl;
     cout << "? Sun positioned MUCH HIGHER in the sky" << endl;
     cout << "? 24 surrounding MOUNTAINS creating a valley" << endl;
@@ -1220,7 +2381,7 @@ int main(int argc, char** argv) {
     cout << "? Higher resolution textures (512x512)" << endl;
     cout << "? Enhanced sky gradient system" << endl;
     cout << "? Improved sun with multiple glow layers" << endl;
-    cout << "? More detailed clouds (35 total)" << endl;
+    cout << "? More detailed clouds (" << cloudCount << " total, --clouds <n>)" << endl;
     cout << "? Higher polygon count on all 3D objects" << endl;
     cout << "? Better lighting and fog system" << endl;
     cout << "? 500 falling leaves with physics" << endl;
@@ -13,6 +13,13 @@
 #include <GL/glut.h>
 #endif
 
+#include "gl_state.h"
+#include "mesh_cache.h"
+#include "leaf_sim.h"
+#include "scene_rng.h"
+#include "scene_bench.h"
+#include "sim_clock.h"
+
 using namespace std;
 
 #ifndef M_PI
@@ -22,6 +29,7 @@ using namespace std;
 // --- Global Constants ---
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
+const char* const WINDOW_TITLE = "Enhanced 3D Autumn Scene - Realistic Walk & Zoom";
 const int NUM_LEAVES = 150; 
 
 // --- Camera & Interaction Globals ---
@@ -44,55 +52,76 @@ float jacketColor[3] = {0.8f, 0.2f, 0.0f};
 float walkPhase = 0.0f; // Controls the man's gait cycle for walking animation
 bool isManMoving = false; // Tracks if the man is actively moving
 
-// --- Leaf Structure (3D) ---
-struct Leaf {
-    float x, y, z;
-    float color[3];
-    float size;
-    float fallSpeed;
+// --- Leaves (3D) ---
+LeafStore fallingLeaves; // Structure-of-arrays, stepped by the SIMD leaf kernel
+const LeafSpawnRange LEAF_SPAWN = { -200.0f, 200.0f, -200.0f, 200.0f, 500.0f, 100.0f, 0.5f, 1.5f, false };
+
+// --- Fixed Timestep ---
+// The simulation ticks at a fixed rate from idleScene(); drawScene() blends
+// the previous and current tick by renderAlpha.
+SimClock simClock(60.0);
+float renderAlpha = 1.0f;
+
+// Animated man state drawn with interpolation
+struct SceneSnapshot {
+    float walkPhase;
+    float jacketColor[3];
 };
-vector<Leaf> fallingLeaves;
+SceneSnapshot previousSnapshot; // Taken at the start of the latest tick
+SceneSnapshot renderSnapshot;   // What the current frame draws
+
+SceneSnapshot captureSnapshot() {
+    SceneSnapshot snapshot = { walkPhase, { jacketColor[0], jacketColor[1], jacketColor[2] } };
+    return snapshot;
+}
+
+SceneSnapshot blendSnapshots(const SceneSnapshot& a, const SceneSnapshot& b, float t) {
+    SceneSnapshot out;
+    out.walkPhase = simLerpWrapped(a.walkPhase, b.walkPhase, t, 2.0f * M_PI);
+    for (int i = 0; i < 3; ++i) out.jacketColor[i] = simLerp(a.jacketColor[i], b.jacketColor[i], t);
+    return out;
+}
 
 // --- Utility Functions ---
 
 void setMaterialColor(float r, float g, float b) {
     GLfloat ambient[] = { r * 0.2f, g * 0.2f, b * 0.2f, 1.0f };
     GLfloat diffuse[] = { r, g, b, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT, ambient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse);
-    glColor3f(r, g, b);
+    GlStateCache& state = glState();
+    state.material(GL_FRONT, GL_AMBIENT, ambient);
+    state.material(GL_FRONT, GL_DIFFUSE, diffuse);
+    state.color3f(r, g, b);
 }
 
 /**
- * Draws a solid cylinder using GLU primitives, height is along the Z-axis.
+ * Draws a solid cylinder from the primitive mesh cache, height is along the Z-axis.
  */
 void drawCylinder(float baseRadius, float topRadius, float height) {
-    GLUquadricObj *quadric = gluNewQuadric();
-    gluQuadricNormals(quadric, GLU_SMOOTH);
-    gluCylinder(quadric, baseRadius, topRadius, height, 16, 1);
-    gluDeleteQuadric(quadric);
+    drawSolidCylinder(baseRadius, topRadius, height, 16, 1);
 }
 
 void initializeLeaves() {
-    srand(time(0));
+    const uint64_t seed = sceneSeed();
     fallingLeaves.clear();
+    fallingLeaves.seed = (uint32_t)sceneRngKey(seed, RNG_LEAF_RESPAWN, 0);
 
     for (int i = 0; i < NUM_LEAVES; ++i) {
-        Leaf l;
-        l.x = (rand() % 400) - 200.0f;
-        l.y = (rand() % 300) + 200.0f;
-        l.z = (rand() % 400) - 200.0f;
+        SceneRng rng = sceneRng(seed, RNG_LEAF, i);
+        float x = rng.range(-200.0f, 200.0f);
+        float y = rng.range(200.0f, 500.0f);
+        float z = rng.range(-200.0f, 200.0f);
 
         // Random autumn colors
-        float r = static_cast <float> (rand()) / RAND_MAX;
-        if (r < 0.25f) { l.color[0] = 0.8f; l.color[1] = 0.2f; l.color[2] = 0.0f; } // Red
-        else if (r < 0.50f) { l.color[0] = 1.0f; l.color[1] = 0.5f; l.color[2] = 0.0f; } // Orange
-        else if (r < 0.75f) { l.color[0] = 1.0f; l.color[1] = 1.0f; l.color[2] = 0.0f; } // Yellow
-        else { l.color[0] = 0.5f; l.color[1] = 0.3f; l.color[2] = 0.1f; } // Brown
-
-        l.size = 1.5f + (static_cast <float> (rand() % 100) / 100.0f) * 1.5f;
-        l.fallSpeed = 0.5f + (static_cast <float> (rand() % 100) / 100.0f) * 1.5f;
-        fallingLeaves.push_back(l);
+        float color[3];
+        float r = rng.uniform();
+        if (r < 0.25f) { color[0] = 0.8f; color[1] = 0.2f; color[2] = 0.0f; } // Red
+        else if (r < 0.50f) { color[0] = 1.0f; color[1] = 0.5f; color[2] = 0.0f; } // Orange
+        else if (r < 0.75f) { color[0] = 1.0f; color[1] = 1.0f; color[2] = 0.0f; } // Yellow
+        else { color[0] = 0.5f; color[1] = 0.3f; color[2] = 0.1f; } // Brown
+
+        float size = rng.range(1.5f, 3.0f);
+        float fallSpeed = rng.range(0.5f, 2.0f);
+        fallingLeaves.add(x, y, z, color, size, fallSpeed);
     }
 }
 
@@ -126,11 +155,12 @@ void draw3DMan(float x, float y, float z) {
     setMaterialColor(1.0f, 0.8f, 0.7f);
     glPushMatrix();
     glTranslatef(0.0f, TORSO_HEIGHT + LEG_LENGTH + 10.0f, 0.0f);
-    glutSolidSphere(10.0f, 16, 16);
+    drawSolidSphere(10.0f, 16, 16);
     glPopMatrix();
 
     // Torso (Jacket)
-    setMaterialColor(jacketColor[0], jacketColor[1], jacketColor[2]);
+    const float* jacket = renderSnapshot.jacketColor;
+    setMaterialColor(jacket[0], jacket[1], jacket[2]);
     glPushMatrix();
     glTranslatef(0.0f, LEG_LENGTH, 0.0f);
     glRotatef(-90.0f, 1.0f, 0.0f, 0.0f); // Orient cylinder vertically
@@ -138,8 +168,8 @@ void draw3DMan(float x, float y, float z) {
     glPopMatrix();
 
     // --- Arms (Animated Walk Cycle) ---
-    float armAngle = 20.0f * sin(walkPhase);
-    setMaterialColor(jacketColor[0] * 0.8f, jacketColor[1] * 0.8f, jacketColor[2] * 0.8f);
+    float armAngle = 20.0f * sin(renderSnapshot.walkPhase);
+    setMaterialColor(jacket[0] * 0.8f, jacket[1] * 0.8f, jacket[2] * 0.8f);
 
     for (int i = -1; i <= 1; i += 2) {
         glPushMatrix();
@@ -156,14 +186,14 @@ void draw3DMan(float x, float y, float z) {
         // Hand (small sphere)
         glPushMatrix();
         glTranslatef(0.0f, 0.0f, ARM_LENGTH);
-        glutSolidSphere(LIMB_RADIUS * 0.8f, 10, 10);
+        drawSolidSphere(LIMB_RADIUS * 0.8f, 10, 10);
         glPopMatrix();
         
         glPopMatrix();
     }
 
     // --- Legs (Animated Walk Cycle) ---
-    float legAngle = 30.0f * sin(walkPhase);
+    float legAngle = 30.0f * sin(renderSnapshot.walkPhase);
     setMaterialColor(0.1f, 0.1f, 0.5f); // Pants/Denim
 
     for (int i = -1; i <= 1; i += 2) {
@@ -200,12 +230,12 @@ void draw3DTree(float x, float z) {
     
     // Bottom cone (Darker orange)
     setMaterialColor(0.8f, 0.4f, 0.0f);
-    glutSolidCone(60.0f, 70.0f, 16, 16);
+    drawSolidCone(60.0f, 70.0f, 16, 16);
     
     // Top cone (Lighter orange/yellow)
     glTranslatef(0.0f, 35.0f, 0.0f);
     setMaterialColor(0.9f, 0.6f, 0.1f);
-    glutSolidCone(70.0f, 70.0f, 16, 16);
+    drawSolidCone(70.0f, 70.0f, 16, 16);
 
     glPopMatrix();
     glPopMatrix();
@@ -213,26 +243,29 @@ void draw3DTree(float x, float z) {
 
 void draw3DLeaves() {
     // Enable blending for transparent effect of flat quads
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GlStateCache& state = glState();
+    state.enable(GL_BLEND);
+    state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     glBegin(GL_QUADS);
-    for (const auto& leaf : fallingLeaves) {
-        setMaterialColor(leaf.color[0], leaf.color[1], leaf.color[2]);
+    const LeafStore& leaves = fallingLeaves;
+    for (size_t i = 0; i < leaves.count(); ++i) {
+        setMaterialColor(leaves.r[i], leaves.g[i], leaves.b[i]);
 
-        // Calculate wind offset and subtle sway for realism
-        float currentX = leaf.x + 20.0f * sin(leafDriftSpeed + leaf.z * 0.1f);
-        float currentY = leaf.y + 5.0f * cos(leafDriftSpeed * 2.0f + leaf.x * 0.1f);
+        // Wind offset and sway were applied by the leaf kernel in stepScene()
+        float x, y, z, rotation;
+        leafSimInterpolate(leaves, i, renderAlpha, x, y, z, rotation);
+        float size = leaves.size[i];
 
         // Draw flat quads (simple billboard effect)
-        glVertex3f(currentX, currentY, leaf.z);
-        glVertex3f(currentX + leaf.size, currentY, leaf.z);
-        glVertex3f(currentX + leaf.size, currentY + leaf.size, leaf.z);
-        glVertex3f(currentX, currentY + leaf.size, leaf.z);
+        glVertex3f(x, y, z);
+        glVertex3f(x + size, y, z);
+        glVertex3f(x + size, y + size, z);
+        glVertex3f(x, y + size, z);
     }
     glEnd();
     
-    glDisable(GL_BLEND);
+    state.disable(GL_BLEND);
 }
 
 // --- OpenGL Setup and Callbacks ---
@@ -248,6 +281,7 @@ void reshape(int w, int h) {
 void initialize() {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
+    glEnable(GL_NORMALIZE); // Cached meshes are scaled by the modelview matrix
     glClearColor(0.8f, 0.9f, 0.95f, 1.0f); // Autumn Sky
 
     // Lighting Setup
@@ -272,9 +306,13 @@ void initialize() {
 
     glShadeModel(GL_SMOOTH);
     initializeLeaves();
+    previousSnapshot = captureSnapshot();
 }
 
-void renderScene() {
+void drawScene() {
+    renderSnapshot = blendSnapshots(previousSnapshot, captureSnapshot(), renderAlpha);
+    glState().beginFrame();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
@@ -296,27 +334,32 @@ void renderScene() {
     draw3DTree(50.0f, 200.0f); 
     draw3DMan(manPositionX, 0.0f, manPositionZ); // Man uses X and Z positions
     draw3DLeaves();
+}
 
+void renderScene() {
+    drawScene();
     glutSwapBuffers();
-}
 
-// --- Animation & Timer Function ---
-
-void updateScene(int value) {
-    // 1. Update leaf positions
-    for (auto& leaf : fallingLeaves) {
-        leaf.y -= leaf.fallSpeed;
-        if (leaf.y < 0) {
-            leaf.y = 500.0f + (rand() % 100);
-            leaf.x = (rand() % 400) - 200.0f;
-            leaf.z = (rand() % 400) - 200.0f;
-            leaf.fallSpeed = 0.5f + (static_cast <float> (rand() % 100) / 100.0f) * 1.5f;
-        }
+    if (simClock.frameRendered()) {
+        char title[160];
+        simClock.formatTitle(title, sizeof(title), WINDOW_TITLE);
+        glutSetWindowTitle(title);
     }
+}
+
+// --- Animation & Fixed Timestep ---
 
-    // 2. Update horizontal wind/drift
+// One fixed simulation tick
+void stepScene() {
+    previousSnapshot = captureSnapshot();
+
+    // 1. Update horizontal wind/drift
     leafDriftSpeed += 0.02f;
 
+    // 2. Update leaf positions and sway (SIMD kernel, respawns leaves that land)
+    LeafSimParams leafParams = { leafDriftSpeed, 20.0f, 5.0f, 0.0f, 0.0f };
+    leafSimStep(fallingLeaves, leafParams, LEAF_SPAWN);
+
     // 3. Update Man's Walk Cycle and Jacket Color
     if (isManMoving) {
         walkPhase = fmod(walkPhase + 0.3f, 2.0f * M_PI); // Increase walk phase if moving
@@ -335,9 +378,16 @@ void updateScene(int value) {
     if (hue < 0.333f) { jacketColor[0] = 1.0f; jacketColor[1] = hue * 3.0f; jacketColor[2] = 0.0f; }
     else if (hue < 0.666f) { jacketColor[0] = 1.0f - (hue - 0.333f) * 3.0f; jacketColor[1] = 1.0f; jacketColor[2] = (hue - 0.333f) * 3.0f; }
     else { jacketColor[0] = (hue - 0.666f) * 3.0f; jacketColor[1] = 1.0f - (hue - 0.666f) * 3.0f; jacketColor[2] = 1.0f; }
+}
 
+// Runs whatever simulation ticks are due, then asks for a new frame right away
+void idleScene() {
+    int steps = simClock.advance();
+    for (int i = 0; i < steps; ++i) {
+        stepScene();
+    }
+    renderAlpha = simClock.alpha();
     glutPostRedisplay();
-    glutTimerFunc(16, updateScene, 0); // ~60 FPS
 }
 
 // --- Input Handlers (WASD) ---
@@ -350,6 +400,10 @@ void keyboardInput(unsigned char key, int x, int y) {
     else if (key == 'd' || key == 'D') { manPositionX += move_step; isManMoving = true; } 
     else if (key == 'w' || key == 'W') { manPositionZ -= move_step; isManMoving = true; } // Move forward
     else if (key == 's' || key == 'S') { manPositionZ += move_step; isManMoving = true; } // Move backward
+    else if (key == 'c' || key == 'C') {
+        cout << "--- GL state calls (last frame) ---" << endl;
+        glStatePrintFrame(cout);
+    }
     
     // Boundary checks (optional, keeps man within a reasonable range)
     if (manPositionX < -300.0f) manPositionX = -300.0f;
@@ -427,12 +481,22 @@ void mouseMove(int x, int y) {
 // --- Main Function ---
 
 int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-    glutCreateWindow("Enhanced 3D Autumn Scene - Realistic Walk & Zoom");
+    benchParseArgs(argc, argv);
+    sceneRngParseArgs(argc, argv, benchEnabled() ? SCENE_BENCH_SEED : (uint64_t)time(0));
+    if (!benchCreateHeadlessContext(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+        glutCreateWindow(WINDOW_TITLE);
+    }
     
     initialize();
+
+    if (benchEnabled()) {
+        reshape(WINDOW_WIDTH, WINDOW_HEIGHT);
+        benchReportWriter() = glStateWriteReport;
+        return benchRun("man_in_autumn_3d", stepScene, drawScene, glutSwapBuffers);
+    }
     
     glutDisplayFunc(renderScene);
     glutReshapeFunc(reshape);
@@ -443,13 +507,14 @@ int main(int argc, char** argv) {
     glutMouseFunc(mouseInput);
     glutMotionFunc(mouseMove);
     
-    glutTimerFunc(16, updateScene, 0);
+    glutIdleFunc(idleScene); // 60 Hz simulation, uncapped rendering
     
     cout << "--- Enhanced 3D Autumn Scene Controls ---" << endl;
     cout << "Movement: WASD or Left/Right Arrow Keys" << endl;
     cout << "Zoom: Up/Down Arrow Keys or Right Click + Drag Vertically" << endl;
     cout << "Rotate: Left Click + Drag Horizontally" << endl;
     cout << "Features: Realistic Man Walking Animation, Fog, Dynamic Colors" << endl;
+    cout << "Scene seed: " << sceneSeed() << " (replay with --seed)" << endl;
 
     glutMainLoop();
     return 0;
@@ -0,0 +1,496 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+// --- Primitive Mesh Cache ---
+// Replacement for gluCylinder/gluDisk and glutSolidSphere/Cone/Torus/Cube.
+// Each primitive is tessellated once per (shape, slices, stacks, shape
+// parameter) at unit size, compiled into a display list and afterwards drawn
+// with a scale transform. Orientation, winding and texture coordinates follow
+// the GLU/GLUT originals, so the draw*() helpers are drop-in replacements.
+//
+// Meshes are scaled by the modelview matrix, so scenes using these helpers
+// must glEnable(GL_NORMALIZE) to keep lighting correct.
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "draw_counters.h"
+
+struct Mesh {
+    std::vector<float> positions;      // xyz
+    std::vector<float> normals;        // xyz
+    std::vector<float> texCoords;      // st, empty if the mesh is untextured
+    std::vector<float> colors;         // rgb, empty if the mesh uses the current color
+    std::vector<unsigned int> indices; // GL_TRIANGLES
+    GLuint displayList = 0;
+    size_t triangleCount = 0;          // Kept when the display list is compiled
+    bool primitive = false;            // Built by getPrimitiveMesh()
+
+    size_t vertexCount() const { return positions.size() / 3; }
+
+    unsigned int addVertex(float x, float y, float z, float nx, float ny, float nz) {
+        positions.push_back(x); positions.push_back(y); positions.push_back(z);
+        normals.push_back(nx); normals.push_back(ny); normals.push_back(nz);
+        return (unsigned int)(vertexCount() - 1);
+    }
+
+    void addTriangle(unsigned int a, unsigned int b, unsigned int c) {
+        indices.push_back(a); indices.push_back(b); indices.push_back(c);
+    }
+};
+
+// --- Tessellation ---
+
+const float MESH_PI = 3.14159265358979323846f;
+
+// Unit sphere around the z axis, like glutSolidSphere(1, slices, stacks)
+inline void buildSphereMesh(Mesh& mesh, int slices, int stacks) {
+    for (int j = 0; j <= stacks; ++j) {
+        float phi = MESH_PI * j / stacks;
+        for (int i = 0; i <= slices; ++i) {
+            float theta = 2.0f * MESH_PI * i / slices;
+            float x = sinf(phi) * cosf(theta);
+            float y = sinf(phi) * sinf(theta);
+            float z = cosf(phi);
+            mesh.addVertex(x, y, z, x, y, z);
+            mesh.texCoords.push_back((float)i / slices);
+            mesh.texCoords.push_back(1.0f - (float)j / stacks);
+        }
+    }
+    for (int j = 0; j < stacks; ++j) {
+        for (int i = 0; i < slices; ++i) {
+            unsigned int a = j * (slices + 1) + i;
+            unsigned int b = a + slices + 1;
+            mesh.addTriangle(a, b, a + 1);
+            mesh.addTriangle(a + 1, b, b + 1);
+        }
+    }
+}
+
+// Open tube from radius 1 at z = 0 to radius topRatio at z = 1, like gluCylinder
+inline void buildCylinderMesh(Mesh& mesh, int slices, int stacks, float topRatio) {
+    float slope = 1.0f - topRatio;
+    float nLen = sqrtf(1.0f + slope * slope);
+    for (int j = 0; j <= stacks; ++j) {
+        float t = (float)j / stacks;
+        float r = 1.0f + (topRatio - 1.0f) * t;
+        for (int i = 0; i <= slices; ++i) {
+            float theta = 2.0f * MESH_PI * i / slices;
+            float c = cosf(theta), s = sinf(theta);
+            mesh.addVertex(r * c, r * s, t, c / nLen, s / nLen, slope / nLen);
+            mesh.texCoords.push_back((float)i / slices);
+            mesh.texCoords.push_back(t);
+        }
+    }
+    for (int j = 0; j < stacks; ++j) {
+        for (int i = 0; i < slices; ++i) {
+            unsigned int a = j * (slices + 1) + i;
+            unsigned int b = a + slices + 1;
+            mesh.addTriangle(a, a + 1, b);
+            mesh.addTriangle(a + 1, b + 1, b);
+        }
+    }
+}
+
+// Unit cone with its base on z = 0 and apex at z = 1, like glutSolidCone(1, 1, slices, stacks)
+inline void buildConeMesh(Mesh& mesh, int slices, int stacks) {
+    buildCylinderMesh(mesh, slices, stacks, 0.0f);
+
+    unsigned int center = mesh.addVertex(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f);
+    mesh.texCoords.push_back(0.5f); mesh.texCoords.push_back(0.5f);
+    for (int i = 0; i <= slices; ++i) {
+        float theta = 2.0f * MESH_PI * i / slices;
+        float c = cosf(theta), s = sinf(theta);
+        mesh.addVertex(c, s, 0.0f, 0.0f, 0.0f, -1.0f);
+        mesh.texCoords.push_back(0.5f + 0.5f * c); mesh.texCoords.push_back(0.5f + 0.5f * s);
+    }
+    for (int i = 0; i < slices; ++i) {
+        mesh.addTriangle(center, center + 2 + i, center + 1 + i);
+    }
+}
+
+// Disk of radius 1 in the xy plane facing +z, like gluDisk(q, 0, 1, slices, 1)
+inline void buildDiskMesh(Mesh& mesh, int slices) {
+    unsigned int center = mesh.addVertex(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    mesh.texCoords.push_back(0.5f); mesh.texCoords.push_back(0.5f);
+    for (int i = 0; i <= slices; ++i) {
+        float theta = 2.0f * MESH_PI * i / slices;
+        float c = cosf(theta), s = sinf(theta);
+        mesh.addVertex(c, s, 0.0f, 0.0f, 0.0f, 1.0f);
+        mesh.texCoords.push_back(0.5f + 0.5f * c); mesh.texCoords.push_back(0.5f + 0.5f * s);
+    }
+    for (int i = 0; i < slices; ++i) {
+        mesh.addTriangle(center, center + 1 + i, center + 2 + i);
+    }
+}
+
+// Torus in the xy plane with ring radius 1 and tube radius tubeRatio,
+// like glutSolidTorus(tubeRatio, 1, sides, rings)
+inline void buildTorusMesh(Mesh& mesh, int sides, int rings, float tubeRatio) {
+    for (int j = 0; j <= sides; ++j) {
+        float phi = 2.0f * MESH_PI * j / sides;
+        float cp = cosf(phi), sp = sinf(phi);
+        for (int i = 0; i <= rings; ++i) {
+            float theta = 2.0f * MESH_PI * i / rings;
+            float ct = cosf(theta), st = sinf(theta);
+            float r = 1.0f + tubeRatio * cp;
+            mesh.addVertex(r * ct, r * st, tubeRatio * sp, cp * ct, cp * st, sp);
+            mesh.texCoords.push_back((float)i / rings);
+            mesh.texCoords.push_back((float)j / sides);
+        }
+    }
+    for (int j = 0; j < sides; ++j) {
+        for (int i = 0; i < rings; ++i) {
+            unsigned int a = j * (rings + 1) + i;
+            unsigned int b = a + rings + 1;
+            mesh.addTriangle(a, a + 1, b);
+            mesh.addTriangle(a + 1, b + 1, b);
+        }
+    }
+}
+
+// Unit cube centered on the origin, like glutSolidCube(1)
+inline void buildCubeMesh(Mesh& mesh) {
+    // Face normal, then the two in-plane axes with u x v = normal
+    static const float faces[6][9] = {
+        { 1, 0, 0,   0, 1, 0,   0, 0, 1 },
+        {-1, 0, 0,   0, 0, 1,   0, 1, 0 },
+        { 0, 1, 0,   0, 0, 1,   1, 0, 0 },
+        { 0,-1, 0,   1, 0, 0,   0, 0, 1 },
+        { 0, 0, 1,   1, 0, 0,   0, 1, 0 },
+        { 0, 0,-1,   0, 1, 0,   1, 0, 0 },
+    };
+    static const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+
+    for (int f = 0; f < 6; ++f) {
+        const float* n = faces[f];
+        const float* u = faces[f] + 3;
+        const float* v = faces[f] + 6;
+        unsigned int first = (unsigned int)mesh.vertexCount();
+        for (int c = 0; c < 4; ++c) {
+            float cu = corners[c][0] * 0.5f, cv = corners[c][1] * 0.5f;
+            mesh.addVertex(n[0] * 0.5f + u[0] * cu + v[0] * cv,
+                           n[1] * 0.5f + u[1] * cu + v[1] * cv,
+                           n[2] * 0.5f + u[2] * cu + v[2] * cv,
+                           n[0], n[1], n[2]);
+            mesh.texCoords.push_back(corners[c][0] * 0.5f + 0.5f);
+            mesh.texCoords.push_back(corners[c][1] * 0.5f + 0.5f);
+        }
+        mesh.addTriangle(first, first + 1, first + 2);
+        mesh.addTriangle(first, first + 2, first + 3);
+    }
+}
+
+// --- Mesh Building ---
+
+// Column-major 4x4 matrix with the same conventions as glTranslatef/glRotatef/glScalef
+struct Mat4 {
+    float m[16];
+
+    static Mat4 identity() {
+        Mat4 r;
+        for (int i = 0; i < 16; ++i) r.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        return r;
+    }
+
+    Mat4 operator*(const Mat4& o) const {
+        Mat4 r;
+        for (int c = 0; c < 4; ++c) {
+            for (int row = 0; row < 4; ++row) {
+                r.m[c * 4 + row] = m[row] * o.m[c * 4] + m[4 + row] * o.m[c * 4 + 1] +
+                                   m[8 + row] * o.m[c * 4 + 2] + m[12 + row] * o.m[c * 4 + 3];
+            }
+        }
+        return r;
+    }
+
+    static Mat4 translation(float x, float y, float z) {
+        Mat4 r = identity();
+        r.m[12] = x; r.m[13] = y; r.m[14] = z;
+        return r;
+    }
+
+    static Mat4 scaling(float x, float y, float z) {
+        Mat4 r = identity();
+        r.m[0] = x; r.m[5] = y; r.m[10] = z;
+        return r;
+    }
+
+    static Mat4 rotation(float angleDegrees, float x, float y, float z) {
+        float len = sqrtf(x * x + y * y + z * z);
+        if (len > 0.0f) { x /= len; y /= len; z /= len; }
+        float a = angleDegrees * MESH_PI / 180.0f;
+        float c = cosf(a), s = sinf(a), t = 1.0f - c;
+        Mat4 r = identity();
+        r.m[0] = t * x * x + c;     r.m[4] = t * x * y - s * z; r.m[8] = t * x * z + s * y;
+        r.m[1] = t * x * y + s * z; r.m[5] = t * y * y + c;     r.m[9] = t * y * z - s * x;
+        r.m[2] = t * x * z - s * y; r.m[6] = t * y * z + s * x; r.m[10] = t * z * z + c;
+        return r;
+    }
+
+    void transformPoint(const float* p, float* out) const {
+        for (int i = 0; i < 3; ++i) {
+            out[i] = m[i] * p[0] + m[4 + i] * p[1] + m[8 + i] * p[2] + m[12 + i];
+        }
+    }
+
+    // Normals go through the inverse transpose; the cofactor matrix is that up to scale
+    void transformNormal(const float* n, float* out) const {
+        float a = m[0], b = m[4], c = m[8];
+        float d = m[1], e = m[5], f = m[9];
+        float g = m[2], h = m[6], k = m[10];
+        float det = a * (e * k - f * h) - b * (d * k - f * g) + c * (d * h - e * g);
+        float sign = det < 0.0f ? -1.0f : 1.0f;
+        out[0] = sign * ((e * k - f * h) * n[0] - (d * k - f * g) * n[1] + (d * h - e * g) * n[2]);
+        out[1] = sign * (-(b * k - c * h) * n[0] + (a * k - c * g) * n[1] - (a * h - b * g) * n[2]);
+        out[2] = sign * ((b * f - c * e) * n[0] - (a * f - c * d) * n[1] + (a * e - b * d) * n[2]);
+        float len = sqrtf(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+        if (len > 0.0f) { out[0] /= len; out[1] /= len; out[2] /= len; }
+    }
+};
+
+// Records geometry into a colored Mesh using the same push/transform/color
+// calls as immediate mode, so draw code can be turned into bake code line by line.
+struct MeshBuilder {
+    Mesh& mesh;
+    bool texCoords;
+    Mat4 current;
+    std::vector<Mat4> stack;
+    float color[3];
+
+    explicit MeshBuilder(Mesh& target, bool withTexCoords = false)
+        : mesh(target), texCoords(withTexCoords), current(Mat4::identity()) {
+        color[0] = color[1] = color[2] = 1.0f;
+    }
+
+    void pushMatrix() { stack.push_back(current); }
+    void popMatrix() { current = stack.back(); stack.pop_back(); }
+    void loadMatrix(const Mat4& m) { current = m; }
+    void translate(float x, float y, float z) { current = current * Mat4::translation(x, y, z); }
+    void rotate(float angle, float x, float y, float z) { current = current * Mat4::rotation(angle, x, y, z); }
+    void scale(float x, float y, float z) { current = current * Mat4::scaling(x, y, z); }
+    void setColor(float r, float g, float b) { color[0] = r; color[1] = g; color[2] = b; }
+
+    // Adds one vertex in local coordinates with the current transform and color
+    unsigned int vertex(float x, float y, float z, float nx, float ny, float nz, float s = 0.0f, float t = 0.0f) {
+        float p[3] = { x, y, z }, n[3] = { nx, ny, nz }, wp[3], wn[3];
+        current.transformPoint(p, wp);
+        current.transformNormal(n, wn);
+        unsigned int index = mesh.addVertex(wp[0], wp[1], wp[2], wn[0], wn[1], wn[2]);
+        mesh.colors.push_back(color[0]); mesh.colors.push_back(color[1]); mesh.colors.push_back(color[2]);
+        if (texCoords) { mesh.texCoords.push_back(s); mesh.texCoords.push_back(t); }
+        return index;
+    }
+
+    void triangle(unsigned int a, unsigned int b, unsigned int c) { mesh.addTriangle(a, b, c); }
+
+    // Appends a whole mesh; its vertex colors (if any) are modulated by the current color
+    void addMesh(const Mesh& src) {
+        unsigned int base = (unsigned int)mesh.vertexCount();
+        size_t count = src.vertexCount();
+        bool srcColors = !src.colors.empty();
+        bool srcTex = !src.texCoords.empty();
+        for (size_t v = 0; v < count; ++v) {
+            float wp[3], wn[3];
+            current.transformPoint(&src.positions[v * 3], wp);
+            current.transformNormal(&src.normals[v * 3], wn);
+            mesh.addVertex(wp[0], wp[1], wp[2], wn[0], wn[1], wn[2]);
+            for (int i = 0; i < 3; ++i) {
+                mesh.colors.push_back(srcColors ? src.colors[v * 3 + i] * color[i] : color[i]);
+            }
+            if (texCoords) {
+                mesh.texCoords.push_back(srcTex ? src.texCoords[v * 2] : 0.0f);
+                mesh.texCoords.push_back(srcTex ? src.texCoords[v * 2 + 1] : 0.0f);
+            }
+        }
+        for (unsigned int index : src.indices) mesh.indices.push_back(base + index);
+    }
+};
+
+// --- Drawing ---
+
+// Drops a compiled display list so the next drawMesh() recompiles the mesh
+inline void releaseMesh(Mesh& mesh) {
+    if (mesh.displayList != 0) {
+        glDeleteLists(mesh.displayList, 1);
+        mesh.displayList = 0;
+    }
+}
+
+// Triangles submitted through drawMesh(); callers reset it as they see fit
+inline long long& meshTrianglesDrawn() {
+    static long long triangles = 0;
+    return triangles;
+}
+
+// Compiles the mesh into a display list unless it already has one
+inline void compileMesh(Mesh& mesh) {
+    if (mesh.displayList == 0) {
+        mesh.triangleCount = mesh.indices.size() / 3;
+        mesh.displayList = glGenLists(1);
+        glNewList(mesh.displayList, GL_COMPILE);
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 0, mesh.positions.data());
+        glNormalPointer(GL_FLOAT, 0, mesh.normals.data());
+        if (!mesh.texCoords.empty()) {
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glTexCoordPointer(2, GL_FLOAT, 0, mesh.texCoords.data());
+        }
+        if (!mesh.colors.empty()) {
+            glEnableClientState(GL_COLOR_ARRAY);
+            glColorPointer(3, GL_FLOAT, 0, mesh.colors.data());
+        }
+
+        glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, mesh.indices.data());
+
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glEndList();
+    }
+}
+
+// Compiles the mesh on first use, then replays its display list.
+// Meshes with vertex colors leave the current color undefined afterwards.
+inline void drawMesh(Mesh& mesh) {
+    compileMesh(mesh);
+    glCallList(mesh.displayList);
+    meshTrianglesDrawn() += (long long)mesh.triangleCount;
+    countDraw(DRAW_CALLS);
+    countDraw(DRAW_VERTICES, (long long)mesh.triangleCount * 3);
+    if (mesh.primitive) countDraw(DRAW_PRIMITIVES);
+}
+
+// --- Dynamic Geometry ---
+
+// Geometry rewritten by the CPU every frame and drawn straight from client
+// memory with one call. The vector keeps its capacity between frames, so
+// steady-state frames neither allocate nor re-specify any GL objects.
+struct DynamicStream {
+    std::vector<float> data; // Interleaved position, normal, color
+
+    static const int FLOATS_PER_VERTEX = 9;
+
+    void clear() { data.clear(); }
+    size_t vertexCount() const { return data.size() / FLOATS_PER_VERTEX; }
+
+    void vertex(float x, float y, float z, float nx, float ny, float nz, float r, float g, float b) {
+        const float v[FLOATS_PER_VERTEX] = { x, y, z, nx, ny, nz, r, g, b };
+        data.insert(data.end(), v, v + FLOATS_PER_VERTEX);
+    }
+
+    // Leaves the current color undefined, like any colored mesh
+    void draw(GLenum mode) const {
+        if (data.empty()) return;
+        const GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(3, GL_FLOAT, stride, data.data());
+        glNormalPointer(GL_FLOAT, stride, data.data() + 3);
+        glColorPointer(3, GL_FLOAT, stride, data.data() + 6);
+        glDrawArrays(mode, 0, (GLsizei)vertexCount());
+        countDraw(DRAW_CALLS);
+        countDraw(DRAW_VERTICES, (long long)vertexCount());
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+};
+
+// --- Cache ---
+
+enum MeshShape { MESH_SPHERE, MESH_CYLINDER, MESH_CONE, MESH_DISK, MESH_TORUS, MESH_CUBE };
+
+// Key packs shape, slices, stacks and the shape parameter quantized to 1/4096
+inline uint64_t meshKey(MeshShape shape, int slices, int stacks, float param) {
+    uint64_t q = (uint64_t)(long long)floorf(param * 4096.0f + 0.5f);
+    return ((uint64_t)shape << 56) | ((uint64_t)(slices & 0xFFF) << 44) |
+           ((uint64_t)(stacks & 0xFFF) << 32) | (q & 0xFFFFFFFFu);
+}
+
+inline std::map<uint64_t, Mesh>& meshCache() {
+    static std::map<uint64_t, Mesh> cache;
+    return cache;
+}
+
+inline Mesh& getPrimitiveMesh(MeshShape shape, int slices, int stacks, float param) {
+    if (slices < 3) slices = 3;
+    if (stacks < 1) stacks = 1;
+    if (shape == MESH_SPHERE && stacks < 2) stacks = 2;
+
+    Mesh& mesh = meshCache()[meshKey(shape, slices, stacks, param)];
+    if (mesh.indices.empty()) {
+        switch (shape) {
+            case MESH_SPHERE:   buildSphereMesh(mesh, slices, stacks); break;
+            case MESH_CYLINDER: buildCylinderMesh(mesh, slices, stacks, param); break;
+            case MESH_CONE:     buildConeMesh(mesh, slices, stacks); break;
+            case MESH_DISK:     buildDiskMesh(mesh, slices); break;
+            case MESH_TORUS:    buildTorusMesh(mesh, slices, stacks, param); break;
+            case MESH_CUBE:     buildCubeMesh(mesh); break;
+        }
+        mesh.primitive = true;
+    }
+    return mesh;
+}
+
+// --- Drop-in Primitive Helpers ---
+
+inline void drawSolidSphere(float radius, int slices, int stacks) {
+    glPushMatrix();
+    countDraw(DRAW_MATRIX_PUSHES);
+    glScalef(radius, radius, radius);
+    drawMesh(getPrimitiveMesh(MESH_SPHERE, slices, stacks, 0.0f));
+    glPopMatrix();
+}
+
+// Along +z from the origin; textured like gluQuadricTexture(q, GL_TRUE)
+inline void drawSolidCylinder(float baseRadius, float topRadius, float height, int slices, int stacks) {
+    float ratio = baseRadius > 0.0f ? topRadius / baseRadius : 1.0f;
+    glPushMatrix();
+    countDraw(DRAW_MATRIX_PUSHES);
+    glScalef(baseRadius, baseRadius, height);
+    drawMesh(getPrimitiveMesh(MESH_CYLINDER, slices, stacks, ratio));
+    glPopMatrix();
+}
+
+inline void drawSolidCone(float base, float height, int slices, int stacks) {
+    glPushMatrix();
+    countDraw(DRAW_MATRIX_PUSHES);
+    glScalef(base, base, height);
+    drawMesh(getPrimitiveMesh(MESH_CONE, slices, stacks, 0.0f));
+    glPopMatrix();
+}
+
+inline void drawSolidDisk(float radius, int slices) {
+    glPushMatrix();
+    countDraw(DRAW_MATRIX_PUSHES);
+    glScalef(radius, radius, 1.0f);
+    drawMesh(getPrimitiveMesh(MESH_DISK, slices, 1, 0.0f));
+    glPopMatrix();
+}
+
+inline void drawSolidTorus(float innerRadius, float outerRadius, int sides, int rings) {
+    glPushMatrix();
+    countDraw(DRAW_MATRIX_PUSHES);
+    glScalef(outerRadius, outerRadius, outerRadius);
+    drawMesh(getPrimitiveMesh(MESH_TORUS, sides, rings, innerRadius / outerRadius));
+    glPopMatrix();
+}
+
+inline void drawSolidCube(float size) {
+    glPushMatrix();
+    countDraw(DRAW_MATRIX_PUSHES);
+    glScalef(size, size, size);
+    drawMesh(getPrimitiveMesh(MESH_CUBE, 1, 1, 0.0f));
+    glPopMatrix();
+}
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,402 @@
+#ifndef PROCEDURAL_TEXTURE_H
+#define PROCEDURAL_TEXTURE_H
+
+// --- Procedural Textures ---
+// Bark and ground are a base color, a separable wave pattern and per-texel
+// noise:
+//     value[c] = base[c] + weight[c] * (rowWave(i) + columnWave(j) +
+//                rowProduct(i) * columnProduct(j)) + noise(i, j)
+// The waves only depend on the row or the column, so they are tabulated once
+// per texture and each texel costs a few table reads, a hash and a clamp.
+// Noise comes from a hash of (stream key, texel index) instead of rand(), so
+// rows can be filled on any thread in any order and a seed always gives the
+// same image.
+//
+// Rows are filled in parallel on the job system, eight texels at a time with
+// AVX2 where available, into one heap buffer that also holds the mip chain.
+// Each mip level is a 2x2 box filter of the level above (SSE2), and the chain
+// is uploaded once, level by level.
+//
+// Wave frequencies are given per texel at TEXTURE_REFERENCE_SIZE. Larger
+// textures scale them down, so the pattern keeps its size on the surface and
+// only the detail gets finer.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "job_system.h"
+#include "simd_math.h"
+
+const int TEXTURE_REFERENCE_SIZE = 512;
+const int TEXTURE_MIN_SIZE = 64;
+const int TEXTURE_MAX_SIZE = 4096;
+
+struct TextureWave {
+    float amplitude;
+    float frequency; // Radians per texel at TEXTURE_REFERENCE_SIZE
+};
+
+struct ProceduralTextureDesc {
+    float base[3];
+    float patternWeight[3];                // Share of the wave pattern in each channel
+    TextureWave rowWave, columnWave;       // Added to the pattern
+    TextureWave rowProduct, columnProduct; // Multiplied together, then added
+    int noiseSpan;                         // Noise is an integer in [-noiseSpan / 2, noiseSpan - noiseSpan / 2)
+};
+
+// RGBA8 texels (alpha 255) of a square power-of-two texture and its mip
+// chain, every level back to back in one heap buffer
+struct TextureImage {
+    int size = 0;
+    std::vector<unsigned char> texels;
+    std::vector<size_t> levelOffsets;
+
+    int levels() const { return (int)levelOffsets.size(); }
+    int levelSize(int level) const { return std::max(1, size >> level); }
+    unsigned char* level(int level) { return texels.data() + levelOffsets[level]; }
+    const unsigned char* level(int level) const { return texels.data() + levelOffsets[level]; }
+
+    void allocate(int levelZeroSize) {
+        size = levelZeroSize;
+        levelOffsets.clear();
+        size_t bytes = 0;
+        for (int s = size;; s /= 2) {
+            levelOffsets.push_back(bytes);
+            bytes += (size_t)s * s * 4;
+            if (s == 1) break;
+        }
+        texels.resize(bytes);
+    }
+};
+
+// Bytes of a whole mip chain laid out like TextureImage::texels
+inline size_t textureChainBytes(int size) {
+    size_t bytes = 0;
+    for (int s = size; s >= 1; s /= 2) bytes += (size_t)s * s * 4;
+    return bytes;
+}
+
+// Per-texture wave tables, shared read-only by every row job
+struct TextureTables {
+    const ProceduralTextureDesc* desc;
+    int size;
+    uint32_t key;
+    std::vector<float> rowAdd, rowMul, columnAdd, columnMul;
+
+    void build(const ProceduralTextureDesc& d, int textureSize, uint32_t noiseKey) {
+        desc = &d;
+        size = textureSize;
+        key = noiseKey;
+        float scale = (float)TEXTURE_REFERENCE_SIZE / size;
+        tabulate(rowAdd, d.rowWave, scale);
+        tabulate(rowMul, d.rowProduct, scale);
+        tabulate(columnAdd, d.columnWave, scale);
+        tabulate(columnMul, d.columnProduct, scale);
+    }
+
+private:
+    void tabulate(std::vector<float>& table, const TextureWave& wave, float scale) {
+        table.resize(size);
+        for (int i = 0; i < size; ++i) table[i] = wave.amplitude * fastSin(i * scale * wave.frequency);
+    }
+};
+
+// lowbias32 integer hash
+inline uint32_t textureHash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+inline int textureNoise(uint32_t key, uint32_t index, int span) {
+    return (int)(((textureHash(key ^ index) >> 16) * (uint32_t)span) >> 16) - span / 2;
+}
+
+// --- Row Kernels ---
+// Fill texels [begin, end) of one row of level 0. Every kernel produces the
+// same bytes.
+
+typedef void (*TextureRowKernel)(const TextureTables& tables, int row, int begin, int end, unsigned char* out);
+
+inline void textureRowScalar(const TextureTables& tables, int row, int begin, int end, unsigned char* out) {
+    const ProceduralTextureDesc& d = *tables.desc;
+    float rowAdd = tables.rowAdd[row], rowMul = tables.rowMul[row];
+    uint32_t first = (uint32_t)row * (uint32_t)tables.size;
+    for (int j = begin; j < end; ++j) {
+        float pattern = (rowAdd + tables.columnAdd[j]) + rowMul * tables.columnMul[j];
+        float noise = (float)textureNoise(tables.key, first + j, d.noiseSpan);
+        for (int c = 0; c < 3; ++c) {
+            float value = (d.base[c] + d.patternWeight[c] * pattern) + noise;
+            out[j * 4 + c] = (unsigned char)std::min(std::max(value, 0.0f), 255.0f);
+        }
+        out[j * 4 + 3] = 255;
+    }
+}
+
+#ifdef SIMD_MATH_X86
+
+__attribute__((target("avx2")))
+inline __m256i textureChannelAVX2(__m256 base, __m256 weight, __m256 pattern, __m256 noise) {
+    __m256 value = _mm256_add_ps(_mm256_add_ps(base, _mm256_mul_ps(weight, pattern)), noise);
+    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    return _mm256_cvttps_epi32(value);
+}
+
+__attribute__((target("avx2")))
+inline void textureRowAVX2(const TextureTables& tables, int row, int begin, int end, unsigned char* out) {
+    const ProceduralTextureDesc& d = *tables.desc;
+    const __m256 rowAdd = _mm256_set1_ps(tables.rowAdd[row]);
+    const __m256 rowMul = _mm256_set1_ps(tables.rowMul[row]);
+    __m256 base[3], weight[3];
+    for (int c = 0; c < 3; ++c) {
+        base[c] = _mm256_set1_ps(d.base[c]);
+        weight[c] = _mm256_set1_ps(d.patternWeight[c]);
+    }
+    const __m256i key = _mm256_set1_epi32((int)tables.key);
+    const __m256i span = _mm256_set1_epi32(d.noiseSpan);
+    const __m256i halfSpan = _mm256_set1_epi32(d.noiseSpan / 2);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+    uint32_t first = (uint32_t)row * (uint32_t)tables.size;
+
+    int j = begin;
+    for (; j + 8 <= end; j += 8) {
+        __m256 pattern = _mm256_add_ps(_mm256_add_ps(rowAdd, _mm256_loadu_ps(&tables.columnAdd[j])),
+                                       _mm256_mul_ps(rowMul, _mm256_loadu_ps(&tables.columnMul[j])));
+
+        // textureHash(key ^ index) in eight lanes
+        __m256i h = _mm256_xor_si256(key, _mm256_add_epi32(_mm256_set1_epi32((int)(first + j)), lanes));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x7FEB352D));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int)0x846CA68Bu));
+        h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+        __m256i n = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(h, 16), span), 16), halfSpan);
+        __m256 noise = _mm256_cvtepi32_ps(n);
+
+        __m256i r = textureChannelAVX2(base[0], weight[0], pattern, noise);
+        __m256i g = textureChannelAVX2(base[1], weight[1], pattern, noise);
+        __m256i b = textureChannelAVX2(base[2], weight[2], pattern, noise);
+        __m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                                       _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+        _mm256_storeu_si256((__m256i*)(out + j * 4), rgba);
+    }
+    textureRowScalar(tables, row, j, end, out);
+}
+
+#endif // SIMD_MATH_X86
+
+// Kernel by name, or nullptr if it is not available on this CPU
+inline TextureRowKernel textureRowKernelByName(const char* name) {
+    if (strcmp(name, "scalar") == 0) return textureRowScalar;
+#ifdef SIMD_MATH_X86
+    if (strcmp(name, "avx2") == 0 && cpuHasAVX2()) return textureRowAVX2;
+#endif
+    return nullptr;
+}
+
+// Fastest kernel for this CPU, or the one TEXTURE_KERNEL names. Chosen
+// once; the loader and GL threads may both get here first, and a
+// function-local static is initialized exactly once.
+inline TextureRowKernel textureRowKernel() {
+    static const TextureRowKernel kernel = [] {
+        const char* forced = getenv("TEXTURE_KERNEL");
+        TextureRowKernel chosen = forced ? textureRowKernelByName(forced) : nullptr;
+        if (!chosen) chosen = textureRowKernelByName("avx2");
+        return chosen ? chosen : textureRowScalar;
+    }();
+    return kernel;
+}
+
+inline const char* textureRowKernelName() {
+    return textureRowKernel() == textureRowScalar ? "scalar" : "avx2";
+}
+
+// --- Mip Chain ---
+// Texels [begin, width) of one row of a level from rows 2y and 2y+1 of the
+// level above; 'width' is the destination width
+
+inline void textureDownsampleRowScalar(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                                       int begin, int width) {
+    for (int x = begin; x < width; ++x) {
+        for (int c = 0; c < 4; ++c) {
+            int sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+            out[x * 4 + c] = (unsigned char)((sum + 2) >> 2);
+        }
+    }
+}
+
+#ifdef SIMD_MATH_X86
+
+// Four destination texels per step, summed in 16-bit lanes
+__attribute__((target("sse2")))
+inline void textureDownsampleRowSSE2(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                                     int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+
+        // Vertical sums, two source texels per register
+        __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // Horizontal pairs: even source texels plus odd ones
+        __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+        __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+        d01 = _mm_srli_epi16(_mm_add_epi16(d01, two), 2);
+        d23 = _mm_srli_epi16(_mm_add_epi16(d23, two), 2);
+        _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(d01, d23));
+    }
+    textureDownsampleRowScalar(row0, row1, out, x, width);
+}
+
+#endif // SIMD_MATH_X86
+
+inline void textureDownsampleRow(const unsigned char* row0, const unsigned char* row1, unsigned char* out, int width) {
+#ifdef SIMD_MATH_X86
+    textureDownsampleRowSSE2(row0, row1, out, width);
+#else
+    textureDownsampleRowScalar(row0, row1, out, 0, width);
+#endif
+}
+
+// Rows handed to one job: about 16K texels
+inline size_t textureRowGrain(int width) {
+    return (size_t)std::max(1, 16384 / width);
+}
+
+inline void buildTextureMips(TextureImage& image) {
+    for (int level = 1; level < image.levels(); ++level) {
+        int width = image.levelSize(level), above = image.levelSize(level - 1);
+        const unsigned char* source = image.level(level - 1);
+        unsigned char* destination = image.level(level);
+        parallelFor(0, width, textureRowGrain(width), [=](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                const unsigned char* row0 = source + (2 * y) * above * 4;
+                const unsigned char* row1 = above > 1 ? row0 + above * 4 : row0;
+                textureDownsampleRow(row0, row1, destination + y * width * 4, width);
+            }
+        });
+    }
+}
+
+// Fills 'image' with a size x size texture and its mip chain. 'size' must be
+// a power of two; noiseKey selects the noise (e.g. from sceneRngKey).
+inline void generateProceduralTexture(const ProceduralTextureDesc& desc, int size, uint64_t noiseKey,
+                                      TextureImage& image, TextureRowKernel kernel = nullptr) {
+    if (!kernel) kernel = textureRowKernel();
+    TextureTables tables;
+    tables.build(desc, size, (uint32_t)(noiseKey ^ (noiseKey >> 32)));
+    image.allocate(size);
+    unsigned char* texels = image.level(0);
+    parallelFor(0, size, textureRowGrain(size), [&tables, kernel, texels, size](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            kernel(tables, (int)row, 0, size, texels + row * size * 4);
+        }
+    });
+    buildTextureMips(image);
+}
+
+// Creates a repeating, trilinear-filtered texture from a size x size mip
+// chain laid out like TextureImage::texels (textureChainBytes(size) bytes),
+// read in place; needs the GL context
+inline GLuint uploadTextureChain(const unsigned char* texels, int size) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int level = 0, s = size; s >= 1; ++level, s /= 2) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, s, s, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels);
+        texels += (size_t)s * s * 4;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
+}
+
+inline GLuint uploadTextureImage(const TextureImage& image) {
+    return uploadTextureChain(image.texels.data(), image.size);
+}
+
+// The same upload spread over several calls: step() sends whole rows of the
+// current level with glTexSubImage2D until 'budget' bytes are used up. The
+// texture is complete (and may be bound) once step() returns true.
+struct TextureChainUpload {
+    const unsigned char* texels = nullptr; // Must stay valid until done
+    int size = 0;
+    GLuint texture = 0;
+    int level = 0;
+    int row = 0; // Next row of 'level'
+
+    void begin(const unsigned char* chain, int levelZeroSize) {
+        texels = chain;
+        size = levelZeroSize;
+        level = row = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (int l = 0, s = size; s >= 1; ++l, s /= 2) {
+            glTexImage2D(GL_TEXTURE_2D, l, GL_RGB, s, s, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+
+    // At least one row goes out per call, so any budget makes progress
+    bool step(size_t& budget) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (int s = size >> level; s >= 1; s = size >> level) {
+            size_t rowBytes = (size_t)s * 4;
+            int rows = (int)std::min<size_t>(s - row, std::max<size_t>(1, budget / rowBytes));
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, row, s, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                            texels + (size_t)row * rowBytes);
+            budget -= std::min(budget, rows * rowBytes);
+            row += rows;
+            if (row == s) {
+                texels += (size_t)s * rowBytes;
+                row = 0;
+                ++level;
+            }
+            if (budget == 0) return false;
+        }
+        return true;
+    }
+};
+
+// Consumes --texture-size <n> from argv so GLUT never sees it; the size is
+// rounded down to a power of two within [TEXTURE_MIN_SIZE, TEXTURE_MAX_SIZE]
+inline void textureParseArgs(int& argc, char** argv, int& size) {
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--texture-size") == 0 && i + 1 < argc) {
+            int requested = std::min(std::max(atoi(argv[++i]), TEXTURE_MIN_SIZE), TEXTURE_MAX_SIZE);
+            size = TEXTURE_MIN_SIZE;
+            while (size * 2 <= requested) size *= 2;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+}
+
+#endif // PROCEDURAL_TEXTURE_H
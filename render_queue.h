@@ -0,0 +1,272 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+// --- Render Queue ---
+// Draw code records what it wants drawn instead of issuing GL calls: each
+// item is a cached mesh, a world transform, a material and a texture. The
+// recording calls mirror immediate mode (push/translate/rotate/scale, set a
+// material, bind a texture, draw a mesh), so draw code converts line by line.
+//
+// flush() sorts the items by a 64-bit key - pass, then texture, then
+// material, then distance from the eye - and submits them, changing
+// texture and material state only where consecutive items differ. Opaque
+// items that share state therefore come out front to back, which lets the
+// depth test reject hidden pixels early.
+//
+// Items carry the profiler section that queued them. While the frame
+// profiler runs, flush() times each run of consecutive items from one
+// section with a GPU query charged to that section, so passes keep their
+// own GPU time although their items are interleaved by the sort. Draw
+// counts (draw_counters.h) go to the item's section the same way.
+//
+// A material is the diffuse color of setMaterialColor(): ambient is 0.3 of
+// it, specular and shininess are fixed. Meshes with vertex colors use
+// RENDER_VERTEX_COLORS instead and leave the current color undefined.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "frame_profiler.h"
+#include "gl_state.h"
+#include "lod.h"
+#include "mesh_cache.h"
+
+// Everything setMaterialColor() used to set, through the state cache;
+// ambient and diffuse follow the color through GL_COLOR_MATERIAL as well
+inline void applyMaterialColor(float r, float g, float b) {
+    GLfloat ambient[] = { r * 0.3f, g * 0.3f, b * 0.3f, 1.0f };
+    GLfloat diffuse[] = { r, g, b, 1.0f };
+    GLfloat specular[] = { 0.3f, 0.3f, 0.3f, 1.0f };
+    GLfloat shininess[] = { 32.0f };
+    GlStateCache& state = glState();
+    state.material(GL_FRONT, GL_AMBIENT, ambient);
+    state.material(GL_FRONT, GL_DIFFUSE, diffuse);
+    state.material(GL_FRONT, GL_SPECULAR, specular);
+    state.material(GL_FRONT, GL_SHININESS, shininess);
+    state.color3f(r, g, b);
+}
+
+// Passes are submitted in this order
+enum RenderPass { RENDER_PASS_OPAQUE = 0, RENDER_PASS_COUNT };
+
+const uint32_t RENDER_VERTEX_COLORS = 0; // Material id of meshes with vertex colors
+
+struct RenderItem {
+    uint64_t key;
+    Mesh* mesh;
+    uint32_t material;
+    GLuint texture; // 0: untextured
+    int section;    // Profiler section charged with its GPU time; -1: none
+    Mat4 transform;
+};
+
+// State changes one frame issued, next to the ones the same items would
+// have needed in submission order
+struct RenderQueueStats {
+    int items = 0;
+    int materialChanges = 0;
+    int textureChanges = 0;
+    int unsortedMaterialChanges = 0;
+    int unsortedTextureChanges = 0;
+};
+
+class RenderQueue {
+public:
+    RenderQueueStats stats;      // Last flush
+    RenderQueueStats totals;     // All flushes
+
+    // Clears the queue; depth keys are measured from 'eye'
+    void begin(float eyeX, float eyeY, float eyeZ) {
+        items.clear();
+        materials.resize(1); // Keep RENDER_VERTEX_COLORS
+        materialIndex.clear();
+        eye[0] = eyeX; eye[1] = eyeY; eye[2] = eyeZ;
+        current = Mat4::identity();
+        stack.clear();
+        material = RENDER_VERTEX_COLORS;
+        texture = 0;
+        pass = RENDER_PASS_OPAQUE;
+        section = -1;
+        stats = RenderQueueStats();
+        lastMaterial = lastTexture = UINT32_MAX;
+    }
+
+    void pushMatrix() { stack.push_back(current); }
+    void popMatrix() { current = stack.back(); stack.pop_back(); }
+    void loadIdentity() { current = Mat4::identity(); }
+    void translate(float x, float y, float z) { current = current * Mat4::translation(x, y, z); }
+    void rotate(float angle, float x, float y, float z) { current = current * Mat4::rotation(angle, x, y, z); }
+    void scale(float x, float y, float z) { current = current * Mat4::scaling(x, y, z); }
+
+    void setPass(RenderPass p) { pass = p; }
+    void setTexture(GLuint t) { texture = t; }
+    void setProfileSection(int s) { section = s; }
+    void setVertexColors() { material = RENDER_VERTEX_COLORS; }
+
+    void setMaterialColor(float r, float g, float b) {
+        const float color[3] = { r, g, b };
+        uint32_t bits[3];
+        memcpy(bits, color, sizeof(bits));
+        uint64_t hash = ((uint64_t)bits[0] * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)bits[1] * 0xC2B2AE3D27D4EB4Full) ^
+                        ((uint64_t)bits[2] * 0x165667B19E3779F9ull);
+        auto range = materialIndex.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            const float* m = materials[it->second].color;
+            if (m[0] == r && m[1] == g && m[2] == b) {
+                material = it->second;
+                return;
+            }
+        }
+        material = (uint32_t)materials.size();
+        Material entry = { { r, g, b } };
+        materials.push_back(entry);
+        materialIndex.insert(std::make_pair(hash, material));
+    }
+
+    // Queues 'mesh' with the current transform, material and texture. Its
+    // depth key is the distance from the eye to the transformed 'center'.
+    void drawMesh(Mesh& mesh, float centerX = 0.0f, float centerY = 0.0f, float centerZ = 0.0f) {
+        float local[3] = { centerX, centerY, centerZ }, world[3];
+        current.transformPoint(local, world);
+        float dx = world[0] - eye[0], dy = world[1] - eye[1], dz = world[2] - eye[2];
+        float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+        uint32_t depth;
+        memcpy(&depth, &distance, sizeof(depth)); // Non-negative floats order like their bits
+
+        RenderItem item;
+        item.key = ((uint64_t)pass << 60) | ((uint64_t)(textureSlot(texture) & 0xFF) << 52) |
+                   ((uint64_t)(material & 0xFFFFF) << 32) | depth;
+        item.mesh = &mesh;
+        item.material = material;
+        item.texture = texture;
+        item.section = section;
+        item.transform = current;
+        items.push_back(item);
+
+        // What the same items would cost drawn in this order
+        if (texture != lastTexture) { ++stats.unsortedTextureChanges; lastTexture = texture; }
+        if (material == RENDER_VERTEX_COLORS) lastMaterial = UINT32_MAX;
+        else if (material != lastMaterial) { ++stats.unsortedMaterialChanges; lastMaterial = material; }
+    }
+
+    // Sorts and submits everything queued since begin(), on top of the
+    // current modelview matrix. Leaves texturing disabled.
+    void flush() {
+        std::sort(items.begin(), items.end(), [](const RenderItem& a, const RenderItem& b) { return a.key < b.key; });
+
+        GlStateCache& state = glState();
+        FrameProfiler& profiler = frameProfiler();
+        bool profiling = profiler.active() && profiler.gpuTiming();
+        int timedSection = -1;
+        int submitSection = DrawCounters::currentSection();
+        uint32_t boundMaterial = UINT32_MAX;
+        GLuint boundTexture = 0;
+        bool texturing = false;
+        for (RenderItem& item : items) {
+            DrawCounters::currentSection() = item.section >= 0 ? item.section : submitSection;
+            if (profiling && item.section != timedSection) {
+                if (timedSection >= 0) profiler.endGpu();
+                timedSection = item.section >= 0 && profiler.beginGpu(item.section) ? item.section : -1;
+            }
+            if (item.texture != 0) {
+                if (!texturing) { state.enable(GL_TEXTURE_2D); texturing = true; }
+                if (item.texture != boundTexture) {
+                    state.bindTexture(GL_TEXTURE_2D, item.texture);
+                    boundTexture = item.texture;
+                    ++stats.textureChanges;
+                }
+            } else if (texturing) {
+                state.disable(GL_TEXTURE_2D);
+                texturing = false;
+                ++stats.textureChanges;
+            }
+            if (item.material != RENDER_VERTEX_COLORS && item.material != boundMaterial) {
+                const float* c = materials[item.material].color;
+                applyMaterialColor(c[0], c[1], c[2]);
+                boundMaterial = item.material;
+                ++stats.materialChanges;
+            }
+
+            glPushMatrix();
+            glMultMatrixf(item.transform.m);
+            ::drawMesh(*item.mesh);
+            glPopMatrix();
+            countDraw(DRAW_MATRIX_PUSHES);
+            if (item.material == RENDER_VERTEX_COLORS) {
+                boundMaterial = UINT32_MAX;
+                state.invalidateColor();
+            }
+        }
+        if (texturing) state.disable(GL_TEXTURE_2D);
+        if (timedSection >= 0) profiler.endGpu();
+        DrawCounters::currentSection() = submitSection;
+
+        stats.items = (int)items.size();
+        totals.items += stats.items;
+        totals.materialChanges += stats.materialChanges;
+        totals.textureChanges += stats.textureChanges;
+        totals.unsortedMaterialChanges += stats.unsortedMaterialChanges;
+        totals.unsortedTextureChanges += stats.unsortedTextureChanges;
+        items.clear();
+    }
+
+private:
+    struct Material {
+        float color[3];
+    };
+
+    std::vector<RenderItem> items;
+    std::vector<Material> materials = std::vector<Material>(1);
+    std::unordered_multimap<uint64_t, uint32_t> materialIndex; // Color hash -> materials[]
+    std::vector<GLuint> textureSlots = std::vector<GLuint>(1, 0); // Sort order of textures; slot 0 is none
+    float eye[3] = { 0.0f, 0.0f, 0.0f };
+    Mat4 current = Mat4::identity();
+    std::vector<Mat4> stack;
+    uint32_t material = RENDER_VERTEX_COLORS;
+    GLuint texture = 0;
+    RenderPass pass = RENDER_PASS_OPAQUE;
+    int section = -1;
+    uint32_t lastMaterial = UINT32_MAX, lastTexture = UINT32_MAX;
+
+    // Small stable index per texture name, so names of any size fit the key
+    uint32_t textureSlot(GLuint name) {
+        for (size_t i = 0; i < textureSlots.size(); ++i) {
+            if (textureSlots[i] == name) return (uint32_t)i;
+        }
+        textureSlots.push_back(name);
+        return (uint32_t)textureSlots.size() - 1;
+    }
+};
+
+// Queued counterparts of drawSolidSphere/drawSolidCylinder and the LOD helpers
+
+inline void queueSolidSphere(RenderQueue& queue, float radius, int slices, int stacks) {
+    queue.pushMatrix();
+    queue.scale(radius, radius, radius);
+    queue.drawMesh(getPrimitiveMesh(MESH_SPHERE, slices, stacks, 0.0f));
+    queue.popMatrix();
+}
+
+inline void queueSolidCylinder(RenderQueue& queue, float baseRadius, float topRadius, float height, int slices, int stacks) {
+    float ratio = baseRadius > 0.0f ? topRadius / baseRadius : 1.0f;
+    queue.pushMatrix();
+    queue.scale(baseRadius, baseRadius, height);
+    queue.drawMesh(getPrimitiveMesh(MESH_CYLINDER, slices, stacks, ratio), 0.0f, 0.0f, 0.5f);
+    queue.popMatrix();
+}
+
+inline void queueLodSphere(RenderQueue& queue, float radius, int slices, int stacks, int level) {
+    queueSolidSphere(queue, radius, lodSegments(slices, level, 6), lodSegments(stacks, level, 4));
+}
+
+inline void queueLodCylinder(RenderQueue& queue, float baseRadius, float topRadius, float height, int slices, int stacks, int level) {
+    queueSolidCylinder(queue, baseRadius, topRadius, height, lodSegments(slices, level, 6), lodSegments(stacks, level, 1));
+}
+
+#endif // RENDER_QUEUE_H
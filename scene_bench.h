@@ -0,0 +1,290 @@
+#ifndef SCENE_BENCH_H
+#define SCENE_BENCH_H
+
+// --- Headless Benchmark Runner ---
+// Shared by all three scenes. Pass --bench <frames> on the command line to
+// skip the interactive loop: the scene is stepped and drawn back to back,
+// with no glutTimerFunc throttling, and frame time statistics are written
+// as JSON to stdout (or to --bench-out <file>).
+//
+// The runner needs a GL context but no visible desktop, so it works on any
+// X server including Xvfb:
+//     xvfb-run -a ./man_in_autum --bench 600 --bench-out man_in_autum.json
+//
+// Built with -DSCENE_BENCH_EGL (and -lEGL) the runner skips GLUT entirely and
+// renders into a framebuffer object on a surfaceless EGL context, so no X
+// server is needed at all.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "trace_events.h"
+
+#ifdef SCENE_BENCH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+struct BenchOptions {
+    bool enabled = false;
+    int frames = 600;
+    int warmupFrames = 30;
+    std::string outputPath; // Empty means stdout
+    bool headless = false;  // Running on an EGL context instead of a GLUT window
+};
+
+inline BenchOptions& benchOptions() {
+    static BenchOptions options;
+    return options;
+}
+
+inline bool benchEnabled() {
+    return benchOptions().enabled;
+}
+
+// Consumes the --bench* flags from argv so GLUT never sees them. Call before glutInit.
+inline void benchParseArgs(int& argc, char** argv) {
+    BenchOptions& options = benchOptions();
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            options.enabled = true;
+            options.frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--bench-warmup") == 0 && i + 1 < argc) {
+            options.warmupFrames = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+
+#ifndef _WIN32
+    // Ask Mesa and the NVIDIA driver not to block swaps on vblank
+    if (options.enabled) {
+        setenv("vblank_mode", "0", 0);
+        setenv("__GL_SYNC_TO_VBLANK", "0", 0);
+    }
+#endif
+}
+
+// Creates a surfaceless EGL context with an offscreen framebuffer when the
+// benchmark is enabled and EGL support is compiled in. Returns false when the
+// caller should open a GLUT window instead.
+inline bool benchCreateHeadlessContext(int width, int height) {
+#ifdef SCENE_BENCH_EGL
+    if (!benchEnabled()) return false;
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = getPlatformDisplay
+        ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+        : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        fprintf(stderr, "bench: no EGL display available\n");
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+    // Compatibility profile, the scenes use the fixed-function pipeline
+    EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : (EGLConfig)0,
+                                          EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "bench: cannot create a surfaceless EGL context\n");
+        return false;
+    }
+
+    PFNGLGENFRAMEBUFFERSPROC genFramebuffers = (PFNGLGENFRAMEBUFFERSPROC)eglGetProcAddress("glGenFramebuffers");
+    PFNGLBINDFRAMEBUFFERPROC bindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC)eglGetProcAddress("glBindFramebuffer");
+    PFNGLGENRENDERBUFFERSPROC genRenderbuffers = (PFNGLGENRENDERBUFFERSPROC)eglGetProcAddress("glGenRenderbuffers");
+    PFNGLBINDRENDERBUFFERPROC bindRenderbuffer = (PFNGLBINDRENDERBUFFERPROC)eglGetProcAddress("glBindRenderbuffer");
+    PFNGLRENDERBUFFERSTORAGEPROC renderbufferStorage = (PFNGLRENDERBUFFERSTORAGEPROC)eglGetProcAddress("glRenderbufferStorage");
+    PFNGLFRAMEBUFFERRENDERBUFFERPROC framebufferRenderbuffer = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)eglGetProcAddress("glFramebufferRenderbuffer");
+    if (!genFramebuffers || !bindFramebuffer || !genRenderbuffers ||
+        !bindRenderbuffer || !renderbufferStorage || !framebufferRenderbuffer) {
+        fprintf(stderr, "bench: framebuffer objects are not supported\n");
+        return false;
+    }
+
+    GLuint framebuffer, renderbuffers[2];
+    genFramebuffers(1, &framebuffer);
+    bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    genRenderbuffers(2, renderbuffers);
+    bindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    bindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    benchOptions().headless = true;
+    return true;
+#else
+    (void)width; (void)height;
+    return false;
+#endif
+}
+
+// Stands in for glutSwapBuffers on the headless context
+inline void benchFinishFrame() {
+#ifdef SCENE_BENCH_EGL
+    glFinish();
+#endif
+}
+
+// Scenes can append their own fields to the JSON report (culling counts and
+// the like). The writer prints one or more "key": value members with no
+// trailing comma or newline.
+typedef void (*BenchReportWriter)(FILE* out);
+
+inline BenchReportWriter& benchReportWriter() {
+    static BenchReportWriter writer = nullptr;
+    return writer;
+}
+
+// Called once the warmup frames are done, right before the timed ones, so
+// the scene can zero the totals its report writer averages. Those averages
+// should then divide by benchTimedFrames().
+typedef void (*BenchResetHook)();
+
+inline BenchResetHook& benchResetHook() {
+    static BenchResetHook hook = nullptr;
+    return hook;
+}
+
+// Frames the per-frame means in scene reports cover
+inline double benchTimedFrames() {
+    return std::max(1, benchOptions().frames);
+}
+
+struct BenchStats {
+    double mean, p50, p95, p99, min, max;
+};
+
+inline BenchStats benchComputeStats(std::vector<double> samples) {
+    BenchStats stats = {0, 0, 0, 0, 0, 0};
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+
+    // Nearest-rank percentile
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)(p / 100.0 * samples.size() + 0.999999);
+        if (rank < 1) rank = 1;
+        if (rank > samples.size()) rank = samples.size();
+        return samples[rank - 1];
+    };
+
+    stats.mean = sum / samples.size();
+    stats.p50 = percentile(50.0);
+    stats.p95 = percentile(95.0);
+    stats.p99 = percentile(99.0);
+    stats.min = samples.front();
+    stats.max = samples.back();
+    return stats;
+}
+
+inline void benchWriteStats(FILE* out, const char* name, const BenchStats& s) {
+    fprintf(out, "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"min\": %.4f, \"max\": %.4f}",
+            name, s.mean, s.p50, s.p95, s.p99, s.min, s.max);
+}
+
+// Drives the scene for the configured number of frames and reports the timings.
+// stepScene advances the simulation by one tick, drawScene issues the frame and
+// present hands it to the window system (glutSwapBuffers, replaced by glFinish
+// on the headless context).
+// "cpu_frame_ms" covers stepScene + drawScene, "frame_ms" also includes present.
+inline int benchRun(const char* sceneName, void (*stepScene)(), void (*drawScene)(), void (*present)()) {
+    typedef std::chrono::steady_clock Clock;
+    const BenchOptions& options = benchOptions();
+    if (options.headless) present = benchFinishFrame;
+
+    for (int i = 0; i < options.warmupFrames; ++i) {
+        TraceScope frame("warmup frame", "bench");
+        stepScene();
+        drawScene();
+        present();
+    }
+    if (benchResetHook()) benchResetHook()();
+
+    std::vector<double> cpuFrameMs, frameMs;
+    cpuFrameMs.reserve(options.frames);
+    frameMs.reserve(options.frames);
+
+    Clock::time_point runStart = Clock::now();
+    for (int i = 0; i < options.frames; ++i) {
+        TraceScope frame("frame", "bench");
+        Clock::time_point frameStart = Clock::now();
+        {
+            TraceScope scope("step", "bench");
+            stepScene();
+        }
+        {
+            TraceScope scope("draw", "bench");
+            drawScene();
+        }
+        Clock::time_point submitted = Clock::now();
+        {
+            TraceScope scope("present", "bench");
+            present();
+        }
+        Clock::time_point frameEnd = Clock::now();
+
+        cpuFrameMs.push_back(std::chrono::duration<double, std::milli>(submitted - frameStart).count());
+        frameMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+    }
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+
+    FILE* out = stdout;
+    if (!options.outputPath.empty()) {
+        out = fopen(options.outputPath.c_str(), "w");
+        if (!out) {
+            fprintf(stderr, "bench: cannot open %s for writing\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"scene\": \"%s\",\n", sceneName);
+    fprintf(out, "  \"frames\": %d,\n", options.frames);
+    fprintf(out, "  \"warmup_frames\": %d,\n", options.warmupFrames);
+    fprintf(out, "  \"context\": \"%s\",\n", options.headless ? "egl-surfaceless" : "glut");
+    fprintf(out, "  \"wall_time_s\": %.6f,\n", wallSeconds);
+    fprintf(out, "  \"fps\": %.3f,\n", options.frames / wallSeconds);
+    benchWriteStats(out, "cpu_frame_ms", benchComputeStats(cpuFrameMs));
+    fprintf(out, ",\n");
+    benchWriteStats(out, "frame_ms", benchComputeStats(frameMs));
+    if (benchReportWriter()) {
+        fprintf(out, ",\n");
+        benchReportWriter()(out);
+    }
+    fprintf(out, "\n}\n");
+
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+#endif // SCENE_BENCH_H
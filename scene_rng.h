@@ -0,0 +1,119 @@
+#ifndef SCENE_RNG_H
+#define SCENE_RNG_H
+
+// --- Scene Random Numbers ---
+// Counter-based generator for procedural scene content. Every object draws
+// from its own stream, keyed by (scene seed, object kind, object index), and
+// the n-th number of a stream is a pure function of that key and n
+// (SplitMix64). Objects can therefore be generated in any order, on any
+// thread, and the same seed always yields a bit-identical scene.
+//
+// The seed comes from --seed <n>. Without it, interactive runs pick one from
+// the clock, and benchmark runs use SCENE_BENCH_SEED so every run measures
+// the same scene.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+const uint64_t SCENE_BENCH_SEED = 20241031u;
+
+// What a stream is generating; part of the stream key
+enum SceneObjectKind {
+    RNG_LEAF = 1,
+    RNG_LEAF_RESPAWN,
+    RNG_PUMPKIN,
+    RNG_FLOWER,
+    RNG_LEAF_PILE,
+    RNG_CLOUD,
+    RNG_CLOUD_RESPAWN,
+    RNG_HILL,
+    RNG_MOUNTAIN,
+    RNG_DISTANT_TREE,
+    RNG_BARK_TEXTURE,
+    RNG_GROUND_TEXTURE
+};
+
+inline uint64_t rngMix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+const uint64_t RNG_GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+// Stream key for one object
+inline uint64_t sceneRngKey(uint64_t seed, SceneObjectKind kind, uint64_t index) {
+    return rngMix64(rngMix64(seed + (uint64_t)kind * RNG_GOLDEN_GAMMA) + index * RNG_GOLDEN_GAMMA);
+}
+
+struct SceneRng {
+    uint64_t key;
+    uint64_t counter;
+
+    uint64_t next64() {
+        return rngMix64(key + ++counter * RNG_GOLDEN_GAMMA);
+    }
+
+    uint32_t next() {
+        return (uint32_t)(next64() >> 32);
+    }
+
+    // [0, 1)
+    float uniform() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // [lo, hi)
+    float range(float lo, float hi) {
+        return lo + uniform() * (hi - lo);
+    }
+
+    // Integer in [0, n)
+    int below(int n) {
+        return (int)(((uint64_t)next() * (uint64_t)n) >> 32);
+    }
+};
+
+inline SceneRng sceneRng(uint64_t seed, SceneObjectKind kind, uint64_t index) {
+    SceneRng rng = { sceneRngKey(seed, kind, index), 0 };
+    return rng;
+}
+
+inline uint64_t& sceneSeedRef() {
+    static uint64_t seed = SCENE_BENCH_SEED;
+    return seed;
+}
+
+inline uint64_t sceneSeed() {
+    return sceneSeedRef();
+}
+
+// True when the seed came from --seed rather than the fallback
+inline bool& sceneSeedGivenRef() {
+    static bool given = false;
+    return given;
+}
+
+inline bool sceneSeedGiven() {
+    return sceneSeedGivenRef();
+}
+
+// Consumes --seed <n> from argv so GLUT never sees it, otherwise uses 'fallback'
+inline void sceneRngParseArgs(int& argc, char** argv, uint64_t fallback) {
+    uint64_t seed = fallback;
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+            sceneSeedGivenRef() = true;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+    sceneSeedRef() = seed;
+}
+
+#endif // SCENE_RNG_H
@@ -0,0 +1,99 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+// --- Fixed Timestep Clock ---
+// Decouples the simulation rate from the render rate. The scenes render from
+// glutIdleFunc as fast as the driver allows (or at the vsync rate), and each
+// frame asks the clock how many fixed simulation ticks have come due on the
+// monotonic clock since the last frame. What is left over in the accumulator
+// becomes alpha(), the fraction of a tick to blend the previous and current
+// simulation state by when drawing.
+//
+// Both rates are measured over one-second windows; once a window closes,
+// the clock updates the window title with them.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+struct SimClock {
+    typedef std::chrono::steady_clock Clock;
+
+    double stepSeconds;     // Length of one simulation tick
+    int maxStepsPerFrame;   // Drop time rather than spiral after a long stall
+
+    Clock::time_point lastTime;
+    bool started = false;
+    double accumulator = 0.0;
+
+    // Rate measurement
+    Clock::time_point windowStart;
+    int windowSteps = 0;
+    int windowFrames = 0;
+    double simHz = 0.0;
+    double renderHz = 0.0;
+
+    explicit SimClock(double hz = 60.0, int maxSteps = 8)
+        : stepSeconds(1.0 / hz), maxStepsPerFrame(maxSteps) {}
+
+    // Consumes the time elapsed since the last call and returns how many
+    // fixed ticks the caller should run before drawing
+    int advance() {
+        Clock::time_point now = Clock::now();
+        if (!started) {
+            started = true;
+            lastTime = windowStart = now;
+            return 0;
+        }
+        accumulator += std::chrono::duration<double>(now - lastTime).count();
+        lastTime = now;
+
+        int steps = (int)(accumulator / stepSeconds);
+        if (steps > maxStepsPerFrame) {
+            steps = maxStepsPerFrame;
+            accumulator = 0.0;
+        } else {
+            accumulator -= steps * stepSeconds;
+        }
+        windowSteps += steps;
+        return steps;
+    }
+
+    // Fraction of a tick the render time is ahead of the last simulated tick
+    float alpha() const {
+        double a = accumulator / stepSeconds;
+        return (float)(a < 0.0 ? 0.0 : (a > 1.0 ? 1.0 : a));
+    }
+
+    // Counts one rendered frame. Returns true when a new rate sample is ready.
+    bool frameRendered() {
+        ++windowFrames;
+        double elapsed = std::chrono::duration<double>(lastTime - windowStart).count();
+        if (elapsed < 1.0) return false;
+        simHz = windowSteps / elapsed;
+        renderHz = windowFrames / elapsed;
+        windowSteps = windowFrames = 0;
+        windowStart = lastTime;
+        return true;
+    }
+
+    // "<base> | sim 60.0 Hz | render 144.2 fps"
+    void formatTitle(char* out, size_t size, const char* base) const {
+        snprintf(out, size, "%s | sim %.1f Hz | render %.1f fps", base, simHz, renderHz);
+    }
+};
+
+inline float simLerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+// Interpolates a value that wraps at 'period' (angles, cyclic phases) the
+// short way round, so a wrap between ticks does not sweep backwards
+inline float simLerpWrapped(float a, float b, float t, float period) {
+    float d = std::fmod(b - a, period);
+    if (d > period * 0.5f) d -= period;
+    if (d < -period * 0.5f) d += period;
+    return a + d * t;
+}
+
+#endif // SIM_CLOCK_H
@@ -0,0 +1,103 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+// --- SIMD Math ---
+// Polynomial sine shared by the scalar, SSE2 and AVX2 code paths. All three
+// evaluate the same reduction and polynomial, so results match across paths
+// to within float rounding. Absolute error is below 4e-6 after reduction.
+
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_MATH_X86 1
+#include <immintrin.h>
+#endif
+
+const float SIMD_PI = 3.14159265358979323846f;
+const float SIMD_HALF_PI = 1.57079632679489661923f;
+const float SIMD_TWO_PI = 6.28318530717958647692f;
+const float SIMD_INV_TWO_PI = 0.15915494309189533577f;
+
+// Sine after range reduction: y is already in [-pi/2, pi/2]
+inline float sinPoly(float y) {
+    float y2 = y * y;
+    return y * (1.0f + y2 * (-1.0f / 6.0f + y2 * (1.0f / 120.0f + y2 * (-1.0f / 5040.0f + y2 * (1.0f / 362880.0f)))));
+}
+
+inline float fastSin(float x) {
+    x -= SIMD_TWO_PI * nearbyintf(x * SIMD_INV_TWO_PI);
+    if (x > SIMD_HALF_PI) x = SIMD_PI - x;
+    if (x < -SIMD_HALF_PI) x = -SIMD_PI - x;
+    return sinPoly(x);
+}
+
+inline float fastCos(float x) {
+    return fastSin(x + SIMD_HALF_PI);
+}
+
+#ifdef SIMD_MATH_X86
+
+__attribute__((target("sse2")))
+inline __m128 sinPs(__m128 x) {
+    const __m128 pi = _mm_set1_ps(SIMD_PI);
+    const __m128 halfPi = _mm_set1_ps(SIMD_HALF_PI);
+
+    // Round-to-nearest via the default MXCSR mode, matching nearbyintf
+    __m128 k = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(SIMD_INV_TWO_PI))));
+    x = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(SIMD_TWO_PI)));
+
+    __m128 above = _mm_cmpgt_ps(x, halfPi);
+    x = _mm_or_ps(_mm_and_ps(above, _mm_sub_ps(pi, x)), _mm_andnot_ps(above, x));
+    __m128 below = _mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), halfPi));
+    x = _mm_or_ps(_mm_and_ps(below, _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), pi), x)), _mm_andnot_ps(below, x));
+
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_set1_ps(1.0f / 362880.0f);
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 5040.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 120.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 6.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(p, x);
+}
+
+__attribute__((target("sse2")))
+inline __m128 cosPs(__m128 x) {
+    return sinPs(_mm_add_ps(x, _mm_set1_ps(SIMD_HALF_PI)));
+}
+
+__attribute__((target("avx2")))
+inline __m256 sin256(__m256 x) {
+    const __m256 pi = _mm256_set1_ps(SIMD_PI);
+    const __m256 halfPi = _mm256_set1_ps(SIMD_HALF_PI);
+
+    __m256 k = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(SIMD_INV_TWO_PI)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_sub_ps(x, _mm256_mul_ps(k, _mm256_set1_ps(SIMD_TWO_PI)));
+
+    x = _mm256_blendv_ps(x, _mm256_sub_ps(pi, x), _mm256_cmp_ps(x, halfPi, _CMP_GT_OQ));
+    __m256 negPi = _mm256_sub_ps(_mm256_setzero_ps(), pi);
+    __m256 negHalfPi = _mm256_sub_ps(_mm256_setzero_ps(), halfPi);
+    x = _mm256_blendv_ps(x, _mm256_sub_ps(negPi, x), _mm256_cmp_ps(x, negHalfPi, _CMP_LT_OQ));
+
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(1.0f / 362880.0f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.0f / 5040.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f / 120.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.0f / 6.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f));
+    return _mm256_mul_ps(p, x);
+}
+
+__attribute__((target("avx2")))
+inline __m256 cos256(__m256 x) {
+    return sin256(_mm256_add_ps(x, _mm256_set1_ps(SIMD_HALF_PI)));
+}
+
+inline bool cpuHasAVX2() {
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    return hasAVX2;
+}
+
+#endif // SIMD_MATH_X86
+
+#endif // SIMD_MATH_H
@@ -0,0 +1,184 @@
+#ifndef SKY_DOME_H
+#define SKY_DOME_H
+
+// --- Sky Dome ---
+// The whole sky in one unblended pass: a sphere around the eye, drawn after
+// the opaque scene with depth testing but no depth writes. It only fills the
+// pixels nothing else covered, so the color buffer needs no clear and early
+// depth rejection skips the rest. Vertex colors carry the horizon-to-
+// zenith gradient. The sun disc and its glow come from a small 1D lookup
+// texture of the radial profile, indexed by the angle from the sun and laid
+// over the gradient with GL_DECAL, so the glow costs no extra pass.
+//
+// The sphere's pole is turned towards the sun every frame, so its rings are
+// circles of constant angle from the sun and that angle is exact at every
+// vertex. Only the rings the glow reaches are drawn with texturing on; the
+// rest of the sphere, most of the screen, is plain smooth-shaded color.
+// Positions, colors and texture coordinates are rewritten on the CPU each
+// frame; at a few thousand vertices that is cheaper than any state the
+// layered-sphere sun used to change.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <GL/gl.h>
+
+#include "mesh_cache.h"
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+struct SkyColors {
+    float horizon[3];
+    float zenith[3];
+};
+
+class SkyDome {
+public:
+    static const int SLICES = 48;
+    static const int RINGS = 32;
+    static const int PROFILE_SIZE = 256;
+    // The profile texture spans this many sun-disc radii from the sun's centre
+    static constexpr float PROFILE_EXTENT = 4.0f;
+
+    // Builds the sphere and the glow profile; needs a GL context
+    void init() {
+        directions.clear();
+        angles.clear();
+        indices.clear();
+        for (int j = 0; j <= RINGS; ++j) {
+            float phi = MESH_PI * j / RINGS;
+            for (int i = 0; i <= SLICES; ++i) {
+                float theta = 2.0f * MESH_PI * i / SLICES;
+                directions.push_back(sinf(phi) * cosf(theta));
+                directions.push_back(sinf(phi) * sinf(theta));
+                directions.push_back(cosf(phi));
+                angles.push_back(phi);
+            }
+        }
+        for (int j = 0; j < RINGS; ++j) {
+            for (int i = 0; i < SLICES; ++i) {
+                unsigned int a = j * (SLICES + 1) + i;
+                unsigned int b = a + SLICES + 1;
+                indices.push_back(a); indices.push_back(b); indices.push_back(a + 1);
+                indices.push_back(a + 1); indices.push_back(b); indices.push_back(b + 1);
+            }
+        }
+        vertices.resize(directions.size() / 3 * FLOATS_PER_VERTEX);
+        buildProfileTexture();
+    }
+
+    // Draws the sky around 'eye', at 'radius' (inside the far plane), with a sun of angular radius 'sunRadius'
+    // (radians) in direction 'sun'. The gradient runs from 'colors.horizon'
+    // at and below the horizon to 'colors.zenith' overhead.
+    void draw(const float eye[3], const float sun[3], float sunRadius, const SkyColors& colors, float radius) {
+        // Basis with the sun as its z axis
+        float z[3] = { sun[0], sun[1], sun[2] };
+        float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+        for (int k = 0; k < 3; ++k) z[k] /= length;
+        float helper[3] = { 0.0f, 1.0f, 0.0f };
+        if (fabsf(z[1]) > 0.9f) { helper[0] = 1.0f; helper[1] = 0.0f; }
+        float x[3] = { helper[1] * z[2] - helper[2] * z[1], helper[2] * z[0] - helper[0] * z[2],
+                       helper[0] * z[1] - helper[1] * z[0] };
+        length = sqrtf(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+        for (int k = 0; k < 3; ++k) x[k] /= length;
+        float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+        float profileScale = 1.0f / (PROFILE_EXTENT * sunRadius);
+        float* out = vertices.data();
+        for (size_t v = 0; v < angles.size(); ++v, out += FLOATS_PER_VERTEX) {
+            const float* d = &directions[v * 3];
+            float world[3];
+            for (int k = 0; k < 3; ++k) world[k] = x[k] * d[0] + y[k] * d[1] + z[k] * d[2];
+            float t = skyGradient(world[1]);
+            out[0] = eye[0] + radius * world[0];
+            out[1] = eye[1] + radius * world[1];
+            out[2] = eye[2] + radius * world[2];
+            for (int k = 0; k < 3; ++k) out[3 + k] = colors.horizon[k] + (colors.zenith[k] - colors.horizon[k]) * t;
+            out[6] = angles[v] * profileScale;
+        }
+
+        glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT);
+        glDisable(GL_LIGHTING);
+        glDisable(GL_FOG);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_TEXTURE_2D);
+        glEnable(GL_TEXTURE_1D);
+        glBindTexture(GL_TEXTURE_1D, profileTexture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
+        countDraw(DRAW_TEXTURE_BINDS);
+
+        // Rings up to the first one wholly past the glow take the texture
+        int glowRings = std::min(RINGS, (int)ceilf(PROFILE_EXTENT * sunRadius * RINGS / MESH_PI) + 1);
+        GLsizei glowIndices = (GLsizei)(glowRings * SLICES * 6);
+
+        const GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glVertexPointer(3, GL_FLOAT, stride, vertices.data());
+        glColorPointer(3, GL_FLOAT, stride, vertices.data() + 3);
+        glTexCoordPointer(1, GL_FLOAT, stride, vertices.data() + 6);
+        glDrawElements(GL_TRIANGLES, glowIndices, GL_UNSIGNED_INT, indices.data());
+        glDisable(GL_TEXTURE_1D);
+        glDrawElements(GL_TRIANGLES, (GLsizei)indices.size() - glowIndices, GL_UNSIGNED_INT, indices.data() + glowIndices);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+
+        glPopAttrib();
+        meshTrianglesDrawn() += (long long)(indices.size() / 3);
+        countDraw(DRAW_CALLS, 2);
+        countDraw(DRAW_VERTICES, (long long)indices.size());
+    }
+
+    size_t triangleCount() const { return indices.size() / 3; }
+
+private:
+    static const int FLOATS_PER_VERTEX = 7; // Position, color, profile coordinate
+
+    std::vector<float> directions;     // Unit directions, pole along +z
+    std::vector<float> angles;         // Angle of each direction from the pole
+    std::vector<unsigned int> indices; // GL_TRIANGLES
+    std::vector<float> vertices;       // Rewritten every draw
+    GLuint profileTexture = 0;
+
+    // 0 at and below the horizon, 1 overhead, eased in between
+    static float skyGradient(float elevationSine) {
+        float t = std::min(std::max(elevationSine / 0.7f, 0.0f), 1.0f);
+        return t * (2.0f - t);
+    }
+
+    // Radial sun profile: an opaque disc with a soft rim, then a warm glow
+    // fading out by PROFILE_EXTENT disc radii. Alpha is the weight of the
+    // texel color over the sky gradient.
+    void buildProfileTexture() {
+        std::vector<unsigned char> texels(PROFILE_SIZE * 4);
+        for (int i = 0; i < PROFILE_SIZE; ++i) {
+            float u = (i + 0.5f) / PROFILE_SIZE * PROFILE_EXTENT; // In disc radii
+            float disc = std::min(std::max((1.05f - u) / 0.1f, 0.0f), 1.0f);
+            float fade = std::min(std::max((PROFILE_EXTENT - u) / (PROFILE_EXTENT - 2.0f), 0.0f), 1.0f);
+            float glow = 0.85f * expf(-1.6f * std::max(u - 1.0f, 0.0f)) * fade * fade;
+            float alpha = disc + (1.0f - disc) * glow;
+            const float discColor[3] = { 1.0f, 0.95f, 0.8f };
+            const float glowColor[3] = { 1.0f, 0.85f, 0.6f };
+            for (int k = 0; k < 3; ++k) {
+                float c = discColor[k] * disc + glowColor[k] * (1.0f - disc);
+                texels[i * 4 + k] = (unsigned char)(c * 255.0f + 0.5f);
+            }
+            texels[i * 4 + 3] = (unsigned char)(alpha * 255.0f + 0.5f);
+        }
+        if (profileTexture == 0) glGenTextures(1, &profileTexture);
+        glBindTexture(GL_TEXTURE_1D, profileTexture);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, PROFILE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    }
+};
+
+#endif // SKY_DOME_H
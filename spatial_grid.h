@@ -0,0 +1,235 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+// --- Spatial Grid ---
+// Uniform grid on the XZ plane over static scene objects, built once at
+// init. Each object is binned by the centre of its bounding sphere; cells
+// are stored compactly (a prefix-sum offset per cell into one item array,
+// with the spheres copied alongside in cell order), so a grid over 10^6
+// objects is three flat arrays and queries touch memory sequentially.
+//
+// Queries call visit(id) for every object they accept, where id is the
+// object's index in the vector the grid was built from:
+//   queryRadius  - objects whose sphere overlaps a circle on the ground
+//   queryBox     - objects whose sphere overlaps a ground rectangle
+//   queryFrustum - objects whose sphere is inside a view frustum
+// Radius and box queries only visit the cells they overlap. The frustum
+// query rejects or accepts whole blocks of cells at a time by their boxes
+// and only tests single spheres where a box straddles a plane.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"
+
+class SpatialGrid {
+public:
+    // Cells along one side of a block tested as a unit by queryFrustum()
+    static const int BLOCK_CELLS = 8;
+    // Objects per cell aimed for when build() picks the cell size
+    static const int TARGET_PER_CELL = 8;
+    // Upper bound on cells along one axis
+    static const int MAX_CELLS_PER_AXIS = 2048;
+
+    // Indexes 'items'; cellSize <= 0 picks one from the object density
+    void build(const std::vector<BoundingSphere>& items, float cellSize = 0.0f) {
+        count = items.size();
+        cellStart.clear();
+        cellItems.clear();
+        cellSpheres.clear();
+        cellBoxes.clear();
+        blockBoxes.clear();
+        columns = rows = blockColumns = blockRows = 0;
+        maxRadius = 0.0f;
+        if (count == 0) return;
+
+        float minX = items[0].x, maxX = items[0].x, minZ = items[0].z, maxZ = items[0].z;
+        for (const BoundingSphere& s : items) {
+            minX = std::min(minX, s.x); maxX = std::max(maxX, s.x);
+            minZ = std::min(minZ, s.z); maxZ = std::max(maxZ, s.z);
+            maxRadius = std::max(maxRadius, s.radius);
+        }
+        float width = std::max(maxX - minX, 1.0f), depth = std::max(maxZ - minZ, 1.0f);
+        if (cellSize <= 0.0f) {
+            cellSize = sqrtf(width * depth * TARGET_PER_CELL / (float)count);
+        }
+        cellSize = std::max(cellSize, std::max(width, depth) / MAX_CELLS_PER_AXIS);
+        originX = minX;
+        originZ = minZ;
+        this->cellSize = cellSize;
+        inverseCellSize = 1.0f / cellSize;
+        columns = std::min(MAX_CELLS_PER_AXIS, (int)(width * inverseCellSize) + 1);
+        rows = std::min(MAX_CELLS_PER_AXIS, (int)(depth * inverseCellSize) + 1);
+
+        // Counting sort of object ids by cell
+        std::vector<uint32_t> cellOf(count);
+        cellStart.assign((size_t)columns * rows + 1, 0);
+        for (size_t i = 0; i < count; ++i) {
+            cellOf[i] = (uint32_t)(row(items[i].z) * columns + column(items[i].x));
+            cellStart[cellOf[i] + 1]++;
+        }
+        for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        cellItems.resize(count);
+        cellSpheres.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t slot = fill[cellOf[i]]++;
+            cellItems[slot] = (uint32_t)i;
+            cellSpheres[slot] = items[i];
+        }
+
+        // Tight boxes around the spheres of each cell, then of each block
+        cellBoxes.resize((size_t)columns * rows);
+        for (size_t c = 0; c < cellBoxes.size(); ++c) {
+            Box& box = cellBoxes[c];
+            box = emptyBox();
+            for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k) growBox(box, cellSpheres[k]);
+        }
+        blockColumns = (columns + BLOCK_CELLS - 1) / BLOCK_CELLS;
+        blockRows = (rows + BLOCK_CELLS - 1) / BLOCK_CELLS;
+        blockBoxes.assign((size_t)blockColumns * blockRows, emptyBox());
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                const Box& cell = cellBoxes[(size_t)r * columns + c];
+                if (cellEmpty(r * columns + c)) continue;
+                Box& block = blockBoxes[(size_t)(r / BLOCK_CELLS) * blockColumns + c / BLOCK_CELLS];
+                for (int k = 0; k < 3; ++k) {
+                    block.lo[k] = std::min(block.lo[k], cell.lo[k]);
+                    block.hi[k] = std::max(block.hi[k], cell.hi[k]);
+                }
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+    int cellCount() const { return columns * rows; }
+    float cellSizeUsed() const { return cellSize; }
+
+    template <class Visit>
+    void queryRadius(float x, float z, float radius, Visit visit) const {
+        if (count == 0) return;
+        int c0, r0, c1, r1;
+        cellRange(x - radius, z - radius, x + radius, z + radius, c0, r0, c1, r1);
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                size_t cell = (size_t)r * columns + c;
+                for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                    const BoundingSphere& s = cellSpheres[k];
+                    float dx = s.x - x, dz = s.z - z, reach = radius + s.radius;
+                    if (dx * dx + dz * dz <= reach * reach) visit(cellItems[k]);
+                }
+            }
+        }
+    }
+
+    template <class Visit>
+    void queryBox(float minX, float minZ, float maxX, float maxZ, Visit visit) const {
+        if (count == 0) return;
+        int c0, r0, c1, r1;
+        cellRange(minX, minZ, maxX, maxZ, c0, r0, c1, r1);
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                size_t cell = (size_t)r * columns + c;
+                for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                    const BoundingSphere& s = cellSpheres[k];
+                    if (s.x + s.radius < minX || s.x - s.radius > maxX) continue;
+                    if (s.z + s.radius < minZ || s.z - s.radius > maxZ) continue;
+                    visit(cellItems[k]);
+                }
+            }
+        }
+    }
+
+    // Visits every object whose sphere is inside the frustum and returns
+    // how many were visited
+    template <class Visit>
+    size_t queryFrustum(const Frustum& frustum, Visit visit) const {
+        size_t visited = 0;
+        for (int br = 0; br < blockRows; ++br) {
+            for (int bc = 0; bc < blockColumns; ++bc) {
+                const Box& block = blockBoxes[(size_t)br * blockColumns + bc];
+                if (block.lo[0] > block.hi[0]) continue;
+                FrustumTest blockTest = boxInFrustum(frustum, block.lo, block.hi);
+                if (blockTest == FRUSTUM_OUTSIDE) continue;
+
+                int rEnd = std::min(rows, (br + 1) * BLOCK_CELLS);
+                int cEnd = std::min(columns, (bc + 1) * BLOCK_CELLS);
+                for (int r = br * BLOCK_CELLS; r < rEnd; ++r) {
+                    for (int c = bc * BLOCK_CELLS; c < cEnd; ++c) {
+                        size_t cell = (size_t)r * columns + c;
+                        if (cellEmpty(cell)) continue;
+                        FrustumTest cellTest = blockTest == FRUSTUM_INSIDE ? FRUSTUM_INSIDE
+                            : boxInFrustum(frustum, cellBoxes[cell].lo, cellBoxes[cell].hi);
+                        if (cellTest == FRUSTUM_OUTSIDE) continue;
+                        for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                            if (cellTest == FRUSTUM_INTERSECTS && !sphereInFrustum(frustum, cellSpheres[k])) continue;
+                            visit(cellItems[k]);
+                            ++visited;
+                        }
+                    }
+                }
+            }
+        }
+        return visited;
+    }
+
+private:
+    struct Box {
+        float lo[3], hi[3];
+    };
+
+    size_t count = 0;
+    float originX = 0.0f, originZ = 0.0f;
+    float cellSize = 1.0f, inverseCellSize = 1.0f;
+    float maxRadius = 0.0f; // Objects reach at most this far out of their cell
+    int columns = 0, rows = 0;
+    int blockColumns = 0, blockRows = 0;
+    std::vector<uint32_t> cellStart;        // columns * rows + 1 offsets into cellItems
+    std::vector<uint32_t> cellItems;        // Object ids grouped by cell
+    std::vector<BoundingSphere> cellSpheres; // Spheres in the same order as cellItems
+    std::vector<Box> cellBoxes;
+    std::vector<Box> blockBoxes;
+
+    static Box emptyBox() {
+        Box box = { { 1e30f, 1e30f, 1e30f }, { -1e30f, -1e30f, -1e30f } };
+        return box;
+    }
+
+    static void growBox(Box& box, const BoundingSphere& s) {
+        const float centre[3] = { s.x, s.y, s.z };
+        for (int k = 0; k < 3; ++k) {
+            box.lo[k] = std::min(box.lo[k], centre[k] - s.radius);
+            box.hi[k] = std::max(box.hi[k], centre[k] + s.radius);
+        }
+    }
+
+    bool cellEmpty(size_t cell) const {
+        return cellStart[cell] == cellStart[cell + 1];
+    }
+
+    // Clamped in float first so far-away query bounds cannot overflow the int
+    static int clampCell(float cell, int cells) {
+        return (int)std::max(0.0f, std::min((float)(cells - 1), floorf(cell)));
+    }
+
+    int column(float x) const {
+        return clampCell((x - originX) * inverseCellSize, columns);
+    }
+
+    int row(float z) const {
+        return clampCell((z - originZ) * inverseCellSize, rows);
+    }
+
+    // Cells whose objects can overlap the rectangle, widened by maxRadius
+    // because objects are binned by their centre only
+    void cellRange(float minX, float minZ, float maxX, float maxZ, int& c0, int& r0, int& c1, int& r1) const {
+        c0 = column(minX - maxRadius);
+        r0 = row(minZ - maxRadius);
+        c1 = column(maxX + maxRadius);
+        r1 = row(maxZ + maxRadius);
+    }
+};
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,169 @@
+// Build and query benchmark for the spatial grid in spatial_grid.h.
+// Needs no GL context:
+//     g++ -std=c++11 -O2 spatial_grid_bench.cpp -o spatial_grid_bench
+//     ./spatial_grid_bench > spatial_grid.json
+//
+// Props are scattered over a 20 km square at 10^4, 10^5 and 10^6 objects.
+// Each query kind is timed against a linear scan of the same spheres, and
+// every grid result is checked against the scan.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "scene_rng.h"
+#include "spatial_grid.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+const float WORLD_HALF_SIZE = 10000.0f;
+const int QUERIES = 200;
+const float BENCH_PI = 3.14159265f;
+
+vector<BoundingSphere> scatterProps(size_t count) {
+    vector<BoundingSphere> props(count);
+    for (size_t i = 0; i < count; ++i) {
+        SceneRng rng = sceneRng(SCENE_BENCH_SEED, RNG_PUMPKIN, i);
+        float x = rng.range(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+        float z = rng.range(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+        float radius = rng.range(5.0f, 40.0f);
+        props[i] = makeBoundingSphere(x, radius, z, radius);
+    }
+    return props;
+}
+
+// A camera on the ground looking along 'angle', like the scene's view
+Frustum benchFrustum(float x, float z, float angle) {
+    const float fovY = 60.0f * BENCH_PI / 180.0f, aspect = 1.5f, zNear = 1.0f, zFar = 6000.0f;
+    float f = 1.0f / tanf(fovY * 0.5f);
+    Mat4 projection;
+    for (int i = 0; i < 16; ++i) projection.m[i] = 0.0f;
+    projection.m[0] = f / aspect;
+    projection.m[5] = f;
+    projection.m[10] = (zFar + zNear) / (zNear - zFar);
+    projection.m[11] = -1.0f;
+    projection.m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+
+    // View looking down -Z after turning the world by -angle about Y
+    float c = cosf(angle), s = sinf(angle);
+    Mat4 view;
+    for (int i = 0; i < 16; ++i) view.m[i] = 0.0f;
+    view.m[0] = c;  view.m[8] = -s;
+    view.m[5] = 1.0f;
+    view.m[2] = s;  view.m[10] = c;
+    view.m[12] = -(c * x - s * z);
+    view.m[13] = -100.0f;
+    view.m[14] = -(s * x + c * z);
+    view.m[15] = 1.0f;
+    return frustumFromMatrix(projection * view);
+}
+
+struct QueryTiming {
+    double gridUs, scanUs;
+    double hits;
+    bool matches;
+};
+
+// Times 'gridQuery' and 'scanQuery' over the same query points; both fill a
+// vector of ids, which must agree once sorted
+template <class GridQuery, class ScanQuery>
+QueryTiming timeQueries(GridQuery gridQuery, ScanQuery scanQuery) {
+    QueryTiming timing = { 0.0, 0.0, 0.0, true };
+    vector<uint32_t> gridIds, scanIds;
+    for (int q = 0; q < QUERIES; ++q) {
+        SceneRng rng = sceneRng(SCENE_BENCH_SEED, RNG_HILL, q);
+        float x = rng.range(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+        float z = rng.range(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+        float angle = rng.range(0.0f, 2.0f * BENCH_PI);
+
+        gridIds.clear();
+        Clock::time_point start = Clock::now();
+        gridQuery(x, z, angle, gridIds);
+        timing.gridUs += chrono::duration<double, micro>(Clock::now() - start).count();
+
+        scanIds.clear();
+        start = Clock::now();
+        scanQuery(x, z, angle, scanIds);
+        timing.scanUs += chrono::duration<double, micro>(Clock::now() - start).count();
+
+        sort(gridIds.begin(), gridIds.end());
+        if (gridIds != scanIds) timing.matches = false;
+        timing.hits += gridIds.size();
+    }
+    timing.gridUs /= QUERIES;
+    timing.scanUs /= QUERIES;
+    timing.hits /= QUERIES;
+    return timing;
+}
+
+void printTiming(const char* query, size_t count, const QueryTiming& t, bool& first) {
+    printf("%s    {\"query\": \"%s\", \"props\": %zu, \"grid_us\": %.2f, \"scan_us\": %.2f, "
+           "\"speedup\": %.1f, \"mean_hits\": %.1f, \"matches_scan\": %s}",
+           first ? "" : ",\n", query, count, t.gridUs, t.scanUs,
+           t.scanUs / max(t.gridUs, 1e-3), t.hits, t.matches ? "true" : "false");
+    first = false;
+}
+
+int main() {
+    const size_t sizes[] = { 10000, 100000, 1000000 };
+    const float radius = 300.0f;
+
+    printf("{\n  \"builds\": [\n");
+    vector<vector<BoundingSphere>> scenes;
+    vector<SpatialGrid> grids(3);
+    for (int s = 0; s < 3; ++s) {
+        scenes.push_back(scatterProps(sizes[s]));
+        Clock::time_point start = Clock::now();
+        grids[s].build(scenes[s]);
+        double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+        printf("%s    {\"props\": %zu, \"build_ms\": %.2f, \"cells\": %d, \"cell_size\": %.1f}",
+               s ? ",\n" : "", sizes[s], ms, grids[s].cellCount(), grids[s].cellSizeUsed());
+    }
+    printf("\n  ],\n  \"queries\": [\n");
+
+    bool first = true;
+    for (int s = 0; s < 3; ++s) {
+        const vector<BoundingSphere>& props = scenes[s];
+        const SpatialGrid& grid = grids[s];
+        auto collect = [](vector<uint32_t>& ids) { return [&ids](uint32_t id) { ids.push_back(id); }; };
+
+        printTiming("radius", props.size(), timeQueries(
+            [&](float x, float z, float, vector<uint32_t>& ids) { grid.queryRadius(x, z, radius, collect(ids)); },
+            [&](float x, float z, float, vector<uint32_t>& ids) {
+                for (size_t i = 0; i < props.size(); ++i) {
+                    float dx = props[i].x - x, dz = props[i].z - z, reach = radius + props[i].radius;
+                    if (dx * dx + dz * dz <= reach * reach) ids.push_back((uint32_t)i);
+                }
+            }), first);
+
+        printTiming("box", props.size(), timeQueries(
+            [&](float x, float z, float, vector<uint32_t>& ids) {
+                grid.queryBox(x - radius, z - radius, x + radius, z + radius, collect(ids));
+            },
+            [&](float x, float z, float, vector<uint32_t>& ids) {
+                for (size_t i = 0; i < props.size(); ++i) {
+                    const BoundingSphere& p = props[i];
+                    if (p.x + p.radius < x - radius || p.x - p.radius > x + radius) continue;
+                    if (p.z + p.radius < z - radius || p.z - p.radius > z + radius) continue;
+                    ids.push_back((uint32_t)i);
+                }
+            }), first);
+
+        printTiming("frustum", props.size(), timeQueries(
+            [&](float x, float z, float angle, vector<uint32_t>& ids) {
+                grid.queryFrustum(benchFrustum(x, z, angle), collect(ids));
+            },
+            [&](float x, float z, float angle, vector<uint32_t>& ids) {
+                Frustum frustum = benchFrustum(x, z, angle);
+                for (size_t i = 0; i < props.size(); ++i) {
+                    if (sphereInFrustum(frustum, props[i])) ids.push_back((uint32_t)i);
+                }
+            }), first);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,292 @@
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+// --- Trace Events ---
+// Timelines in the Chrome trace-event JSON format, which Perfetto
+// (ui.perfetto.dev) and chrome://tracing load. A TraceScope records one
+// complete event (name, category, start, duration, optionally one integer
+// argument) for the block it wraps; traceInstant() marks a point in time.
+//
+// Every thread appends to a buffer of its own: a chain of fixed-size chunks
+// that only that thread writes and that only grows, so recording takes no
+// lock. Each chunk publishes its event count with a release store, which
+// lets the dump read all buffers while their threads keep recording. A
+// thread registers its buffer (under a mutex) with its first event; at most
+// TRACE_MAX_CHUNKS chunks per thread are kept, later events are dropped and
+// counted.
+//
+// Tracing is off unless --trace <file> is given; a scope then costs one
+// relaxed load. The file is written at exit, on SIGUSR1 (tracing goes on,
+// the next dump rewrites the file with everything so far) and on SIGINT or
+// SIGTERM, which end the program after the dump. Signal handlers only set
+// flags; the scene acts on them once per frame in traceHandleRequests().
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const size_t TRACE_CHUNK_EVENTS = 4096;
+const size_t TRACE_MAX_CHUNKS = 256; // About a million events per thread
+
+struct TraceEvent {
+    const char* name;     // Static strings only; the dump reads them at exit
+    const char* category;
+    int64_t start;        // Nanoseconds since the trace epoch
+    int64_t duration;     // Negative: instant event
+    const char* argName;  // nullptr: no argument
+    int64_t arg;
+};
+
+struct TraceChunk {
+    TraceEvent events[TRACE_CHUNK_EVENTS];
+    std::atomic<size_t> count{0};
+    std::atomic<TraceChunk*> next{nullptr};
+};
+
+// One thread's events; written only by that thread
+struct TraceThreadBuffer {
+    int tid;
+    std::atomic<const char*> name;
+    TraceChunk* first;
+    TraceChunk* last;
+    size_t chunks = 1;
+    std::atomic<long long> dropped{0};
+
+    TraceThreadBuffer(int tid, const char* threadName) : tid(tid), name(threadName), first(new TraceChunk()), last(first) {}
+
+    void append(const TraceEvent& event) {
+        size_t count = last->count.load(std::memory_order_relaxed);
+        if (count == TRACE_CHUNK_EVENTS) {
+            if (chunks == TRACE_MAX_CHUNKS) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            TraceChunk* chunk = new TraceChunk();
+            last->next.store(chunk, std::memory_order_release);
+            last = chunk;
+            ++chunks;
+            count = 0;
+        }
+        last->events[count] = event;
+        last->count.store(count + 1, std::memory_order_release);
+    }
+};
+
+class TraceLog {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    TraceLog() : epoch(Clock::now()) {}
+
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+    // Records from now on; the file is written to 'path'
+    void start(const char* path, const char* processName) {
+        outputPath = path;
+        process = processName;
+        on.store(true, std::memory_order_relaxed);
+    }
+
+    const std::string& path() const { return outputPath; }
+
+    void complete(const char* name, const char* category, Clock::time_point begin, Clock::time_point end,
+                  const char* argName = nullptr, int64_t arg = 0) {
+        TraceEvent event = { name, category, nanoseconds(begin), nanoseconds(end) - nanoseconds(begin), argName, arg };
+        threadBuffer().append(event);
+    }
+
+    void instant(const char* name, const char* category) {
+        TraceEvent event = { name, category, nanoseconds(Clock::now()), -1, nullptr, 0 };
+        threadBuffer().append(event);
+    }
+
+    // Names the calling thread in the timeline
+    void setThreadName(const char* name) {
+        ThreadState& state = threadState();
+        state.name = name;
+        if (state.buffer) state.buffer->name.store(name, std::memory_order_relaxed);
+    }
+
+    // Writes everything recorded so far; false if the file cannot be written
+    bool write() {
+        if (outputPath.empty()) return false;
+        FILE* out = fopen(outputPath.c_str(), "w");
+        if (!out) return false;
+        std::lock_guard<std::mutex> lock(registry);
+        long long dropped = 0;
+        fprintf(out, "{\"traceEvents\": [\n");
+        fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"%s\"}}",
+                process.c_str());
+        for (TraceThreadBuffer* buffer : buffers) {
+            const char* name = buffer->name.load(std::memory_order_relaxed);
+            fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                    buffer->tid, name ? name : "thread");
+            fprintf(out, ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"sort_index\": %d}}",
+                    buffer->tid, buffer->tid);
+            for (TraceChunk* chunk = buffer->first; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+                size_t count = chunk->count.load(std::memory_order_acquire);
+                for (size_t i = 0; i < count; ++i) writeEvent(out, buffer->tid, chunk->events[i]);
+            }
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        fprintf(out, "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"dropped_events\": %lld}}\n", dropped);
+        return fclose(out) == 0;
+    }
+
+    // --- Signals ---
+
+    std::atomic<bool> dumpRequested{false};
+    std::atomic<bool> exitRequested{false};
+
+private:
+    struct ThreadState {
+        TraceThreadBuffer* buffer = nullptr;
+        const char* name = nullptr;
+    };
+
+    const Clock::time_point epoch;
+    std::atomic<bool> on{false};
+    std::string outputPath;
+    std::string process;
+    std::mutex registry;
+    std::vector<TraceThreadBuffer*> buffers; // Live until exit; threads may outlive any dump
+
+    int64_t nanoseconds(Clock::time_point t) const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t - epoch).count();
+    }
+
+    static ThreadState& threadState() {
+        static thread_local ThreadState state;
+        return state;
+    }
+
+    TraceThreadBuffer& threadBuffer() {
+        ThreadState& state = threadState();
+        if (!state.buffer) {
+            std::lock_guard<std::mutex> lock(registry);
+            state.buffer = new TraceThreadBuffer((int)buffers.size() + 1, state.name);
+            buffers.push_back(state.buffer);
+        }
+        return *state.buffer;
+    }
+
+    static void writeEvent(FILE* out, int tid, const TraceEvent& event) {
+        fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f", event.name,
+                event.category, tid, event.start * 1e-3);
+        if (event.duration < 0) fprintf(out, ", \"ph\": \"i\", \"s\": \"t\"");
+        else fprintf(out, ", \"ph\": \"X\", \"dur\": %.3f", event.duration * 1e-3);
+        if (event.argName) fprintf(out, ", \"args\": {\"%s\": %lld}", event.argName, (long long)event.arg);
+        fprintf(out, "}");
+    }
+};
+
+inline TraceLog& traceLog() {
+    static TraceLog log;
+    return log;
+}
+
+inline bool traceEnabled() {
+    return traceLog().enabled();
+}
+
+inline void traceSetThreadName(const char* name) {
+    traceLog().setThreadName(name);
+}
+
+inline void traceInstant(const char* name, const char* category) {
+    if (traceEnabled()) traceLog().instant(name, category);
+}
+
+// Records the enclosing block as one complete event
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* category = "scene") : name(name), category(category) {
+        if (traceEnabled()) {
+            recording = true;
+            start = TraceLog::Clock::now();
+        }
+    }
+
+    ~TraceScope() {
+        if (recording) traceLog().complete(name, category, start, TraceLog::Clock::now(), argName, arg);
+    }
+
+    // Attaches one integer argument, shown with the event
+    void setArg(const char* key, int64_t value) {
+        argName = key;
+        arg = value;
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    bool recording = false;
+    TraceLog::Clock::time_point start;
+    const char* argName = nullptr;
+    int64_t arg = 0;
+};
+
+// --- Dumping ---
+
+inline void traceWriteAtExit() {
+    if (!traceLog().write()) fprintf(stderr, "trace: cannot write %s\n", traceLog().path().c_str());
+}
+
+inline void traceSignalHandler(int signal) {
+    if (signal != SIGINT && signal != SIGTERM) {
+        traceLog().dumpRequested.store(true, std::memory_order_relaxed);
+        return;
+    }
+    traceLog().exitRequested.store(true, std::memory_order_relaxed);
+    std::signal(signal, SIG_DFL); // A second one ends the program right away
+}
+
+// Call once per frame on the main thread: writes the file if a signal asked
+// for it, and returns true when the program should exit (the exit handler
+// writes the file then)
+inline bool traceHandleRequests() {
+    TraceLog& log = traceLog();
+    if (!log.enabled()) return false;
+    if (log.dumpRequested.exchange(false, std::memory_order_relaxed)) {
+        if (log.write()) fprintf(stderr, "trace: wrote %s\n", log.path().c_str());
+    }
+    return log.exitRequested.load(std::memory_order_relaxed);
+}
+
+// Consumes --trace <file> from argv so GLUT never sees it, and starts
+// tracing if it was given
+inline void traceParseArgs(int& argc, char** argv, const char* processName) {
+    std::string path;
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    argv[argc] = nullptr;
+    if (path.empty()) return;
+
+    traceLog().start(path.c_str(), processName);
+    traceSetThreadName("main");
+    atexit(traceWriteAtExit);
+    std::signal(SIGINT, traceSignalHandler);
+    std::signal(SIGTERM, traceSignalHandler);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, traceSignalHandler);
+#endif
+}
+
+#endif // TRACE_EVENTS_H